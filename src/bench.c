@@ -0,0 +1,337 @@
+// sinbench - micro-benchmarks for the interpreter and the itemstore
+//
+// Each benchmark is run several times, and the best time is reported, one
+// line per benchmark, as tab-separated values:
+//
+//   <name>  <operations>  <total nanoseconds>  <nanoseconds per operation>
+//
+// so that the results of two builds can be compared with diff, or a
+// spreadsheet.  Lines beginning with # are comments.
+
+// Licensed under the MIT License - see LICENSE file for details.
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <ftw.h>
+
+#include "config.h"
+#include "error.h"
+#include "parser.h"
+#include "memory.h"
+#include "log.h"
+#include "value.h"
+#include "stack.h"
+#include "item.h"
+#include "store.h"
+#include "interpret.h"
+
+// Things which need to be known
+CONFIG_t config;
+
+// Times each benchmark is run.  The best is reported.
+#define BENCH_RUNS 3
+// Loop iterations in each interpreted benchmark.
+#define BENCH_LOOPS 1000000
+
+static int runs = BENCH_RUNS;
+static const char *filter = NULL;
+static char workdir[] = "/tmp/sinbenchXXXXXX";
+
+static uint64_t now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static bool wanted(const char *name) {
+  return !filter || strstr(name, filter);
+}
+
+static void report(const char *name, uint64_t ops, uint64_t ns) {
+  printf("%s\t%llu\t%llu\t%.2f\n", name, (unsigned long long)ops,
+                            (unsigned long long)ns, ops ? (double)ns / ops : 0);
+  fflush(stdout);
+}
+
+static ITEM_t *compile(const char *name, const char *source) {
+  // Compile some Sinistra into an item of its own, outside the itemstore,
+  // as sin does with the boot item.
+  OUTPUT_t out;
+  out.maxsize = 1024;
+  out.bytecode = GROW_ARRAY(unsigned char, NULL, 0, out.maxsize);
+  out.nextbyte = out.bytecode;
+  LOCAL_t local;
+  local.count = 0;
+  local.param_count = 0;
+  char *copy = strdup(source);
+  bool ok = parse_source(copy, strlen(copy), &out, &local);
+  free(copy);
+  for (int l = 0; l < local.count; l++) {
+    free(local.id[l]);
+  }
+  if (!ok) {
+    logerr("Benchmark %s failed to compile: %s\n", name,
+                                                      errmsg[local.errnum]);
+    exit(EXIT_FAILURE);
+  }
+  ITEM_t *item = make_root_item(name);
+  item->type = ITEM_code;
+  item->bytecode = out.bytecode;
+  item->bytecode_len = out.nextbyte - out.bytecode;
+  return item;
+}
+
+static void run(ITEM_t *item) {
+  VALUE_t ret = interpret(item);
+  reset_stack(config.vm->stack);
+  FREE_STR(ret);
+}
+
+static void bench_code(const char *name, uint64_t ops, const char *setup,
+                                                      const char *source) {
+  // Time a piece of Sinistra, which does ops operations, after running
+  // the setup (if there is one) once.
+  if (!wanted(name)) {
+    return;
+  }
+  if (setup) {
+    ITEM_t *item = compile("setup", setup);
+    run(item);
+    destroy_item(item);
+  }
+  ITEM_t *item = compile(name, source);
+  uint64_t best = UINT64_MAX;
+  for (int r = 0; r < runs; r++) {
+    uint64_t start = now();
+    run(item);
+    uint64_t elapsed = now() - start;
+    if (elapsed < best) {
+      best = elapsed;
+    }
+  }
+  destroy_item(item);
+  report(name, ops, best);
+}
+
+static void interpreter_benchmarks() {
+  char source[1024];
+  #define LOOP(body) \
+    snprintf(source, sizeof(source), \
+      "@i = 0; @x = 0; @k = \"b\"; while @i < %d do " body " @i++; endwhile;", \
+      BENCH_LOOPS)
+
+  LOOP("");
+  bench_code("dispatch.loop", BENCH_LOOPS, NULL, source);
+  LOOP("@x = @x + @i * 2 - 1;");
+  bench_code("dispatch.arith", BENCH_LOOPS, NULL, source);
+  LOOP("if @i != @x then @x = -@i / 2; endif;");
+  bench_code("dispatch.intops", BENCH_LOOPS, NULL, source);
+  LOOP("@x = @i; @x = @k;");
+  bench_code("dispatch.locals", BENCH_LOOPS, NULL, source);
+  LOOP("@x = bench.a.b;");
+  bench_code("item.fetch.static", BENCH_LOOPS, "bench.a.b = 1;", source);
+  LOOP("bench.a.b = @i;");
+  bench_code("item.assign.static", BENCH_LOOPS, "bench.a.b = 1;", source);
+  LOOP("@x = bench.a.[@k];");
+  bench_code("item.fetch.deref", BENCH_LOOPS, "bench.a.b = 1;", source);
+  LOOP("bench.a.[@k] = @i;");
+  bench_code("item.assign.deref", BENCH_LOOPS, "bench.a.b = 1;", source);
+  LOOP("@x = bench.add{@i, 1};");
+  bench_code("item.call", BENCH_LOOPS,
+                        "bench.add = code {@x, @y} ( @x + @y; );", source);
+  LOOP("@x = \"abc\" + \"def\";");
+  bench_code("string.concat", BENCH_LOOPS, NULL, source);
+  snprintf(source, sizeof(source), "@i = 0; @s = \"\"; while @i < %d do "
+                       "@s = @s + \"x\"; @i++; endwhile;", BENCH_LOOPS / 10);
+  bench_code("string.append", BENCH_LOOPS / 10, NULL, source);
+  #undef LOOP
+}
+
+static void tree_name(char *name, uint32_t n, int depth) {
+  // The name of the nth item in a tree of the given depth.  A tree of
+  // depth 1 is just children of the root; deeper trees have ten children
+  // at each level.
+  if (depth == 1) {
+    sprintf(name, "w%u", n);
+    return;
+  }
+  char *p = name + sprintf(name, "d%u", n % 10);
+  for (int d = 1; d < depth; d++) {
+    n /= 10;
+    p += sprintf(p, ".d%u", n % 10);
+  }
+}
+
+static void bench_tree(const char *shape, uint32_t count, int depth) {
+  // Insert, find and then delete count items in a tree of the given
+  // depth.  With a depth of 1, they are all children of the root.
+  char name[MAX_ITEM_NAME];
+  char bench[64];
+  uint64_t best[3] = {UINT64_MAX, UINT64_MAX, UINT64_MAX};
+  snprintf(bench, sizeof(bench), "item.%s", shape);
+  if (!wanted(bench)) {
+    return;
+  }
+  for (int r = 0; r < runs; r++) {
+    ITEM_t *root = make_root_item("root");
+    uint64_t start = now();
+    for (uint32_t i = 0; i < count; i++) {
+      tree_name(name, i, depth);
+      insert_item(root, name, INT_VALUE(i));
+    }
+    uint64_t t1 = now();
+    for (uint32_t i = 0; i < count; i++) {
+      tree_name(name, i, depth);
+      if (!find_item(root, name)) {
+        logerr("Benchmark %s lost item %s.\n", bench, name);
+        exit(EXIT_FAILURE);
+      }
+    }
+    uint64_t t2 = now();
+    for (uint32_t i = 0; i < count; i++) {
+      tree_name(name, i, depth);
+      delete_item(root, name);
+    }
+    uint64_t t3 = now();
+    destroy_item(root);
+    uint64_t elapsed[3] = {t1 - start, t2 - t1, t3 - t2};
+    for (int b = 0; b < 3; b++) {
+      if (elapsed[b] < best[b]) {
+        best[b] = elapsed[b];
+      }
+    }
+  }
+  const char *op[3] = {"insert", "find", "delete"};
+  for (int b = 0; b < 3; b++) {
+    snprintf(bench, sizeof(bench), "item.%s.%s", shape, op[b]);
+    report(bench, count, best[b]);
+  }
+}
+
+static int remove_file(const char *path, const struct stat *st, int flag,
+                                                        struct FTW *ftw) {
+  return remove(path);
+}
+
+static void bench_store(uint32_t count) {
+  // Save and load an itemstore of count items, spread over a hundred
+  // segments.  Then change one item, and save again.
+  char bench[64];
+  char filename[sizeof(workdir) + 32];
+  snprintf(bench, sizeof(bench), "store.%u", count);
+  if (!wanted(bench)) {
+    return;
+  }
+  snprintf(filename, sizeof(filename), "%s/store%u.dat", workdir, count);
+  ITEM_t *root = make_root_item("root");
+  char name[MAX_ITEM_NAME];
+  for (uint32_t i = 0; i < count; i++) {
+    sprintf(name, "s%u.i%u", i % 100, i / 100);
+    insert_item(root, name, make_string_value("The quick brown fox."));
+  }
+  uint64_t best[4] = {UINT64_MAX, UINT64_MAX, UINT64_MAX, UINT64_MAX};
+  for (int r = 0; r < runs; r++) {
+    // Everything is saved the first time round.
+    for (uint32_t i = 0; i < 100; i++) {
+      sprintf(name, "s%u", i);
+      mark_changed(find_item(root, name));
+    }
+    uint64_t start = now();
+    bool ok = save_itemstore(filename, root);
+    uint64_t t1 = now();
+    set_item(root, "s0.i0", INT_VALUE(r));
+    ok = ok && save_itemstore(filename, root);
+    uint64_t t2 = now();
+    ITEM_t *loaded = load_itemstore(filename, false);
+    uint64_t t3 = now();
+    ITEM_t *mapped = load_itemstore(filename, true);
+    uint64_t t4 = now();
+    if (!ok || !loaded || !mapped) {
+      logerr("Benchmark %s failed.\n", bench);
+      exit(EXIT_FAILURE);
+    }
+    destroy_item(loaded);
+    destroy_item(mapped);
+    uint64_t elapsed[4] = {t1 - start, t2 - t1, t3 - t2, t4 - t3};
+    for (int b = 0; b < 4; b++) {
+      if (elapsed[b] < best[b]) {
+        best[b] = elapsed[b];
+      }
+    }
+  }
+  destroy_item(root);
+  const char *op[4] = {"save", "save.one", "load", "load.mapped"};
+  for (int b = 0; b < 4; b++) {
+    snprintf(bench, sizeof(bench), "store.%u.%s", count, op[b]);
+    report(bench, count, best[b]);
+  }
+}
+
+static void usage() {
+  logmsg("Sinistra benchmarks.\nSyntax: sinbench <options> [filter]\n");
+  logmsg("Options:\n");
+  logmsg(" -h, --help\t\tThis message.\n");
+  logmsg(" -q, --quick\t\tRun each benchmark once, and skip the largest.\n");
+  logmsg("Only benchmarks whose names contain the filter are run.\n");
+}
+
+int main(int argc, char **argv) {
+  bool quick = false;
+  int opt;
+  const struct option options[] =
+  {
+    {"help", no_argument, 0, 'h'},
+    {"quick", no_argument, 0, 'q'},
+    {NULL, 0, 0, '\0'}
+  };
+  while ((opt = getopt_long(argc, argv, "hq", options, NULL)) != -1) {
+    switch(opt) {
+      case 'h':
+        usage();
+        exit(EXIT_SUCCESS);
+        break;
+      case 'q':
+        quick = true;
+        runs = 1;
+        break;
+      default:
+        usage();
+        return EXIT_FAILURE;
+    }
+  }
+  if (optind < argc) {
+    filter = argv[optind];
+  }
+
+  // Code items save their source, so the benchmarks need somewhere to
+  // put it, and somewhere to put itemstores.
+  if (!mkdtemp(workdir)) {
+    logerr("Unable to make a working directory.\n");
+    exit(EXIT_FAILURE);
+  }
+  init_errmsg();
+  init_interpreter();
+  config.srcroot = workdir;
+  config.itemroot = make_root_item("root");
+  config.vm = make_vm();
+
+  printf("# benchmark\toperations\tns\tns/op\n");
+  interpreter_benchmarks();
+  bench_tree("wide", 100000, 1);
+  bench_tree("deep", 100000, 5);
+  bench_store(10000);
+  bench_store(100000);
+  if (!quick) {
+    bench_store(1000000);
+  }
+
+  destroy_vm(config.vm);
+  destroy_item(config.itemroot);
+  nftw(workdir, remove_file, 16, FTW_DEPTH | FTW_PHYS);
+  return EXIT_SUCCESS;
+}
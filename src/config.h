@@ -21,12 +21,14 @@ typedef struct {
   ITEM_t *itemroot;     // Root of in-memory itemstore
   char *srcroot;        // Root of source tree
   char *itemstore;      // Filename of on-disk itemstore
+  bool mapstore;        // Map the itemstore into memory rather than read it
+  bool journal;         // Record every change to the itemstore in a journal
   char *input;          // Name of the input item
   char *inputline;      // Item to receive the input line number
   char *inputtext;      // Item to receive the input data
+  char *inputevent;     // Item to receive a batch of input events
   VM_t *input_vm;       // VM for the input task
   uint8_t maxconns;     // Maximum number of connected players
-  uint8_t lastconn;     // Last connection processed by net.input
   bool safe_shutdown;   // Determins how to shut down.
 } CONFIG_t;
 
@@ -0,0 +1,457 @@
+// The bytecode pre-decoder
+
+// Licensed under the MIT License - see LICENSE file for details.
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "memory.h"
+#include "log.h"
+#include "libcall.h"
+#include "item.h"
+#include "decode.h"
+#include "jit.h"
+
+// Make sure there are at least n bytes of operand left in the bytecode.
+#define NEED(n) if (p + (n) > end) goto fail
+
+static void free_assembly(ASSEMBLY_t *assembly) {
+  // Free an assembly, and any assemblies nested inside it.
+  for (int l = 0; l < assembly->count; l++) {
+    if (assembly->layer[l].type == 'I' && assembly->layer[l].item) {
+      free_assembly(assembly->layer[l].item);
+    }
+  }
+  free(assembly->layer);
+  if (assembly->name) {
+    release_string(assembly->name);
+  }
+  FREE_ARRAY(ASSEMBLY_t, assembly, 1);
+}
+
+static ASSEMBLY_t *decode_assembly(uint8_t **pos, uint8_t *end) {
+  // Decode the layers of an item, starting immediately after its 'I'
+  // opcode.  On success, *pos is moved to just after the matching 'E'.
+  // Returns NULL if the layers are malformed.
+  uint8_t *p = *pos;
+  ASSEMBLY_t *assembly = GROW_ARRAY(ASSEMBLY_t, NULL, 0, 1);
+  int capacity = 0;
+  bool literal = true;
+
+  while (p < end && *p != 'E') {
+    if (assembly->count == UINT8_MAX) goto fail;
+    if (assembly->count >= capacity) {
+      int oldcapacity = capacity;
+      capacity = GROW_CAPACITY(capacity);
+      assembly->layer = GROW_ARRAY(LAYER_t, assembly->layer, oldcapacity,
+                                                                capacity);
+    }
+    LAYER_t *layer = &assembly->layer[assembly->count++];
+    memset(layer, 0, sizeof(LAYER_t));
+    switch (*p++) {
+      case 'L':
+        NEED(1);
+        layer->type = 'L';
+        layer->len = *p++;
+        NEED(layer->len);
+        layer->name = (const char *)p;
+        p += layer->len;
+        break;
+      case 'D':
+        NEED(1);
+        literal = false;
+        switch (*p++) {
+          case 'V':
+            NEED(1);
+            layer->type = 'V';
+            layer->local = *p++;
+            break;
+          case 'I':
+            layer->type = 'I';
+            layer->item = decode_assembly(&p, end);
+            if (!layer->item) goto fail;
+            break;
+          default:
+            goto fail;
+        }
+        break;
+      default:
+        goto fail;
+    }
+  }
+  if (p >= end || assembly->count == 0) goto fail;
+  *pos = p + 1; // Skip the 'E'
+
+  if (literal) {
+    // Every layer is known now, so the full name can be built once
+    // rather than every time the item is assembled.
+    int len = 0;
+    for (int l = 0; l < assembly->count; l++) {
+      len += assembly->layer[l].len + 1;
+    }
+    assembly->name = alloc_string(len - 1);
+    char *n = assembly->name->chars;
+    for (int l = 0; l < assembly->count; l++) {
+      memcpy(n, assembly->layer[l].name, assembly->layer[l].len);
+      n += assembly->layer[l].len;
+      *n++ = '.';
+    }
+    *(n - 1) = '\0';
+  }
+  return assembly;
+
+fail:
+  free_assembly(assembly);
+  return NULL;
+}
+
+// The string literals of an item met so far, hashed on their contents.
+// Literals are immutable, so the same one appearing more than once in an
+// item is only stored once.
+typedef struct {
+  STRING_t **str;
+  uint32_t mask;        // Size of the table less one, or 0 if none yet
+  uint32_t count;
+} LITERALS_t;
+
+static STRING_t *find_literal(LITERALS_t *lit, uint8_t *chars, uint16_t l) {
+  // Return the literal with these contents, adding it if it is new.
+  if (lit->count * 2 >= lit->mask) {
+    // Keep the table no more than half full.
+    uint32_t oldmask = lit->mask;
+    STRING_t **old = lit->str;
+    lit->mask = oldmask ? oldmask * 2 + 1 : 15;
+    lit->str = calloc(lit->mask + 1, sizeof(STRING_t *));
+    for (uint32_t i = 0; old && i <= oldmask; i++) {
+      if (old[i]) {
+        uint32_t s = murmur3_32(old[i]->chars, old[i]->len, 0) & lit->mask;
+        while (lit->str[s]) {
+          s = (s + 1) & lit->mask;
+        }
+        lit->str[s] = old[i];
+      }
+    }
+    free(old);
+  }
+  uint32_t s = murmur3_32((char *)chars, l, 0) & lit->mask;
+  while (lit->str[s]) {
+    STRING_t *str = lit->str[s];
+    if (str->len == l && memcmp(str->chars, chars, l) == 0) {
+      str->refcount++;
+      return str;
+    }
+    s = (s + 1) & lit->mask;
+  }
+  lit->count++;
+  return lit->str[s] = make_string((char *)chars, l);
+}
+
+static void free_instructions(DECODED_t *code) {
+  // Free the instructions, and anything which they own.
+  for (uint32_t i = 0; i < code->count; i++) {
+    switch (code->instr[i].op) {
+      case 'l':
+        release_string(code->instr[i].s);
+        break;
+      case 'I':
+      case OP_FETCHSTATIC:
+      case OP_EXISTSSTATIC:
+      case OP_NAMESTATIC:
+        free_assembly(code->instr[i].assembly);
+        break;
+    }
+  }
+  free(code->instr);
+  code->instr = NULL;
+  code->count = 0;
+}
+
+static bool stack_effect(INSTR_t *in, int *pops, int *pushes) {
+  // How many values does this instruction take from the stack, and how
+  // many does it leave?  Returns false for anything which may jump.
+  *pops = 0;
+  *pushes = 0;
+  switch (in->op) {
+    case 0: case 'f': case 'g':
+      break;
+    case 'e': case 'l': case 'p': case 'I':
+      *pushes = 1;
+      break;
+    case 'c': case 'B': case 'W':
+      *pops = 1;
+      break;
+    case 'n': case 'x': case 'N': case 'X': case 'Z':
+      *pops = 1;
+      *pushes = 1;
+      break;
+    case 'a': case 'd': case 'm': case 'o': case 'q': case 'r': case 's':
+    case 't': case 'u': case 'v': case 'y': case 'z': case 'Y':
+      *pops = 2;
+      *pushes = 1;
+      break;
+    case 'C':
+      *pops = 2;
+      break;
+    case 'A':
+      *pops = in->n;
+      *pushes = 1;
+      break;
+    case 'F':
+      *pops = in->n + 1;
+      *pushes = 1;
+      break;
+    default:
+      return false;
+  }
+  return true;
+}
+
+static int32_t find_assignment(DECODED_t *code, uint32_t from, bool *target) {
+  // Find the 'C' which assigns to the item named by the 'I' at from, by
+  // following the depth of the stack.  Returns -1 if it is not reached
+  // in straight-line code, or if anything else uses the name first.
+  int depth = 1; // Just the item name
+  for (uint32_t i = from + 1; i < code->count; i++) {
+    int pops, pushes;
+    if (target[i]) {
+      return -1;
+    }
+    if (code->instr[i].op == 'C' && depth == 2) {
+      return i;
+    }
+    if (!stack_effect(&code->instr[i], &pops, &pushes) || depth - pops < 1) {
+      return -1;
+    }
+    depth += pushes - pops;
+  }
+  return -1;
+}
+
+static void fuse_static_items(DECODED_t *code, bool *target) {
+  // Look for items whose names are known in advance, and pair them with
+  // the instruction that uses the name, so that the item can be cached.
+  for (uint32_t i = 0; i + 1 < code->count; i++) {
+    INSTR_t *in = &code->instr[i];
+    if (in->op != 'I' || !in->assembly->name) {
+      continue;
+    }
+    INSTR_t *next = &code->instr[i + 1];
+    if (next->op == 'F' && !target[i + 1]) {
+      // The 'F' is left in place, but is stepped over.
+      in->op = OP_FETCHSTATIC;
+      in->n = next->n;
+      in->raw = next->raw + 2;
+    } else if (next->op == 'X' && !target[i + 1]) {
+      in->op = OP_EXISTSSTATIC;
+    } else {
+      int32_t assign = find_assignment(code, i, target);
+      if (assign >= 0) {
+        in->op = OP_NAMESTATIC;
+        code->instr[assign].op = OP_ASSIGNSTATIC;
+        code->instr[assign].assembly = in->assembly;
+      }
+    }
+  }
+}
+
+static void fuse_local_ints(DECODED_t *code, bool *target) {
+  // Look for a local and an int literal which are added, subtracted or
+  // compared, and the instruction which uses the result, and turn the
+  // four into one.  These are the commonest runs in loops.
+  static const uint8_t jump[256] = {
+    ['o'] = OP_EQUALJUMP, ['q'] = OP_NOTEQUALJUMP, ['r'] = OP_LESSTHANJUMP,
+    ['t'] = OP_GREATERTHANJUMP, ['u'] = OP_LESSTHANOREQUALJUMP,
+    ['v'] = OP_GREATERTHANOREQUALJUMP,
+  };
+  for (uint32_t i = 0; i + 3 < code->count; i++) {
+    INSTR_t *in = &code->instr[i];
+    if (in->op != 'e' || in[1].op != 'p' || target[i + 1] || target[i + 2]
+                                                        || target[i + 3]) {
+      continue;
+    }
+    if (in[3].op == 'c' && in[2].op == 'a') {
+      in->op = OP_ADDLOCALINT;
+    } else if (in[3].op == 'c' && in[2].op == 's') {
+      in->op = OP_SUBTRACTLOCALINT;
+    } else if (in[3].op == 'k' && jump[in[2].op]) {
+      in->op = jump[in[2].op];
+    }
+  }
+}
+
+static void fuse_instructions(DECODED_t *code) {
+  // Replace runs of instructions with single ones which do the same job.
+  // Nothing may jump into the middle of a run.  The static items go
+  // first, as finding an assignment relies on the stack effects of the
+  // instructions in between.
+  bool *target = calloc(code->count, sizeof(bool));
+  for (uint32_t i = 0; i < code->count; i++) {
+    if (code->instr[i].op == 'j' || code->instr[i].op == 'k') {
+      target[code->instr[i].target] = true;
+    }
+  }
+  fuse_static_items(code, target);
+  fuse_local_ints(code, target);
+  free(target);
+}
+
+DECODED_t *decode_bytecode(uint8_t *bytecode, uint32_t len) {
+  // Decode the bytecode of an item.  If the bytecode cannot be decoded,
+  // the result has no instructions, and the interpreter will run the raw
+  // bytecode instead.  The result must be freed with free_decoded().
+  DECODED_t *code = GROW_ARRAY(DECODED_t, NULL, 0, 1);
+  if (!bytecode || len < 3) {
+    return code;
+  }
+
+  // Jump offsets are in bytes, so remember which instruction lives at
+  // which byte in order to turn them into instruction indices.
+  int32_t *slot = malloc(sizeof(int32_t) * len);
+  for (uint32_t b = 0; b < len; b++) {
+    slot[b] = -1;
+  }
+
+  LITERALS_t literals = {0};
+  uint32_t capacity = 0;
+  uint8_t *p = bytecode + 2; // Skip the locals and parameter counts
+  uint8_t *end = bytecode + len;
+  while (p < end) {
+    if (code->count >= capacity) {
+      uint32_t oldcapacity = capacity;
+      capacity = GROW_CAPACITY(capacity);
+      code->instr = GROW_ARRAY(INSTR_t, code->instr, oldcapacity, capacity);
+    }
+    INSTR_t *in = &code->instr[code->count];
+    memset(in, 0, sizeof(INSTR_t));
+    slot[p - bytecode] = code->count;
+    in->op = *p++;
+    in->raw = p;
+    switch (in->op) {
+      case 0:
+      case 'a': case 'd': case 'h': case 'm': case 'n': case 'o': case 'q':
+      case 'r': case 's': case 't': case 'u': case 'v': case 'x': case 'y':
+      case 'z': case 'C': case 'W': case 'X': case 'Y': case 'Z':
+        // No operands.
+        break;
+      case 'c': case 'e': case 'f': case 'g': case 'N':
+        NEED(1);
+        in->local = *p++;
+        break;
+      case 'j': case 'k': {
+        // The offset is relative to the operand.  Record the byte it
+        // points at for now, and resolve it once everything is decoded.
+        int16_t offset;
+        NEED(2);
+        memcpy(&offset, p, 2);
+        in->target = (p - bytecode) + offset;
+        p += 2;
+        break;
+      }
+      case 'l': {
+        uint16_t l;
+        NEED(2);
+        memcpy(&l, p, 2);
+        p += 2;
+        NEED(l);
+        in->s = find_literal(&literals, p, l);
+        p += l;
+        break;
+      }
+      case 'p': {
+        int64_t n;
+        NEED(8);
+        memcpy(&n, p, 8);
+        in->value = INT_VALUE(n);
+        p += 8;
+        break;
+      }
+      case 'A':
+        NEED(2);
+        in->libcall = libcall_func(p[0], p[1]);
+        if (!in->libcall) goto fail;
+        in->n = libcall_args(p[0], p[1]);
+        p += 2;
+        in->raw = p;
+        break;
+      case 'B': {
+        // Embedded code is compiled by op_assigncodeitem straight from
+        // the raw bytecode, so just step over it.
+        uint16_t l;
+        if (p < end && *p == 'P') {
+          p++;
+          do {
+            NEED(2);
+            memcpy(&l, p, 2);
+            p += 2;
+            NEED(l);
+            p += l;
+          } while (l > 0);
+        }
+        NEED(2);
+        memcpy(&l, p, 2);
+        p += 2;
+        NEED(l);
+        p += l;
+        break;
+      }
+      case 'F': {
+        uint16_t args;
+        NEED(2);
+        memcpy(&args, p, 2);
+        in->n = args;
+        p += 2;
+        break;
+      }
+      case 'I':
+        in->assembly = decode_assembly(&p, end);
+        if (!in->assembly) goto fail;
+        break;
+      default:
+        goto fail;
+    }
+    code->count++;
+  }
+
+  // Execution must end with a HALT, rather than by running off the end.
+  if (code->count == 0 || code->instr[code->count - 1].op != 'h') goto fail;
+  // Now every instruction has a home, resolve the jumps.
+  for (uint32_t i = 0; i < code->count; i++) {
+    INSTR_t *in = &code->instr[i];
+    if (in->op == 'j' || in->op == 'k') {
+      if (in->target < 0 || (uint32_t)in->target >= len
+                                              || slot[in->target] < 0) {
+        goto fail;
+      }
+      in->target = slot[in->target];
+    }
+  }
+  free(slot);
+  free(literals.str);
+  fuse_instructions(code);
+  return code;
+
+fail:
+  DEBUG_LOG("Unable to decode bytecode.  It will be interpreted raw.\n");
+  free_instructions(code);
+  free(slot);
+  free(literals.str);
+  return code;
+}
+
+void link_decoded(DECODED_t *code, const void **handlers) {
+  // Fill in the handler of every instruction from the interpreter's
+  // table, so that it can go straight from one instruction to the next.
+  for (uint32_t i = 0; i < code->count; i++) {
+    code->instr[i].handler = handlers[code->instr[i].op];
+  }
+  code->linked = handlers;
+}
+
+void free_decoded(DECODED_t *code) {
+  if (code) {
+    // Machine code made from the instructions goes with them.
+    jit_free(code->native);
+    free_instructions(code);
+    FREE_ARRAY(DECODED_t, code, 1);
+  }
+}
@@ -0,0 +1,103 @@
+// The bytecode pre-decoder.  Turns the raw bytestream of a code item into
+// an array of instructions with their operands already unpacked, so that
+// the interpreter does not have to re-parse the bytecode every time the
+// item is executed.
+
+// Licensed under the MIT License - see LICENSE file for details.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "interpret.h"
+
+// Instructions which the decoder makes from an 'I' whose layers are all
+// literals and the instruction which uses the name it assembles.  These
+// look the item up through a cache rather than by name, and only ever
+// appear in decoded code.
+#define OP_FETCHSTATIC  0x80  // 'I' then 'F'
+#define OP_EXISTSSTATIC 0x81  // 'I' then 'X'
+#define OP_NAMESTATIC   0x82  // 'I' whose name is used by an OP_ASSIGNSTATIC
+#define OP_ASSIGNSTATIC 0x83  // 'C' which assigns to an OP_NAMESTATIC
+
+// Int-only forms of the arithmetic and comparison opcodes.  The
+// interpreter quickens an instruction to one of these once it has seen it
+// given ints, and puts the original back if it is ever given anything
+// else.  An instruction which has been put back QUICKEN_LIMIT times is
+// left alone.  These only ever appear in decoded code.
+#define OP_ADDINT       0x90  // 'a'
+#define OP_SUBTRACTINT  0x91  // 's'
+#define OP_MULTIPLYINT  0x92  // 'm'
+#define OP_DIVIDEINT    0x93  // 'd'
+#define OP_NEGATEINT    0x94  // 'n'
+#define OP_EQUALINT     0x95  // 'o'
+#define OP_NOTEQUALINT  0x96  // 'q'
+#define OP_LESSTHANINT  0x97  // 'r'
+#define OP_GREATERTHANINT        0x98  // 't'
+#define OP_LESSTHANOREQUALINT    0x99  // 'u'
+#define OP_GREATERTHANOREQUALINT 0x9a  // 'v'
+#define QUICKEN_LIMIT   4
+
+// Instructions which the decoder makes from the 'e' at the start of a run
+// which does int arithmetic or comparisons on a local.  The rest of the
+// run is left in place behind them, and is stepped over.  If the local is
+// ever found not to hold an int, the 'e' is put back, and the run is
+// executed as it stands from then on.  These only ever appear in decoded
+// code.
+#define OP_ADDLOCALINT          0xa0  // 'e' 'p' 'a' 'c'
+#define OP_SUBTRACTLOCALINT     0xa1  // 'e' 'p' 's' 'c'
+#define OP_EQUALJUMP            0xa2  // 'e' 'p' 'o' 'k'
+#define OP_NOTEQUALJUMP         0xa3  // 'e' 'p' 'q' 'k'
+#define OP_LESSTHANJUMP         0xa4  // 'e' 'p' 'r' 'k'
+#define OP_GREATERTHANJUMP      0xa5  // 'e' 'p' 't' 'k'
+#define OP_LESSTHANOREQUALJUMP  0xa6  // 'e' 'p' 'u' 'k'
+#define OP_GREATERTHANOREQUALJUMP 0xa7  // 'e' 'p' 'v' 'k'
+
+typedef struct Assembly ASSEMBLY_t;
+
+// One layer of an item name, as described by the 'L' and 'D' opcodes
+// between an 'I' and its matching 'E'.
+typedef struct {
+  uint8_t type;         // 'L' (literal), 'V' (local) or 'I' (item)
+  uint8_t len;          // Length of a literal layer name
+  uint8_t local;        // Local variable index of a 'V' layer
+  const char *name;     // Literal layer name (NOT null-terminated)
+  ASSEMBLY_t *item;     // Nested item of an 'I' layer
+} LAYER_t;
+
+struct Assembly {
+  uint8_t count;        // Number of layers
+  LAYER_t *layer;       // The layers themselves
+  STRING_t *name;       // Full item name if every layer is a literal
+  ITEM_CACHE_t cache;   // The item of that name, when last looked up
+};
+
+// A single pre-decoded instruction.
+typedef struct Instr {
+  const void *handler;  // Where the interpreter goes to execute this
+  uint8_t *raw;         // Operands in the original bytecode
+  union {
+    VALUE_t value;      // 'p' - the integer to push, as a value
+    STRING_t *s;        // 'l' - the string literal
+    int32_t target;     // 'j', 'k' - index of the instruction to jump to
+    uint8_t local;      // 'c', 'e', 'f', 'g', 'N' - local variable index
+    OP_t libcall;       // 'A' - the library function
+    ASSEMBLY_t *assembly; // 'I' - the item name to assemble
+  };
+  uint32_t n;           // 'F' - argument count, 'A' - number of arguments
+  uint8_t op;           // The opcode
+  uint8_t misses;       // Times a quickened form has been put back
+} INSTR_t;
+
+typedef struct Decoded {
+  uint32_t count;       // Number of instructions
+  INSTR_t *instr;       // The instructions, or NULL if not decodable
+  const void **linked;  // The handlers filled in, or NULL if not yet
+  uint32_t heat;        // Calls and turns of loops, counted towards JIT
+  struct Native *native; // The instructions as machine code, or NULL
+} DECODED_t;
+
+DECODED_t *decode_bytecode(uint8_t *bytecode, uint32_t len);
+void link_decoded(DECODED_t *code, const void **handlers);
+void free_decoded(DECODED_t *code);
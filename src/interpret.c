@@ -5,6 +5,7 @@
 #include <string.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <signal.h>
 
 #include "config.h"
 #include "error.h"
@@ -17,6 +18,10 @@
 #include "value.h"
 #include "stack.h"
 #include "item.h"
+#include "decode.h"
+#include "jit.h"
+#include "journal.h"
+#include "profile.h"
 
 // The configuration object, defined in sin.c
 extern CONFIG_t config;
@@ -24,6 +29,13 @@ extern CONFIG_t config;
 // Some shorthand
 #define VM config.vm
 
+// Threaded dispatch relies on the GCC "labels as values" extension.  If
+// it is not available (or if we are tracing every opcode), fall back to
+// calling through the opcode table.
+#if defined(THREADED_DISPATCH) && defined(__GNUC__) && !defined(DISASS)
+#define COMPUTED_GOTO
+#endif
+
 static OP_t opcode[256];
 
 uint8_t *op_nop(uint8_t *nextop, ITEM_t *item) {
@@ -38,20 +50,18 @@ uint8_t *op_undefined(uint8_t *nextop, ITEM_t *item) {
 uint8_t *op_pushint(uint8_t *nextop, ITEM_t *item) {
   // Push an int64 onto the stack.
   // Read the next 8 bytes and make an VALUE_t
-  VALUE_t v;
-  v.type = VALUE_int;
-  v.i = *(int64_t*)nextop;
+  VALUE_t v = INT_VALUE(*(int64_t*)nextop);
   push_stack(VM->stack, v);
-  DISASS_LOG("OP_PUSHINT: %ld\n", v.i);
+  DISASS_LOG("OP_PUSHINT: %ld\n", AS_INT(v));
   return nextop+8;
 }
 
 uint8_t *op_inclocal(uint8_t *nextop, ITEM_t *item) {
   // Interpret the next byte as an index into the locals.
   // If that local is an int, increment it.  Otherwise complain.
-  uint8_t index = *nextop + VM->stack->base;
-  if (VM->stack->stack[index].type == VALUE_int) {
-    VM->stack->stack[index].i++;
+  int32_t index = *nextop + VM->stack->base;
+  if (IS_INT(VM->stack->stack[index])) {
+    VM->stack->stack[index] = INT_VALUE(AS_INT(VM->stack->stack[index]) + 1);
   } else {
     logerr("Trying to increment non integer local variable.\n");
   }
@@ -62,9 +72,9 @@ uint8_t *op_inclocal(uint8_t *nextop, ITEM_t *item) {
 uint8_t *op_declocal(uint8_t *nextop, ITEM_t *item) {
   // Interpret the next byte as an index into the locals.
   // If that local is an int, decrement it.  Otherwise complain.
-  uint8_t index = *nextop + VM->stack->base;
-  if (VM->stack->stack[index].type == VALUE_int) {
-    VM->stack->stack[index].i--;
+  int32_t index = *nextop + VM->stack->base;
+  if (IS_INT(VM->stack->stack[index])) {
+    VM->stack->stack[index] = INT_VALUE(AS_INT(VM->stack->stack[index]) - 1);
   } else {
     logerr("Trying to decrement non integer local variable.\n");
   }
@@ -91,8 +101,7 @@ uint8_t *op_jumpfalse(uint8_t *nextop, ITEM_t *item) {
   v1 = pop_stack(VM->stack);
   // "true" is a true bool value, or an int value != 0, or a string
   // which is not empty.  Everything else is false.
-  if (((v1.type == VALUE_bool || v1.type == VALUE_int) && v1.i != 0)
-      || (v1.type == VALUE_str && v1.s[0] != '\0')) {
+  if (IS_TRUE(v1) || (IS_STR(v1) && AS_STR(v1)->len > 0)) {
     // A true value means that we don't branch.  Skip over
     // the next two bytes.
     DISASS_LOG("OP_JUMPFALSE: evaluates to true (no jump).\n");
@@ -110,15 +119,15 @@ uint8_t *op_jumpfalse(uint8_t *nextop, ITEM_t *item) {
 uint8_t *op_savelocal(uint8_t *nextop, ITEM_t *item) {
   // This is the quickest way, without extra pushes and pops.
   // Interpret the next byte as an index into the stack.
-  uint8_t index = *nextop + VM->stack->base;
-  // First check if the current value is a string.  If so, free it.
-  if (VM->stack->stack[index].type == VALUE_str) {
-    free(VM->stack->stack[index].s);
-  }
+  int32_t index = *nextop + VM->stack->base;
+  // First check if the current value is a string.  If so, release it.
+  FREE_STR(VM->stack->stack[index]);
   // Then copy the top of the stack into that location.
   memcpy(&(VM->stack->stack[index]), &(VM->stack->stack[VM->stack->current]),
                                                     sizeof(VALUE_t));
-  // Then reduce the size of the stack.
+  // Then reduce the size of the stack, making sure the vacated slot no
+  // longer claims ownership of a string which now belongs to the local.
+  VM->stack->stack[VM->stack->current] = VALUE_NIL;
   VM->stack->current--;
   DISASS_LOG("OP_SAVELOCAL: index %d\n", index);
   return nextop+1;
@@ -127,29 +136,28 @@ uint8_t *op_savelocal(uint8_t *nextop, ITEM_t *item) {
 uint8_t *op_getlocal(uint8_t *nextop, ITEM_t *item) {
   // This is the quickest way, without extra pushes and pops.
   // Interpret the next byte as an index into the stack.
-  uint8_t index = *nextop + VM->stack->base;
+  int32_t index = *nextop + VM->stack->base;
 
   // Then increase the size of the stack.
   VM->stack->current++;
   // Then copy that location to the top of the stack.
   memcpy(&(VM->stack->stack[VM->stack->current]), &(VM->stack->stack[index]),
                                                     sizeof(VALUE_t));
-  // Remember to copy the string if necessary.
-  if (VM->stack->stack[VM->stack->current].type == VALUE_str) {
-    VM->stack->stack[VM->stack->current].s = strdup(VM->stack->stack[index].s);
-  }
+  // The local and the stack now share any string.
+  COPY_STR(VM->stack->stack[index]);
 #ifdef DISASS
   VALUE_t v;
   v = peek_stack(VM->stack);
-  switch (v.type) {
+  switch (VALUE_TYPE(v)) {
     case VALUE_int:
-      DISASS_LOG("OP_GETLOCAL: index %d value %d.\n", index, v.i);
+      DISASS_LOG("OP_GETLOCAL: index %d value %ld.\n", index, AS_INT(v));
       break;
     case VALUE_str:
-      DISASS_LOG("OP_GETLOCAL: index %d value '%s'.\n", index, v.s);
+      DISASS_LOG("OP_GETLOCAL: index %d value '%s'.\n", index,
+                                                    STRING_CHARS(AS_STR(v)));
       break;
     default:
-      DISASS_LOG("OP_GETLOCAL: index %d type %d.\n", index, v.type);
+      DISASS_LOG("OP_GETLOCAL: index %d type %d.\n", index, VALUE_TYPE(v));
   }
 #endif
   return nextop+1;
@@ -157,17 +165,13 @@ uint8_t *op_getlocal(uint8_t *nextop, ITEM_t *item) {
 
 uint8_t *op_pushstr(uint8_t *nextop, ITEM_t *item) {
   // Push a string literal onto the stack.
-  VALUE_t v;
-  v.type = VALUE_str;
   uint16_t len;
   // Get the length
   memcpy(&len, nextop, 2);
   nextop += 2;
-  v.s = GROW_ARRAY(char, NULL, 0, len+1);
-  memcpy(v.s, nextop, len);
-  v.s[len] = 0;
+  VALUE_t v = STR_VALUE(make_string((char *)nextop, len));
   push_stack(VM->stack, v);
-  DISASS_LOG("OP_PUSHSTR: %s\n", v.s);
+  DISASS_LOG("OP_PUSHSTR: %s\n", STRING_CHARS(AS_STR(v)));
   return nextop + len;
 }
 
@@ -179,31 +183,21 @@ uint8_t *op_add(uint8_t *nextop, ITEM_t *item) {
   v1 = pop_stack(VM->stack);
   v2 = pop_stack(VM->stack);
   // It makes sense to treat nil as 0 in this context.
-  if ((v1.type == VALUE_nil || v1.type == VALUE_int) &&
-                            (v2.type==VALUE_nil || v2.type == VALUE_int)) {
-    v2.i += v1.i;
-    v2.type = VALUE_int;
-    push_stack(VM->stack, v2);
-  } else if (v1.type == VALUE_str && v2.type == VALUE_str) {
-    char *newstring;
-    newstring = GROW_ARRAY(char, NULL, 0, strlen(v1.s) + strlen(v2.s) + 1);
-    memcpy(newstring, v2.s, strlen(v2.s));
-    memcpy(newstring + strlen(v2.s), v1.s, strlen(v1.s) + 1);
-    FREE_ARRAY(char, v1.s, strlen(v1.s) + 1);
-    FREE_ARRAY(char, v2.s, strlen(v2.s) + 1);
-    v2.s = newstring;
-    push_stack(VM->stack, v2);
+  if ((IS_NIL(v1) || IS_INT(v1)) &&
+                            (IS_NIL(v2) || IS_INT(v2))) {
+    // Nil is all zero bits, so AS_INT() gives 0 for it.
+    push_stack(VM->stack, INT_VALUE(AS_INT(v2) + AS_INT(v1)));
+  } else if (IS_STR(v1) && IS_STR(v2)) {
+    // Long strings are not copied until they are needed in one piece.
+    push_stack(VM->stack, STR_VALUE(concat_strings(AS_STR(v2), AS_STR(v1))));
   } else {
-    if (v1.type == VALUE_str) {
-      free(v1.s);
-    }
-    if (v2.type == VALUE_str) {
-      free(v2.s);
-    }
-    logerr("Trying to add mismatched types '%c' and '%c'.  Result is NIL.\n", v1.type, v2.type);
+    FREE_STR(v1);
+    FREE_STR(v2);
+    logerr("Trying to add mismatched types '%c' and '%c'.  Result is NIL.\n",
+                                              VALUE_TYPE(v1), VALUE_TYPE(v2));
     push_stack(VM->stack, VALUE_NIL);
   }
-  DISASS_LOG("OP_ADD: types %d and %d\n", v1.type, v2.type);
+  DISASS_LOG("OP_ADD: types %d and %d\n", VALUE_TYPE(v1), VALUE_TYPE(v2));
   return nextop;
 }
 
@@ -214,18 +208,14 @@ uint8_t *op_subtract(uint8_t *nextop, ITEM_t *item) {
   VALUE_t v1, v2;
   v1 = pop_stack(VM->stack);
   v2 = pop_stack(VM->stack);
-  if (v1.type == VALUE_int && v1.type == VALUE_int) {
-    v2.i -= v1.i;
-    v2.type = VALUE_int;
-    DISASS_LOG("OP_SUB: values %d and %d\n", v1.type, v2.type);
+  if (IS_INT(v1) && IS_INT(v2)) {
+    v2 = INT_VALUE(AS_INT(v2) - AS_INT(v1));
+    DISASS_LOG("OP_SUB: values %ld and %ld\n", AS_INT(v1), AS_INT(v2));
   } else {
-    DISASS_LOG("OP_SUB: invalid types %d and %d\n", v1.type, v2.type);
-    if (v1.type == VALUE_str) {
-      FREE_ARRAY(char, v1.s, strlen(v1.s) + 1);
-    }
-    if (v2.type == VALUE_str) {
-      FREE_ARRAY(char, v2.s, strlen(v2.s) + 1);
-    }
+    DISASS_LOG("OP_SUB: invalid types %d and %d\n", VALUE_TYPE(v1),
+                                                            VALUE_TYPE(v2));
+    FREE_STR(v1);
+    FREE_STR(v2);
     v2 = VALUE_NIL;
   }
   push_stack(VM->stack, v2);
@@ -240,25 +230,21 @@ uint8_t *op_divide(uint8_t *nextop, ITEM_t *item) {
   VALUE_t v1, v2;
   v1 = pop_stack(VM->stack);
   v2 = pop_stack(VM->stack);
-  if (v1.type == VALUE_int && v1.type == VALUE_int) {
-    if (v1.i == 0) {
+  if (IS_INT(v1) && IS_INT(v2)) {
+    if (AS_INT(v1) == 0) {
       logerr("Attempt to divide by zero.  Substitute zero as result.\n");
-      v2.i = 0;
+      v2 = VALUE_ZERO;
     } else {
-      v2.i /= v1.i;
+      v2 = INT_VALUE(AS_INT(v2) / AS_INT(v1));
     }
-    DISASS_LOG("OP_DIV: values %d and %d\n", v1.type, v2.type);
+    DISASS_LOG("OP_DIV: values %ld and %ld\n", AS_INT(v1), AS_INT(v2));
   } else {
-    DISASS_LOG("OP_DIV: invalid types %d and %d\n", v1.type, v2.type);
-    if (v1.type == VALUE_str) {
-      FREE_ARRAY(char, v1.s, strlen(v1.s) + 1);
-    }
-    if (v2.type == VALUE_str) {
-      FREE_ARRAY(char, v2.s, strlen(v2.s) + 1);
-    }
-    v2 = VALUE_NIL;
+    DISASS_LOG("OP_DIV: invalid types %d and %d\n", VALUE_TYPE(v1),
+                                                            VALUE_TYPE(v2));
+    FREE_STR(v1);
+    FREE_STR(v2);
+    v2 = VALUE_ZERO;
   }
-  v2.type = VALUE_int;
   push_stack(VM->stack, v2);
   return nextop;
 }
@@ -269,18 +255,14 @@ uint8_t *op_multiply(uint8_t *nextop, ITEM_t *item) {
   VALUE_t v1, v2;
   v1 = pop_stack(VM->stack);
   v2 = pop_stack(VM->stack);
-  if (v1.type == VALUE_int && v1.type == VALUE_int) {
-    v2.i *= v1.i;
-    v2.type = VALUE_int;
-    DISASS_LOG("OP_MUL: values %d and %d\n", v1.type, v2.type);
+  if (IS_INT(v1) && IS_INT(v2)) {
+    v2 = INT_VALUE(AS_INT(v2) * AS_INT(v1));
+    DISASS_LOG("OP_MUL: values %ld and %ld\n", AS_INT(v1), AS_INT(v2));
   } else {
-    DISASS_LOG("OP_MUL: invalid types %d and %d\n", v1.type, v2.type);
-    if (v1.type == VALUE_str) {
-      FREE_ARRAY(char, v1.s, strlen(v1.s) + 1);
-    }
-    if (v2.type == VALUE_str) {
-      FREE_ARRAY(char, v2.s, strlen(v2.s) + 1);
-    }
+    DISASS_LOG("OP_MUL: invalid types %d and %d\n", VALUE_TYPE(v1),
+                                                            VALUE_TYPE(v2));
+    FREE_STR(v1);
+    FREE_STR(v2);
     v2 = VALUE_NIL;
   }
   push_stack(VM->stack, v2);
@@ -290,13 +272,13 @@ uint8_t *op_multiply(uint8_t *nextop, ITEM_t *item) {
 uint8_t *op_negate(uint8_t *nextop, ITEM_t *item) {
   // If the top value on the stack is an int, negate it.
   //  Complain bitterly if not.
-  if (VM->stack->stack[VM->stack->current].type == VALUE_int) {
-    VM->stack->stack[VM->stack->current].i = -VM->stack->stack[VM->stack->current].i;
+  VALUE_t *top = &VM->stack->stack[VM->stack->current];
+  if (IS_INT(*top)) {
+    *top = INT_VALUE(-AS_INT(*top));
   } else {
-    logerr("Attempt to negate a value of type '%d'.\n",
-                                 VM->stack->stack[VM->stack->current].type);
+    logerr("Attempt to negate a value of type '%d'.\n", VALUE_TYPE(*top));
   }
-  DISASS_LOG("OP_NEGATE: type %d\n", VM->stack->stack[VM->stack->current].type);
+  DISASS_LOG("OP_NEGATE: type %d\n", VALUE_TYPE(*top));
   return nextop;
 }
 
@@ -304,58 +286,64 @@ uint8_t *op_equal(uint8_t *nextop, ITEM_t *item) {
   // Compare the top two items on the stack and push back a VALUE_bool
   // that is either true or false.  Be sensible about what is equal.
   // At the moment pairs of bools, ints, or strings are considered.
-  VALUE_t v1, v2, result;
+  VALUE_t v1, v2;
   v1 = pop_stack(VM->stack);
   v2 = pop_stack(VM->stack);
-  result.type = VALUE_bool;
-  result.i = 1; // default to true
-  if (v1.type == VALUE_int && v2.type == VALUE_int && v1.i == v2.i) {
-    push_stack(VM->stack, result);
+  if (IS_INT(v1) && IS_INT(v2) && AS_INT(v1) == AS_INT(v2)) {
+    push_stack(VM->stack, VALUE_TRUE);
     return nextop;
-  } else if (v1.type == VALUE_str && v2.type == VALUE_str &&
-                                                strcmp(v1.s, v2.s) == 0) {
-    push_stack(VM->stack, result);
+  } else if (IS_STR(v1) && IS_STR(v2) &&
+                                    strings_equal(AS_STR(v1), AS_STR(v2))) {
+    release_string(AS_STR(v1));
+    release_string(AS_STR(v2));
+    push_stack(VM->stack, VALUE_TRUE);
     return nextop;
-  } else if (v1.type == VALUE_bool && v2.type == VALUE_bool
-                                                   && v1.i == v2.i) {
-    push_stack(VM->stack, result);
+  } else if (IS_BOOL(v1) && IS_BOOL(v2)
+                                         && AS_BOOL(v1) == AS_BOOL(v2)) {
+    push_stack(VM->stack, VALUE_TRUE);
     return nextop;
   } 
   // If we get here, there is no equality
-  result.i = 0;
-  push_stack(VM->stack, result);
-  DISASS_LOG("OP_EQUAL: types %d and %d\n", v1.type, v2.type);
+  FREE_STR(v1);
+  FREE_STR(v2);
+  push_stack(VM->stack, VALUE_FALSE);
+  DISASS_LOG("OP_EQUAL: types %d and %d\n", VALUE_TYPE(v1),
+                                                            VALUE_TYPE(v2));
   return nextop;
 }
 
 uint8_t *op_notequal(uint8_t *nextop, ITEM_t *item) {
   // The logical reverse of op_equal.
   // Note that mismatched types are always not equal.
-  VALUE_t v1, v2, result;
+  VALUE_t v1, v2;
   v1 = pop_stack(VM->stack);
   v2 = pop_stack(VM->stack);
-  result.type = VALUE_bool;
-  result.i = 1; // default to false
-  if (v1.type == VALUE_int && v2.type == VALUE_int && v1.i != v2.i) {
-    push_stack(VM->stack, result);
+  if (IS_INT(v1) && IS_INT(v2) && AS_INT(v1) != AS_INT(v2)) {
+    push_stack(VM->stack, VALUE_TRUE);
     return nextop;
-  } else if (v1.type == VALUE_str && v2.type == VALUE_str &&
-                                                strcmp(v1.s, v2.s) != 0) {
-    push_stack(VM->stack, result);
+  } else if (IS_STR(v1) && IS_STR(v2) &&
+                                   !strings_equal(AS_STR(v1), AS_STR(v2))) {
+    release_string(AS_STR(v1));
+    release_string(AS_STR(v2));
+    push_stack(VM->stack, VALUE_TRUE);
     return nextop;
-  } else if (v1.type == VALUE_bool && v2.type == VALUE_bool
-                                                   && v1.i != v2.i) {
-    push_stack(VM->stack, result);
+  } else if (IS_BOOL(v1) && IS_BOOL(v2)
+                                         && AS_BOOL(v1) != AS_BOOL(v2)) {
+    push_stack(VM->stack, VALUE_TRUE);
     return nextop;
-  } else if (v1.type != v2.type) {
+  } else if (VALUE_TYPE(v1) != VALUE_TYPE(v2)) {
     // If the types do not match, there is no equality
-    push_stack(VM->stack, result);
+    FREE_STR(v1);
+    FREE_STR(v2);
+    push_stack(VM->stack, VALUE_TRUE);
     return nextop;
   }
   // If we get here there is equality, so return false.
-  result.i = 0;
-  push_stack(VM->stack, result);
-  DISASS_LOG("OP_NOTEQUAL: types %d and %d\n", v1.type, v2.type);
+  FREE_STR(v1);
+  FREE_STR(v2);
+  push_stack(VM->stack, VALUE_FALSE);
+  DISASS_LOG("OP_NOTEQUAL: types %d and %d\n", VALUE_TYPE(v1),
+                                                            VALUE_TYPE(v2));
   return nextop;
 }
 
@@ -363,23 +351,21 @@ uint8_t *op_lessthan(uint8_t *nextop, ITEM_t *item) {
   // Compare the top two items on the stack and push back a VALUE_bool
   // that is either true or false.
   // At the moment pairs of bools or ints are considered.
-  VALUE_t v1, v2, result;
+  VALUE_t v1, v2;
   v1 = pop_stack(VM->stack);
   v2 = pop_stack(VM->stack);
-  result.type = VALUE_bool;
-  result.i = 1; // default to true
-  if (v1.type == VALUE_int && v2.type == VALUE_int && v2.i < v1.i) {
-    push_stack(VM->stack, result);
+  if (IS_INT(v1) && IS_INT(v2) && AS_INT(v2) < AS_INT(v1)) {
+    push_stack(VM->stack, VALUE_TRUE);
     return nextop;
-  } else if (v1.type == VALUE_bool && v2.type == VALUE_bool
-                                                   && v2.i < v1.i) {
-    push_stack(VM->stack, result);
+  } else if (IS_BOOL(v1) && IS_BOOL(v2)
+                                         && AS_BOOL(v2) < AS_BOOL(v1)) {
+    push_stack(VM->stack, VALUE_TRUE);
     return nextop;
   } 
   // If we get here the comparison is false
-  result.i = 0;
-  push_stack(VM->stack, result);
-  DISASS_LOG("OP_LESSTHAN: types %d and %d\n", v1.type, v2.type);
+  push_stack(VM->stack, VALUE_FALSE);
+  DISASS_LOG("OP_LESSTHAN: types %d and %d\n", VALUE_TYPE(v1),
+                                                            VALUE_TYPE(v2));
   return nextop;
 }
 
@@ -387,23 +373,21 @@ uint8_t *op_lessthanorequal(uint8_t *nextop, ITEM_t *item) {
   // Compare the top two items on the stack and push back a VALUE_bool
   // that is either true or false.
   // At the moment pairs of bools or ints are considered.
-  VALUE_t v1, v2, result;
+  VALUE_t v1, v2;
   v1 = pop_stack(VM->stack);
   v2 = pop_stack(VM->stack);
-  result.type = VALUE_bool;
-  result.i = 1; // default to true
-  if (v1.type == VALUE_int && v2.type == VALUE_int && v2.i <= v1.i) {
-    push_stack(VM->stack, result);
+  if (IS_INT(v1) && IS_INT(v2) && AS_INT(v2) <= AS_INT(v1)) {
+    push_stack(VM->stack, VALUE_TRUE);
     return nextop;
-  } else if (v1.type == VALUE_bool && v2.type == VALUE_bool
-                                                   && v2.i <= v1.i) {
-    push_stack(VM->stack, result);
+  } else if (IS_BOOL(v1) && IS_BOOL(v2)
+                                         && AS_BOOL(v2) <= AS_BOOL(v1)) {
+    push_stack(VM->stack, VALUE_TRUE);
     return nextop;
   } 
   // If we get here the comparison is false
-  result.i = 0;
-  push_stack(VM->stack, result);
-  DISASS_LOG("OP_LTEQ: types %d and %d\n", v1.type, v2.type);
+  push_stack(VM->stack, VALUE_FALSE);
+  DISASS_LOG("OP_LTEQ: types %d and %d\n", VALUE_TYPE(v1),
+                                                            VALUE_TYPE(v2));
   return nextop;
 }
 
@@ -411,23 +395,21 @@ uint8_t *op_greaterthan(uint8_t *nextop, ITEM_t *item) {
   // Compare the top two items on the stack and push back a VALUE_bool
   // that is either true or false.
   // At the moment pairs of bools or ints are considered.
-  VALUE_t v1, v2, result;
+  VALUE_t v1, v2;
   v1 = pop_stack(VM->stack);
   v2 = pop_stack(VM->stack);
-  result.type = VALUE_bool;
-  result.i = 1; // default to true
-  if (v1.type == VALUE_int && v2.type == VALUE_int && v2.i > v1.i) {
-    push_stack(VM->stack, result);
+  if (IS_INT(v1) && IS_INT(v2) && AS_INT(v2) > AS_INT(v1)) {
+    push_stack(VM->stack, VALUE_TRUE);
     return nextop;
-  } else if (v1.type == VALUE_bool && v2.type == VALUE_bool
-                                                   && v2.i > v1.i) {
-    push_stack(VM->stack, result);
+  } else if (IS_BOOL(v1) && IS_BOOL(v2)
+                                         && AS_BOOL(v2) > AS_BOOL(v1)) {
+    push_stack(VM->stack, VALUE_TRUE);
     return nextop;
   } 
   // If we get here the comparison is false
-  result.i = 0;
-  push_stack(VM->stack, result);
-  DISASS_LOG("OP_GREATERTHAN: types %d and %d\n", v1.type, v2.type);
+  push_stack(VM->stack, VALUE_FALSE);
+  DISASS_LOG("OP_GREATERTHAN: types %d and %d\n", VALUE_TYPE(v1),
+                                                            VALUE_TYPE(v2));
   return nextop;
 }
 
@@ -435,23 +417,21 @@ uint8_t *op_greaterthanorequal(uint8_t *nextop, ITEM_t *item) {
   // Compare the top two items on the stack and push back a VALUE_bool
   // that is either true or false.
   // At the moment pairs of bools or ints are considered.
-  VALUE_t v1, v2, result;
+  VALUE_t v1, v2;
   v1 = pop_stack(VM->stack);
   v2 = pop_stack(VM->stack);
-  result.type = VALUE_bool;
-  result.i = 1; // default to true
-  if (v1.type == VALUE_int && v2.type == VALUE_int && v2.i >= v1.i) {
-    push_stack(VM->stack, result);
+  if (IS_INT(v1) && IS_INT(v2) && AS_INT(v2) >= AS_INT(v1)) {
+    push_stack(VM->stack, VALUE_TRUE);
     return nextop;
-  } else if (v1.type == VALUE_bool && v2.type == VALUE_bool
-                                                   && v2.i >= v1.i) {
-    push_stack(VM->stack, result);
+  } else if (IS_BOOL(v1) && IS_BOOL(v2)
+                                         && AS_BOOL(v2) >= AS_BOOL(v1)) {
+    push_stack(VM->stack, VALUE_TRUE);
     return nextop;
   } 
   // If we get here the comparison is false
-  result.i = 0;
-  push_stack(VM->stack, result);
-  DISASS_LOG("OP_GTEQ: types %d and %d\n", v1.type, v2.type);
+  push_stack(VM->stack, VALUE_FALSE);
+  DISASS_LOG("OP_GTEQ: types %d and %d\n", VALUE_TYPE(v1),
+                                                            VALUE_TYPE(v2));
   return nextop;
 }
 
@@ -459,32 +439,24 @@ uint8_t *op_logicalnot(uint8_t *nextop, ITEM_t *item) {
   // Logically negate the value on top of the stack.
   // Note that this operation CONVERTS the value on top of the stack to a
   // VALUE_bool if it is not already.
-  switch (VM->stack->stack[VM->stack->current].type) {
+  VALUE_t *top = &VM->stack->stack[VM->stack->current];
+  switch (VALUE_TYPE(*top)) {
     case VALUE_bool:
-      VM->stack->stack[VM->stack->current].i =
-                                  !(VM->stack->stack[VM->stack->current].i);
+      *top = BOOL_VALUE(!AS_BOOL(*top));
       break;
     case VALUE_int:
       // If the int value is nonzero, then false, else true.
-      VM->stack->stack[VM->stack->current].type = VALUE_bool;
-      if (VM->stack->stack[VM->stack->current].i) {
-        VM->stack->stack[VM->stack->current].i = 0;
-      } else {
-        VM->stack->stack[VM->stack->current].i = 1;
-      }
+      *top = BOOL_VALUE(AS_INT(*top) == 0);
       break;
     case VALUE_nil:
       // A logically-negated nil value is always true
-      VM->stack->stack[VM->stack->current].type = VALUE_bool;
-      VM->stack->stack[VM->stack->current].i = 1;
+      *top = VALUE_TRUE;
       break;
     case VALUE_str:
       // A logically-negated string value is always false
       // Tidy up the old string value
-      FREE_ARRAY(char, VM->stack->stack[VM->stack->current].s,
-                        strlen(VM->stack->stack[VM->stack->current].s) + 1);
-      VM->stack->stack[VM->stack->current].type = VALUE_bool;
-      VM->stack->stack[VM->stack->current].i = 0;
+      release_string(AS_STR(*top));
+      *top = VALUE_FALSE;
       break;
   }
   return nextop;
@@ -496,7 +468,7 @@ uint8_t *op_logicaland(uint8_t *nextop, ITEM_t *item) {
   VALUE_t v1 = convert_to_bool(pop_stack(VM->stack));
   VALUE_t v2 = convert_to_bool(pop_stack(VM->stack));
   // v2 is guaranteed to be boolean now, whatever it was.
-  v2.i = v1.i && v2.i; // Logical AND
+  v2 = BOOL_VALUE(AS_BOOL(v1) && AS_BOOL(v2)); // Logical AND
   push_stack(VM->stack, v2);
   return nextop;
 }
@@ -507,7 +479,7 @@ uint8_t *op_logicalor(uint8_t *nextop, ITEM_t *item) {
   VALUE_t v1 = convert_to_bool(pop_stack(VM->stack));
   VALUE_t v2 = convert_to_bool(pop_stack(VM->stack));
   // v2 is guaranteed to be boolean now, whatever it was.
-  v2.i = v1.i || v2.i; // Logical OR
+  v2 = BOOL_VALUE(AS_BOOL(v1) || AS_BOOL(v2)); // Logical OR
   push_stack(VM->stack, v2);
   return nextop;
 }
@@ -538,22 +510,42 @@ void assignitem(VALUE_t *itemname, VALUE_t val) {
   // value to be saved has memory allocated to it, that must be freed.
   // In other words, this is an end stage for values - they are either
   // used or discarded.  The interpreter no longer cares.
-  if (itemname->type == VALUE_str) {
-    ITEM_t *i = insert_item(config.itemroot, itemname->s, val);
+  if (IS_STR(*itemname)) {
+    ITEM_t *i = insert_item(config.itemroot, STRING_CHARS(AS_STR(*itemname)), val);
     if (!i) {
-      logerr("Unable to create item '%s'.\n", itemname->s);
-      if (val.type == VALUE_str) {
-        FREE_ARRAY(char, val.s, strlen(val.s));
-      }
+      logerr("Unable to create item '%s'.\n", STRING_CHARS(AS_STR(*itemname)));
+      FREE_STR(val);
+    }
+    ITEMDEBUG_LOG("Saved value of type %d in item %s\n", VALUE_TYPE(val), STRING_CHARS(AS_STR(*itemname)));
+  } else {
+    logerr("Unable to create item: invalid name type %d\n", VALUE_TYPE(*itemname));
+    FREE_STR(val);
+  }
+  FREE_STR(*itemname);
+}
+
+void assignitem_static(ASSEMBLY_t *assembly, VALUE_t val) {
+  // As assignitem(), but for an item whose name was known when the code
+  // was decoded.  If it is already a value item, just replace the value.
+  ITEM_t *i = find_item_cached(config.itemroot, assembly->name->chars,
+                                                        &assembly->cache);
+  if (i && i->type == ITEM_value) {
+    FREE_STR(i->value);
+    if (IS_STR(val)) {
+      // Items keep their strings in one piece.
+      STRING_CHARS(AS_STR(val));
     }
-    ITEMDEBUG_LOG("Saved value of type %d in item %s\n", val.type, itemname->s);
+    i->value = val;
+    mark_changed(i);
+    journal_insert(assembly->name->chars, val);
   } else {
-    logerr("Unable to create item: invalid name type %d\n", itemname->type);
-    if (val.type == VALUE_str) {
-      FREE_ARRAY(char, val.s, strlen(val.s));
+    i = insert_item(config.itemroot, assembly->name->chars, val);
+    if (!i) {
+      logerr("Unable to create item '%s'.\n", assembly->name->chars);
+      FREE_STR(val);
     }
   }
-  FREE_ARRAY(char, itemname->s, strlen(itemname->s));
+  ITEMDEBUG_LOG("Saved value of type %d in item %s\n", VALUE_TYPE(val), assembly->name->chars);
 }
 
 uint8_t *op_assigncodeitem(uint8_t *nextop, ITEM_t *item) {
@@ -617,7 +609,7 @@ uint8_t *op_assigncodeitem(uint8_t *nextop, ITEM_t *item) {
   // check to see if the item is in use - if it is, we can't
   // overwrite it.
   bool result;
-  ITEM_t *testitem = find_item(config.itemroot, itemname.s);
+  ITEM_t *testitem = find_item(config.itemroot, STRING_CHARS(AS_STR(itemname)));
   if (testitem && testitem->inuse) {
     char name[MAX_ITEM_NAME];
     get_itemname(testitem, name);
@@ -631,7 +623,7 @@ uint8_t *op_assigncodeitem(uint8_t *nextop, ITEM_t *item) {
     // Compilation succeeded.  Assign it to the item.
     // The item type is ITEM_code.
     uint32_t len = out->nextbyte - out->bytecode;
-    ITEM_t *item = insert_code_item(config.itemroot, itemname.s, len,
+    ITEM_t *item = insert_code_item(config.itemroot, STRING_CHARS(AS_STR(itemname)), len,
                                                             out->bytecode);
     // Now reconstruct the source code and save it to srcroot.
     plen += 2 * (local.param_count - 1);
@@ -677,7 +669,7 @@ uint8_t *op_assigncodeitem(uint8_t *nextop, ITEM_t *item) {
   // Clean up.
   FREE_ARRAY(OUTPUT_t, out, 1);
   FREE_ARRAY(char, sourcecode, sclen + 1);
-  FREE_ARRAY(char, itemname.s, strlen(itemname.s));
+  FREE_STR(itemname);
   for (int l = 0; l < local.count; l++) {
     free(local.id[l]);
   }
@@ -692,6 +684,75 @@ uint8_t *op_assignitem(uint8_t *nextop, ITEM_t *item) {
   return nextop;
 }
 
+static void fit_arguments(uint16_t given, uint8_t wanted) {
+  // Make the arguments on top of the stack fit the item they are passed
+  // to.  Any it doesn't take are lost, and any it is missing are nil.
+  STACK_t *stack = VM->stack;
+  if (given > wanted) {
+    DEBUG_LOG("Popping %d unneeded argument(s).\n", given - wanted);
+    reset_stack_to(stack, stack->current - (given - wanted));
+  } else if (given < wanted) {
+    DEBUG_LOG("Pushing %d nil-value argument(s).\n", wanted - given);
+    if (stack->current + wanted - given > stack->max) {
+      logerr("Stack overflow.\n");
+      raise(SIGUSR1);
+    }
+    while (given++ < wanted) {
+      stack->stack[++stack->current] = VALUE_NIL;
+    }
+  }
+}
+
+#ifndef DISASS
+DECODED_t *decoded_code(ITEM_t *item) {
+  // Items are normally decoded when their code is assigned, but those
+  // loaded from the itemstore wait until they are first run, and some
+  // (such as the boot item) are put together by hand.
+  if (!item->decoded) {
+    item->decoded = decode_bytecode(item->bytecode, item->bytecode_len);
+  }
+  return item->decoded;
+}
+#endif
+
+void fetchitem(ITEM_t *i, const char *itemname, uint16_t arg_count,
+                                          uint8_t *nextop, ITEM_t *item) {
+  // Push the value of an item which has been looked up.  If it is a code
+  // item, it is executed with the arguments on the stack, and the result
+  // is pushed instead.  If the item does not exist, nil is pushed.
+  if (i) {
+    ITEMDEBUG_LOG("Fetched item %s (called with %d arguments).\n", itemname, arg_count);
+    // Just push the item value onto the stack.
+    if (i->type == ITEM_value) {
+      // The item and the stack share any string.
+      COPY_STR(i->value);
+      push_stack(VM->stack, i->value);
+    } else {
+      fit_arguments(arg_count, i->bytecode[1]);
+      // Save our current state.
+      // We pass the number of arguments, so that the stack is
+      // correctly adjusted to account for them at the top of the
+      // current stack (they will be at the bottom of the frame for
+      // the new item).
+      push_callstack(item, nextop, i->bytecode[1]);
+      // Execute the item.
+      ITEMDEBUG_LOG("Executing item %s\n", i->name);
+      VALUE_t value = interpret(i);
+      // Now go back to the status quo ante.
+      pop_callstack();
+      // Having restored the old state, push the result
+      // of the executed item.
+      push_stack(VM->stack, value);
+    }
+  } else {
+    // Item not found.
+    ITEMDEBUG_LOG("Item '%s' not found.\n", itemname);
+    // We need to lose any values on the stack which were passed as args.
+    fit_arguments(arg_count, 0);
+    push_stack(VM->stack, VALUE_NIL);
+  }
+}
+
 uint8_t *op_fetchitem(uint8_t *nextop, ITEM_t *item) {
   // Fetch a value from an item, and push it onto the stack.
   // The item name is a string at the top of the stack.
@@ -708,65 +769,12 @@ uint8_t *op_fetchitem(uint8_t *nextop, ITEM_t *item) {
   VALUE_t itemname = pop_stack(VM->stack);
 
   // First check to see if there is a valid item to look up
-  if (itemname.type == VALUE_str) {
-    ITEM_t *i = find_item(config.itemroot, itemname.s);
-    if (i) {
-      ITEMDEBUG_LOG("Fetched item %s (called with %d arguments).\n", itemname.s, arg_count);
-      // Just push the item value onto the stack.
-      if (i->type == ITEM_value) {
-        VALUE_t v;
-        v.type = i->value.type;
-        if (v.type == VALUE_str) {
-          v.s = strdup(i->value.s);
-        } else {
-          v.i = i->value.i;
-        }
-        push_stack(VM->stack, v);
-      } else {
-        // Are there any arguments in excess of what this item takes?
-        // If so, lose 'em.
-        while (arg_count > i->bytecode[1]) {
-          DEBUG_LOG("Popping unneeded argument.\n");
-          throwaway_stack(VM->stack);
-          arg_count--;
-        }
-        // Contrariwise, do we have fewer arguments than we should?
-        while (arg_count < i->bytecode[1]) {
-          DEBUG_LOG("Pushing additional nil-value argument.\n");
-          push_stack(VM->stack, VALUE_NIL);
-          arg_count++;
-        }
-        // Save our current state.
-        // We pass the number of arguments, so that the stack is
-        // correctly adjusted to account for them at the top of the
-        // current stack (they will be at the bottom of the frame for
-        // the new item).
-        push_callstack(item, nextop, i->bytecode[1]);
-        // Execute the item.
-        ITEMDEBUG_LOG("Executing item %s\n", i->name);
-        VALUE_t value = interpret(i);
-        // Now go back to the status quo ante.
-        FRAME_t *prev_frame = pop_callstack();
-        item = prev_frame->item;
-        nextop = prev_frame->nextop;
-        // Having restored the old state, push the result
-        // of the executed item.
-        push_stack(VM->stack, value);
-      }
-    } else {
-      // Item not found.
-      ITEMDEBUG_LOG("Item '%s' not found.\n", itemname.s);
-      // We need to lose any values on the stack which were passed as args.
-        while (arg_count > 0) {
-          DEBUG_LOG("Popping unneeded argument.\n");
-          throwaway_stack(VM->stack);
-          arg_count--;
-        }
-      push_stack(VM->stack, VALUE_NIL);
-    }
-    FREE_ARRAY(char, itemname.s, strlen(itemname.s));
+  if (IS_STR(itemname)) {
+    ITEM_t *i = find_item(config.itemroot, STRING_CHARS(AS_STR(itemname)));
+    fetchitem(i, STRING_CHARS(AS_STR(itemname)), arg_count, nextop, item);
+    release_string(AS_STR(itemname));
   } else {
-    logerr("Unable to fetch item: invalid item type for name: %d.\n", itemname.type);
+    logerr("Unable to fetch item: invalid item type for name: %d.\n", VALUE_TYPE(itemname));
     push_stack(VM->stack, VALUE_NIL);
   }
   return nextop;
@@ -800,19 +808,19 @@ uint8_t *assembleitem_helper(uint8_t *nextop, ITEM_t *item) {
         switch (*nextop++) {
           case 'V': {
             int idx = *nextop++ + VM->stack->base; // Local variable index
-            switch (VM->stack->stack[idx].type) {
+            switch (VALUE_TYPE(VM->stack->stack[idx])) {
               case VALUE_str: {
                 // This is easy, just concatenate the context of this local
                 // Assuming it is a valid layer name, anyway.
-                if (is_valid_layer(VM->stack->stack[idx].s)) {
-                  int sl = strlen(VM->stack->stack[idx].s);
+                if (is_valid_layer(STRING_CHARS(AS_STR(VM->stack->stack[idx])))) {
+                  int sl = strlen(STRING_CHARS(AS_STR(VM->stack->stack[idx])));
                   if (strlen(itemname) + sl + 2 >= size) {
                     itemname = GROW_ARRAY(char, itemname, size, (size*2)+2);
                     size = (size * 2) + 2;
                   }
-                  strncat(itemname, VM->stack->stack[idx].s, sl);
+                  strncat(itemname, STRING_CHARS(AS_STR(VM->stack->stack[idx])), sl);
                 } else {
-                  logerr("Invalid layer name '%s'.\n", VM->stack->stack[idx].s);
+                  logerr("Invalid layer name '%s'.\n", STRING_CHARS(AS_STR(VM->stack->stack[idx])));
                   invalid = true;
                 }
                 break;
@@ -820,7 +828,7 @@ uint8_t *assembleitem_helper(uint8_t *nextop, ITEM_t *item) {
               case VALUE_int: {
                 // Slightly more complicated.  Turn the int into a string.
                 char str[22]; // Big enough for MAXINT.
-                itoa(VM->stack->stack[idx].i, str, 10);
+                itoa(AS_INT(VM->stack->stack[idx]), str, 10);
                 int sl = strlen(str);
                 if (strlen(itemname) + sl + 2 >= size) {
                   itemname = GROW_ARRAY(char, itemname, size, (size*2)+2);
@@ -842,23 +850,23 @@ uint8_t *assembleitem_helper(uint8_t *nextop, ITEM_t *item) {
             // item, then evaluate it, and use the result as the layer name.
             nextop = assembleitem_helper(nextop, item);
             VALUE_t layername = pop_stack(VM->stack);
-            if (layername.type == VALUE_str) {
+            if (IS_STR(layername)) {
               //  This is basically the same as op_fetchitem
-              ITEM_t *i = find_item(config.itemroot, layername.s);
+              ITEM_t *i = find_item(config.itemroot, STRING_CHARS(AS_STR(layername)));
               if (i) {
                 // We have an item.  Only two value types are allowed.
-                switch (i->value.type) {
+                switch (VALUE_TYPE(i->value)) {
                   case VALUE_str: {
                     // This is the easiest one
-                    if (is_valid_layer(i->value.s)) {
-                      int sl = strlen(i->value.s);
+                    if (is_valid_layer(STRING_CHARS(AS_STR(i->value)))) {
+                      int sl = strlen(STRING_CHARS(AS_STR(i->value)));
                       if (strlen(itemname) + sl + 2 >= size) {
                         itemname = GROW_ARRAY(char, itemname, size, (size*2)+2);
                         size = (size * 2) + 2;
                       }
-                      strncat(itemname, i->value.s, sl);
+                      strncat(itemname, STRING_CHARS(AS_STR(i->value)), sl);
                     } else {
-                      logerr("Invalid layer name '%s'.\n", i->value.s);
+                      logerr("Invalid layer name '%s'.\n", STRING_CHARS(AS_STR(i->value)));
                       invalid = true;
                     }
                     break;
@@ -866,7 +874,7 @@ uint8_t *assembleitem_helper(uint8_t *nextop, ITEM_t *item) {
                   case VALUE_int: {
                     // This needs to be converted to a string.
                     char str[22]; // Big enough for MAXINT.
-                    itoa(i->value.i, str, 10);
+                    itoa(AS_INT(i->value), str, 10);
                     int sl = strlen(str);
                     if (strlen(itemname) + sl + 2 >= size) {
                       itemname = GROW_ARRAY(char, itemname, size, (size*2)+2);
@@ -876,17 +884,17 @@ uint8_t *assembleitem_helper(uint8_t *nextop, ITEM_t *item) {
                     break;
                   }
                   default: {
-                    logerr("Item dereference failed for '%s': invalid type.\n", layername.s);
+                    logerr("Item dereference failed for '%s': invalid type.\n", STRING_CHARS(AS_STR(layername)));
                     invalid = true;
                   }
                 }
               } else {
-                logerr("Item dereference failed for '%s'.\n", layername.s);
+                logerr("Item dereference failed for '%s'.\n", STRING_CHARS(AS_STR(layername)));
                 invalid = true;
               }
-              FREE_ARRAY(char, layername.s, strlen(layername.s));
+              release_string(AS_STR(layername));
             } else {
-              logerr("Invalid item layer type %d.\n", layername.type);
+              logerr("Invalid item layer type %d.\n", VALUE_TYPE(layername));
               invalid = true;
             }
             break;
@@ -917,11 +925,9 @@ uint8_t *assembleitem_helper(uint8_t *nextop, ITEM_t *item) {
     FREE_ARRAY(char, itemname, size);
     push_stack(VM->stack, VALUE_NIL);
   } else {
-    VALUE_t name;
-    name.type = VALUE_str;
-    name.s = itemname; // Don't free itemname - it's on the stack!
-    push_stack(VM->stack, name);
+    push_stack(VM->stack, make_string_value(itemname));
     ITEMDEBUG_LOG("Item assembled: %s\n", itemname);
+    FREE_ARRAY(char, itemname, size);
   }
 
   return nextop + 1;
@@ -945,13 +951,113 @@ uint8_t *op_assembleitem(uint8_t *nextop, ITEM_t *item) {
   return nextop;
 }
 
+void assemble_decoded(ASSEMBLY_t *assembly, ITEM_t *item) {
+  // The pre-decoded equivalent of assembleitem_helper().  Push the full
+  // item name onto the stack as a string, or nil if it cannot be built.
+  if (assembly->name) {
+    // Nothing to dereference, so the name is already known.
+    assembly->name->refcount++;
+    VALUE_t name = STR_VALUE(assembly->name);
+    push_stack(VM->stack, name);
+    ITEMDEBUG_LOG("Item assembled: %s\n", STRING_CHARS(AS_STR(name)));
+    return;
+  }
+
+  bool invalid = false;
+  int size = 128, len = 0;
+  char *itemname = GROW_ARRAY(char, NULL, 0, size);
+  for (int l = 0; l < assembly->count && !invalid; l++) {
+    LAYER_t *layer = &assembly->layer[l];
+    const char *part = NULL;
+    char str[22]; // Big enough for MAXINT.
+    VALUE_t layername = VALUE_NIL;
+    switch (layer->type) {
+      case 'L':
+        part = layer->name;
+        break;
+      case 'V': {
+        VALUE_t *local = &VM->stack->stack[VM->stack->base + layer->local];
+        if (IS_STR(*local)) {
+          if (is_valid_layer(STRING_CHARS(AS_STR(*local)))) {
+            part = STRING_CHARS(AS_STR(*local));
+          } else {
+            logerr("Invalid layer name '%s'.\n", STRING_CHARS(AS_STR(*local)));
+            invalid = true;
+          }
+        } else if (IS_INT(*local)) {
+          itoa(AS_INT(*local), str, 10);
+          part = str;
+        } else {
+          logerr("Layer type (%d) not int or string.\n", VALUE_TYPE(*local));
+          invalid = true;
+        }
+        break;
+      }
+      case 'I': {
+        // Assemble the nested item, then use its value as the layer name.
+        assemble_decoded(layer->item, item);
+        layername = pop_stack(VM->stack);
+        if (!IS_STR(layername)) {
+          logerr("Invalid item layer type %d.\n", VALUE_TYPE(layername));
+          invalid = true;
+          break;
+        }
+        ITEM_t *i = find_item(config.itemroot, STRING_CHARS(AS_STR(layername)));
+        if (!i) {
+          logerr("Item dereference failed for '%s'.\n", STRING_CHARS(AS_STR(layername)));
+          invalid = true;
+        } else if (IS_STR(i->value)) {
+          if (is_valid_layer(STRING_CHARS(AS_STR(i->value)))) {
+            part = STRING_CHARS(AS_STR(i->value));
+          } else {
+            logerr("Invalid layer name '%s'.\n", STRING_CHARS(AS_STR(i->value)));
+            invalid = true;
+          }
+        } else if (IS_INT(i->value)) {
+          itoa(AS_INT(i->value), str, 10);
+          part = str;
+        } else {
+          logerr("Item dereference failed for '%s': invalid type.\n",
+                                                             STRING_CHARS(AS_STR(layername)));
+          invalid = true;
+        }
+        break;
+      }
+    }
+    if (part) {
+      int partlen = (layer->type == 'L') ? layer->len : strlen(part);
+      if (len + partlen + 2 >= size) {
+        itemname = GROW_ARRAY(char, itemname, size, (size * 2) + partlen);
+        size = (size * 2) + partlen;
+      }
+      memcpy(itemname + len, part, partlen);
+      len += partlen;
+      if (l < assembly->count - 1) {
+        itemname[len++] = '.';
+      }
+    }
+    FREE_STR(layername);
+  }
+
+  if (invalid) {
+    // Not a valid item name, so push nil.
+    FREE_ARRAY(char, itemname, size);
+    push_stack(VM->stack, VALUE_NIL);
+  } else {
+    VALUE_t name = STR_VALUE(make_string(itemname, len));
+    push_stack(VM->stack, name);
+    ITEMDEBUG_LOG("Item assembled: %s\n", STRING_CHARS(AS_STR(name)));
+    FREE_ARRAY(char, itemname, size);
+  }
+}
+
 uint8_t *op_delete(uint8_t *nextop, ITEM_t *item) {
   // When this opcode is encountered, an item will previously have been
   // assembled and pushed onto the stack (or nil if the assembly failed).
   // Pop it, delete it, and return nothing.
   VALUE_t val = pop_stack(VM->stack);
-  delete_item(config.itemroot, val.s);
-  FREE_ARRAY(char, val.s, strlen(val.s)+1);
+  delete_item(config.itemroot, STRING_CHARS(AS_STR(val)));
+  release_string(AS_STR(val));
   DISASS_LOG("OP_DELETE\n");
   return nextop;
 }
@@ -962,8 +1068,8 @@ uint8_t *op_exists(uint8_t *nextop, ITEM_t *item) {
   // Pop whatever is on the stack and evaluate it.  Push
   // true or false, depending on the result.
   VALUE_t val = pop_stack(VM->stack);
-  ITEM_t *i = find_item(config.itemroot, val.s);
-  FREE_ARRAY(char, val.s, strlen(val.s)+1);
+  ITEM_t *i = find_item(config.itemroot, STRING_CHARS(AS_STR(val)));
+  release_string(AS_STR(val));
   push_stack(VM->stack, i ? VALUE_TRUE : VALUE_FALSE);
   DISASS_LOG("OP_EXISTS\n");
   return nextop;
@@ -977,15 +1083,13 @@ uint8_t *op_nthname(uint8_t *nextop, ITEM_t *item) {
   VALUE_t index = pop_stack(VM->stack);
   VALUE_t itemname = pop_stack(VM->stack);
   bool found = false;
-  if (index.type == VALUE_int && index.i >= 0) {
-    ITEM_t *i = find_item(config.itemroot, itemname.s);
+  if (IS_INT(index) && AS_INT(index) >= 0) {
+    ITEM_t *i = find_item(config.itemroot, STRING_CHARS(AS_STR(itemname)));
     if (i) {
-      ITEM_t *child = find_item_by_index(i, index.i);
+      ITEM_t *child = find_item_by_index(i, AS_INT(index));
       if (child) {
         found = true;
-        VALUE_t result = {VALUE_str, {0}};
-        result.s = strdup(child->name);
-        push_stack(VM->stack, result);
+        push_stack(VM->stack, make_string_value(child->name));
       }
     }
   }
@@ -997,18 +1101,46 @@ uint8_t *op_nthname(uint8_t *nextop, ITEM_t *item) {
   return nextop;
 }
 
+uint8_t *op_nextname(uint8_t *nextop, ITEM_t *item) {
+  // Interpret the next byte as an index into the locals, which holds a
+  // cursor.  Pop the item, and push the name of its next child after the
+  // cursor, moving the cursor on.  Push nil when there are no more.  A
+  // cursor which is not an int starts from the first child.  Unlike
+  // nthname, each step takes the same time however big the item is, and
+  // children may be deleted as the loop goes.
+  int32_t index = *nextop + VM->stack->base;
+  VALUE_t itemname = pop_stack(VM->stack);
+  VALUE_t *local = &VM->stack->stack[index];
+  ITEM_t *child = NULL;
+  uint32_t cursor = IS_INT(*local) ? (uint32_t)AS_INT(*local) : 0;
+  if (IS_STR(itemname)) {
+    ITEM_t *i = find_item(config.itemroot, STRING_CHARS(AS_STR(itemname)));
+    if (i) {
+      child = next_child(i, &cursor);
+    }
+  }
+  if (child) {
+    FREE_STR(*local);
+    *local = INT_VALUE(cursor);
+    push_stack(VM->stack, make_string_value(child->name));
+  } else {
+    push_stack(VM->stack, VALUE_NIL);
+  }
+  FREE_STR(itemname);
+  DISASS_LOG("OP_NEXTNAME: index %d\n", index);
+  return nextop+1;
+}
+
 uint8_t *op_rootname(uint8_t *nextop, ITEM_t *item) {
   // Identical to op_nthname, except it only pops an index from the stack
   // and then uses it to index the itemroot.
   VALUE_t index = pop_stack(VM->stack);
   bool found = false;
-  if (index.type == VALUE_int && index.i >= 0) {
-    ITEM_t *child = find_item_by_index(config.itemroot, index.i);
+  if (IS_INT(index) && AS_INT(index) >= 0) {
+    ITEM_t *child = find_item_by_index(config.itemroot, AS_INT(index));
     if (child) {
       found = true;
-      VALUE_t result = {VALUE_str, {0}};
-      result.s = strdup(child->name);
-      push_stack(VM->stack, result);
+      push_stack(VM->stack, make_string_value(child->name));
     }
   }
   if (!found) {
@@ -1051,12 +1183,619 @@ void init_interpreter() {
   opcode['C'] = op_assignitem;
   opcode['F'] = op_fetchitem;
   opcode['I'] = op_assembleitem;
+  opcode['N'] = op_nextname;
   opcode['W'] = op_delete;
   opcode['X'] = op_exists;
   opcode['Y'] = op_nthname;
   opcode['Z'] = op_rootname;
 }
 
+#ifdef NATIVE_CODE
+static bool warm_up(DECODED_t *code, ITEM_t *item) {
+  // Count a call to an item, or a turn of a loop in it, and compile it
+  // into machine code when there have been enough.  Returns whether there
+  // is machine code to run.  An item which cannot be compiled stays hot,
+  // and is not tried again.
+  if (code->heat >= JIT_THRESHOLD || ++code->heat < JIT_THRESHOLD) {
+    return false;
+  }
+  code->native = jit_compile(code, item, opcode);
+  return code->native && !profiling;
+}
+#endif
+
+#ifndef DISASS
+static void run_decoded(DECODED_t *code, ITEM_t *item) {
+  // Execute pre-decoded instructions until a HALT is reached.
+  // With threaded dispatch, each instruction jumps directly to the
+  // handler of the next one through the label address stored in it;
+  // otherwise a switch on the opcode does the same job.  The stack
+  // pointer, frame base and instruction pointer live in locals for the
+  // duration of the item.  The common opcodes are handled inline, and
+  // everything else is handed to the opcode function table along with
+  // its operands in the raw bytecode, with the stack pointer written back
+  // before the call and reloaded after it.  Arithmetic and comparisons
+  // which are given ints rewrite themselves into int-only forms, which
+  // skip the type dispatch until they are given something else.
+  // Runs of instructions which do int arithmetic or comparisons on a local
+  // are fused into one by the decoder.
+  // Code items called from here are run by this same loop: the caller's
+  // state goes into a frame on the callstack, the item, code, frame base
+  // and instruction pointer are switched to the callee's, and its HALT
+  // switches them back.  So a chain of calls takes no C stack, and is only
+  // as deep as the callstack allows.
+  // Items which are called, or go round loops, often enough are compiled
+  // into machine code by the JIT, which runs in place of the loop until it
+  // comes to a call or a HALT, and hands those back.  Nothing is run as
+  // machine code while the profiler is counting opcodes.
+#ifdef COMPUTED_GOTO
+  static const void *dispatch[256] = {
+    [0 ... 255] = &&do_generic,
+    ['h'] = &&do_halt,
+    ['c'] = &&do_savelocal,
+    ['e'] = &&do_getlocal,
+    ['f'] = &&do_inclocal,
+    ['g'] = &&do_declocal,
+    ['j'] = &&do_jump,
+    ['k'] = &&do_jumpfalse,
+    ['l'] = &&do_pushstr,
+    ['p'] = &&do_pushint,
+    ['a'] = &&do_add,
+    ['s'] = &&do_subtract,
+    ['m'] = &&do_multiply,
+    ['d'] = &&do_divide,
+    ['n'] = &&do_negate,
+    ['o'] = &&do_equal,
+    ['q'] = &&do_notequal,
+    ['r'] = &&do_lessthan,
+    ['t'] = &&do_greaterthan,
+    ['u'] = &&do_lessthanorequal,
+    ['v'] = &&do_greaterthanorequal,
+    [OP_ADDINT] = &&do_addint,
+    [OP_SUBTRACTINT] = &&do_subtractint,
+    [OP_MULTIPLYINT] = &&do_multiplyint,
+    [OP_DIVIDEINT] = &&do_divideint,
+    [OP_NEGATEINT] = &&do_negateint,
+    [OP_EQUALINT] = &&do_equalint,
+    [OP_NOTEQUALINT] = &&do_notequalint,
+    [OP_LESSTHANINT] = &&do_lessthanint,
+    [OP_GREATERTHANINT] = &&do_greaterthanint,
+    [OP_LESSTHANOREQUALINT] = &&do_lessthanorequalint,
+    [OP_GREATERTHANOREQUALINT] = &&do_greaterthanorequalint,
+    [OP_ADDLOCALINT] = &&do_addlocalint,
+    [OP_SUBTRACTLOCALINT] = &&do_subtractlocalint,
+    [OP_EQUALJUMP] = &&do_equaljump,
+    [OP_NOTEQUALJUMP] = &&do_notequaljump,
+    [OP_LESSTHANJUMP] = &&do_lessthanjump,
+    [OP_GREATERTHANJUMP] = &&do_greaterthanjump,
+    [OP_LESSTHANOREQUALJUMP] = &&do_lessthanorequaljump,
+    [OP_GREATERTHANOREQUALJUMP] = &&do_greaterthanorequaljump,
+    ['A'] = &&do_libcall,
+    ['F'] = &&do_fetchitem,
+    ['I'] = &&do_assembleitem,
+    [OP_FETCHSTATIC] = &&do_fetchstatic,
+    [OP_EXISTSSTATIC] = &&do_existsstatic,
+    [OP_NAMESTATIC] = &&do_namestatic,
+    [OP_ASSIGNSTATIC] = &&do_assignstatic,
+  };
+  // While the profiler is running, every instruction goes by way of
+  // do_count, so that nothing is counted at all the rest of the time.
+  static const void *counting[256] = {
+    [0 ... 255] = &&do_count,
+  };
+  const void **handlers = profiling ? counting : dispatch;
+  if (code->linked != handlers) {
+    link_decoded(code, handlers);
+  }
+#define TARGET(label, op) label
+#define GENERIC_TARGET do_generic
+#define DISPATCH() goto *ip->handler
+// Change the opcode of the current instruction, and its handler to match.
+#define REWRITE(newop) (ip->op = (newop), ip->handler = handlers[ip->op])
+#else
+#define TARGET(label, op) case op
+#define GENERIC_TARGET default: do_generic
+#define DISPATCH() continue
+#define REWRITE(newop) (ip->op = (newop))
+#endif
+  // The int-only form of each opcode that has one, and back again.
+  static const uint8_t quickened[256] = {
+    ['a'] = OP_ADDINT, ['s'] = OP_SUBTRACTINT, ['m'] = OP_MULTIPLYINT,
+    ['d'] = OP_DIVIDEINT, ['n'] = OP_NEGATEINT, ['o'] = OP_EQUALINT,
+    ['q'] = OP_NOTEQUALINT, ['r'] = OP_LESSTHANINT,
+    ['t'] = OP_GREATERTHANINT, ['u'] = OP_LESSTHANOREQUALINT,
+    ['v'] = OP_GREATERTHANOREQUALINT,
+  };
+  static const uint8_t unquickened[256] = {
+    [OP_ADDINT] = 'a', [OP_SUBTRACTINT] = 's', [OP_MULTIPLYINT] = 'm',
+    [OP_DIVIDEINT] = 'd', [OP_NEGATEINT] = 'n', [OP_EQUALINT] = 'o',
+    [OP_NOTEQUALINT] = 'q', [OP_LESSTHANINT] = 'r',
+    [OP_GREATERTHANINT] = 't', [OP_LESSTHANOREQUALINT] = 'u',
+    [OP_GREATERTHANOREQUALINT] = 'v',
+  };
+  STACK_t *stack = VM->stack;
+  VALUE_t *bp = stack->stack + stack->base;
+  VALUE_t *sp = stack->stack + stack->current;
+  VALUE_t *top = stack->stack + stack->max;
+  INSTR_t *ip = code->instr;
+  // Calls deeper than this were made by the loop, and return to it.
+  CALLSTACK_t *calls = VM->callstack;
+  int32_t entry = calls->current;
+  // The item being called, its arguments, and where to carry on after.
+  ITEM_t *callee;
+  uint16_t nargs;
+  INSTR_t *resume;
+
+// Write the stack pointer back to the VM, or reload it from the VM.
+#define SYNC_OUT() (stack->current = sp - stack->stack)
+#define SYNC_IN()  (sp = stack->stack + stack->current)
+// Both operands of a binary operator are ints.
+#define BOTH_INT() (IS_INT(*sp) && IS_INT(sp[-1]))
+// Replace the top two values with the result of an integer comparison.
+#define COMPARE_INT(op) \
+  sp[-1] = BOOL_VALUE(AS_INT(sp[-1]) op AS_INT(*sp)); \
+  *sp = VALUE_NIL; \
+  sp--
+// Compare a local with the int after it, and jump if that is false.
+#define JUMP_LOCAL_INT(op) \
+  if (!IS_INT(bp[ip->local])) goto do_unfuse; \
+  ip = (AS_INT(bp[ip->local]) op AS_INT(ip[1].value)) ? ip + 4 \
+                                                : code->instr + ip[3].target
+#ifdef NATIVE_CODE
+// Carry on in machine code if the item has been compiled.  HOT() also
+// counts towards compiling it, at the start of the item and of loops.
+#define NATIVE() if (code->native && !profiling) goto do_native
+#define HOT() \
+  if (code->native ? !profiling : warm_up(code, item)) goto do_native
+#else
+#define NATIVE() ((void)0)
+#define HOT() ((void)0)
+#endif
+
+  HOT();
+#ifdef COMPUTED_GOTO
+  DISPATCH();
+
+  do_count:
+    profile_ops[ip->op]++;
+    goto *dispatch[ip->op];
+#else
+  for (;;) {
+    if (profiling) {
+      profile_ops[ip->op]++;
+    }
+    switch (ip->op) {
+#endif
+
+  TARGET(do_pushint, 'p'):
+    if (sp >= top) goto do_generic; // Let op_pushint report the overflow
+    *++sp = ip->value;
+    ip++;
+    DISPATCH();
+
+  TARGET(do_pushstr, 'l'):
+    // The literal belongs to the code, so the stack just shares it.
+    if (sp >= top) goto do_generic;
+    *++sp = STR_VALUE(ip->s);
+    ip->s->refcount++;
+    ip++;
+    DISPATCH();
+
+  TARGET(do_getlocal, 'e'):
+    if (sp >= top) goto do_generic;
+    *++sp = bp[ip->local];
+    COPY_STR(*sp);
+    ip++;
+    DISPATCH();
+
+  TARGET(do_savelocal, 'c'):
+    FREE_STR(bp[ip->local]);
+    bp[ip->local] = *sp;
+    *sp = VALUE_NIL;
+    sp--;
+    ip++;
+    DISPATCH();
+
+  TARGET(do_inclocal, 'f'):
+    if (!IS_INT(bp[ip->local])) goto do_generic;
+    bp[ip->local] = INT_VALUE(AS_INT(bp[ip->local]) + 1);
+    ip++;
+    DISPATCH();
+
+  TARGET(do_declocal, 'g'):
+    if (!IS_INT(bp[ip->local])) goto do_generic;
+    bp[ip->local] = INT_VALUE(AS_INT(bp[ip->local]) - 1);
+    ip++;
+    DISPATCH();
+
+  TARGET(do_jump, 'j'):
+    if (ip->target < ip - code->instr) {
+      // Back to the top of a loop.
+      ip = code->instr + ip->target;
+      HOT();
+      DISPATCH();
+    }
+    ip = code->instr + ip->target;
+    DISPATCH();
+
+  TARGET(do_jumpfalse, 'k'):
+    if (IS_INT(*sp) || IS_BOOL(*sp)) {
+      bool truth = IS_TRUE(*sp);
+      *sp-- = VALUE_NIL;
+      ip = truth ? ip + 1 : code->instr + ip->target;
+    } else {
+      // Strings and nils need a little more thought.
+      SYNC_OUT();
+      bool jump = (op_jumpfalse(ip->raw, item) != ip->raw + 2);
+      SYNC_IN();
+      ip = jump ? code->instr + ip->target : ip + 1;
+    }
+    DISPATCH();
+
+  TARGET(do_add, 'a'):
+  TARGET(do_subtract, 's'):
+  TARGET(do_multiply, 'm'):
+  TARGET(do_divide, 'd'):
+  TARGET(do_equal, 'o'):
+  TARGET(do_notequal, 'q'):
+  TARGET(do_lessthan, 'r'):
+  TARGET(do_greaterthan, 't'):
+  TARGET(do_lessthanorequal, 'u'):
+  TARGET(do_greaterthanorequal, 'v'):
+    // Not yet quickened.  If this has been given two ints, and has not
+    // kept being given other things, swap in the int-only form and run it.
+    if (!BOTH_INT() || ip->misses >= QUICKEN_LIMIT) goto do_generic;
+    REWRITE(quickened[ip->op]);
+    DISPATCH();
+
+  TARGET(do_negate, 'n'):
+    if (!IS_INT(*sp) || ip->misses >= QUICKEN_LIMIT) goto do_generic;
+    REWRITE(quickened[ip->op]);
+    DISPATCH();
+
+  // The int-only forms.
+  TARGET(do_addint, OP_ADDINT):
+    if (!BOTH_INT()) goto do_unquicken;
+    sp[-1] = INT_VALUE(AS_INT(sp[-1]) + AS_INT(*sp));
+    *sp = VALUE_NIL;
+    sp--;
+    ip++;
+    DISPATCH();
+
+  TARGET(do_subtractint, OP_SUBTRACTINT):
+    if (!BOTH_INT()) goto do_unquicken;
+    sp[-1] = INT_VALUE(AS_INT(sp[-1]) - AS_INT(*sp));
+    *sp = VALUE_NIL;
+    sp--;
+    ip++;
+    DISPATCH();
+
+  TARGET(do_multiplyint, OP_MULTIPLYINT):
+    if (!BOTH_INT()) goto do_unquicken;
+    sp[-1] = INT_VALUE(AS_INT(sp[-1]) * AS_INT(*sp));
+    *sp = VALUE_NIL;
+    sp--;
+    ip++;
+    DISPATCH();
+
+  TARGET(do_divideint, OP_DIVIDEINT):
+    // Dividing by zero is left to op_divide to complain about.
+    if (!BOTH_INT() || AS_INT(*sp) == 0) goto do_unquicken;
+    sp[-1] = INT_VALUE(AS_INT(sp[-1]) / AS_INT(*sp));
+    *sp = VALUE_NIL;
+    sp--;
+    ip++;
+    DISPATCH();
+
+  TARGET(do_negateint, OP_NEGATEINT):
+    if (!IS_INT(*sp)) goto do_unquicken;
+    *sp = INT_VALUE(-AS_INT(*sp));
+    ip++;
+    DISPATCH();
+
+  TARGET(do_equalint, OP_EQUALINT):
+    if (!BOTH_INT()) goto do_unquicken;
+    COMPARE_INT(==);
+    ip++;
+    DISPATCH();
+
+  TARGET(do_notequalint, OP_NOTEQUALINT):
+    if (!BOTH_INT()) goto do_unquicken;
+    COMPARE_INT(!=);
+    ip++;
+    DISPATCH();
+
+  TARGET(do_lessthanint, OP_LESSTHANINT):
+    if (!BOTH_INT()) goto do_unquicken;
+    COMPARE_INT(<);
+    ip++;
+    DISPATCH();
+
+  TARGET(do_greaterthanint, OP_GREATERTHANINT):
+    if (!BOTH_INT()) goto do_unquicken;
+    COMPARE_INT(>);
+    ip++;
+    DISPATCH();
+
+  TARGET(do_lessthanorequalint, OP_LESSTHANOREQUALINT):
+    if (!BOTH_INT()) goto do_unquicken;
+    COMPARE_INT(<=);
+    ip++;
+    DISPATCH();
+
+  TARGET(do_greaterthanorequalint, OP_GREATERTHANOREQUALINT):
+    if (!BOTH_INT()) goto do_unquicken;
+    COMPARE_INT(>=);
+    ip++;
+    DISPATCH();
+
+  // The fused runs.  The instructions after the first are still there,
+  // and the operands are taken from them.
+  TARGET(do_addlocalint, OP_ADDLOCALINT): {
+    if (!IS_INT(bp[ip->local])) goto do_unfuse;
+    VALUE_t sum = INT_VALUE(AS_INT(bp[ip->local]) + AS_INT(ip[1].value));
+    FREE_STR(bp[ip[3].local]);
+    bp[ip[3].local] = sum;
+    ip += 4;
+    DISPATCH();
+  }
+
+  TARGET(do_subtractlocalint, OP_SUBTRACTLOCALINT): {
+    if (!IS_INT(bp[ip->local])) goto do_unfuse;
+    VALUE_t diff = INT_VALUE(AS_INT(bp[ip->local]) - AS_INT(ip[1].value));
+    FREE_STR(bp[ip[3].local]);
+    bp[ip[3].local] = diff;
+    ip += 4;
+    DISPATCH();
+  }
+
+  TARGET(do_equaljump, OP_EQUALJUMP):
+    JUMP_LOCAL_INT(==);
+    DISPATCH();
+
+  TARGET(do_notequaljump, OP_NOTEQUALJUMP):
+    JUMP_LOCAL_INT(!=);
+    DISPATCH();
+
+  TARGET(do_lessthanjump, OP_LESSTHANJUMP):
+    JUMP_LOCAL_INT(<);
+    DISPATCH();
+
+  TARGET(do_greaterthanjump, OP_GREATERTHANJUMP):
+    JUMP_LOCAL_INT(>);
+    DISPATCH();
+
+  TARGET(do_lessthanorequaljump, OP_LESSTHANOREQUALJUMP):
+    JUMP_LOCAL_INT(<=);
+    DISPATCH();
+
+  TARGET(do_greaterthanorequaljump, OP_GREATERTHANOREQUALJUMP):
+    JUMP_LOCAL_INT(>=);
+    DISPATCH();
+
+  do_unfuse:
+    // The local in a fused run is not an int.  Put the 'e' back, so that
+    // the run is executed one instruction at a time from now on.
+    REWRITE('e');
+    DISPATCH();
+
+  do_unquicken:
+    // A quickened instruction has been given something other than ints.
+    // Put the original back, and let the opcode table deal with it.
+    REWRITE(unquickened[ip->op]);
+    ip->misses++;
+    goto do_generic;
+
+  TARGET(do_libcall, 'A'):
+    // The library function was looked up when the item was decoded.
+    SYNC_OUT();
+    ip->libcall(ip->raw, item);
+    SYNC_IN();
+    ip++;
+    DISPATCH();
+
+  TARGET(do_assembleitem, 'I'):
+    SYNC_OUT();
+    assemble_decoded(ip->assembly, item);
+    SYNC_IN();
+    ip++;
+    DISPATCH();
+
+  TARGET(do_fetchstatic, OP_FETCHSTATIC): {
+    // An item with a fixed name, and the 'F' which follows it.
+    ASSEMBLY_t *assembly = ip->assembly;
+    ITEM_t *i = find_item_cached(config.itemroot, assembly->name->chars,
+                                                        &assembly->cache);
+    if (i && i->type == ITEM_code && decoded_code(i)->instr) {
+      callee = i;
+      nargs = ip->n;
+      resume = ip + 2;
+      goto do_call;
+    }
+    SYNC_OUT();
+    fetchitem(i, assembly->name->chars, ip->n, ip->raw, item);
+    SYNC_IN();
+    ip += 2;
+    NATIVE();
+    DISPATCH();
+  }
+
+  TARGET(do_fetchitem, 'F'): {
+    // An item whose name was assembled as the code ran.
+    if (!IS_STR(*sp)) goto do_generic; // Let op_fetchitem complain
+    STRING_t *name = AS_STR(*sp);
+    *sp = VALUE_NIL;
+    sp--;
+    ITEM_t *i = find_item(config.itemroot, STRING_CHARS(name));
+    if (i && i->type == ITEM_code && decoded_code(i)->instr) {
+      release_string(name);
+      callee = i;
+      nargs = ip->n;
+      resume = ip + 1;
+      goto do_call;
+    }
+    SYNC_OUT();
+    fetchitem(i, STRING_CHARS(name), ip->n, ip->raw + 2, item);
+    SYNC_IN();
+    release_string(name);
+    ip++;
+    NATIVE();
+    DISPATCH();
+  }
+
+  do_call: {
+    // Set up the frame as interpret() would, with the locals above the
+    // arguments, and carry on with the callee.
+    uint8_t numlocals = callee->bytecode[0];
+    uint8_t numparams = callee->bytecode[1];
+    if (nargs != numparams) {
+      SYNC_OUT();
+      fit_arguments(nargs, numparams);
+      SYNC_IN();
+    }
+    if (calls->current >= calls->max) {
+      SYNC_OUT();
+      logerr("Callstack overflow.\n");
+      raise(SIGUSR1);
+    }
+    if (sp + numlocals - numparams > top) {
+      SYNC_OUT();
+      logerr("Stack overflow.\n");
+      raise(SIGUSR1);
+    }
+    FRAME_t *frame = &calls->entry[++calls->current];
+    frame->item = item;
+    frame->nextop = ip->raw;
+    frame->current_stack = (sp - stack->stack) - numparams;
+    frame->current_base = stack->base;
+    frame->current_locals = stack->locals;
+    frame->current_params = stack->params;
+    frame->resume = resume;
+    frame->inuse = callee->inuse;
+    frame->profiled = profiling && profile_enter(callee);
+    callee->inuse = true;
+    stack->base = frame->current_stack + 1;
+    stack->locals = numlocals;
+    stack->params = numparams;
+    for (int l = numparams; l < numlocals; l++) {
+      *++sp = VALUE_NIL;
+    }
+    item = callee;
+    code = callee->decoded;
+#ifdef COMPUTED_GOTO
+    handlers = profiling ? counting : dispatch;
+    if (code->linked != handlers) {
+      link_decoded(code, handlers);
+    }
+#endif
+    bp = stack->stack + stack->base;
+    ip = code->instr;
+    HOT();
+    DISPATCH();
+  }
+
+  TARGET(do_existsstatic, OP_EXISTSSTATIC): {
+    // An item with a fixed name, and the 'X' which follows it.
+    ASSEMBLY_t *assembly = ip->assembly;
+    SYNC_OUT();
+    push_stack(stack, find_item_cached(config.itemroot, assembly->name->chars,
+                              &assembly->cache) ? VALUE_TRUE : VALUE_FALSE);
+    SYNC_IN();
+    ip += 2;
+    DISPATCH();
+  }
+
+  TARGET(do_namestatic, OP_NAMESTATIC):
+    // The name is not needed, as the assignment already knows it.
+    ip++;
+    DISPATCH();
+
+  TARGET(do_assignstatic, OP_ASSIGNSTATIC): {
+    VALUE_t val = *sp;
+    *sp = VALUE_NIL;
+    sp--;
+    SYNC_OUT();
+    assignitem_static(ip->assembly, val);
+    SYNC_IN();
+    ip++;
+    DISPATCH();
+  }
+
+  TARGET(do_halt, 'h'): {
+    if (calls->current == entry) {
+      SYNC_OUT();
+      return;
+    }
+    // The end of an item called by the loop.  Its result is whatever it
+    // left on the stack above its locals, if anything.  Everything else
+    // in its frame is thrown away, and the caller carries on.
+    VALUE_t result = VALUE_NIL;
+    if (sp >= bp + stack->locals) {
+      result = *sp;
+      *sp = VALUE_NIL;
+      sp--;
+    }
+    FRAME_t *frame = &calls->entry[calls->current--];
+    for (VALUE_t *floor = stack->stack + frame->current_stack; sp > floor;
+                                                                    sp--) {
+      FREE_STR(*sp);
+      *sp = VALUE_NIL;
+    }
+    stack->base = frame->current_base;
+    stack->locals = frame->current_locals;
+    stack->params = frame->current_params;
+    if (frame->profiled) {
+      profile_leave();
+    }
+    item->inuse = frame->inuse;
+    item = frame->item;
+    code = item->decoded;
+    ip = frame->resume;
+    bp = stack->stack + stack->base;
+    *++sp = result;
+    NATIVE();
+    DISPATCH();
+  }
+
+  GENERIC_TARGET:
+    // Anything not handled above (or a fast path which has bailed out)
+    // goes through the opcode table, which reads its operands from the
+    // raw bytecode.  None of these opcodes jump.
+    SYNC_OUT();
+    opcode[ip->op](ip->raw, item);
+    SYNC_IN();
+    ip++;
+    DISPATCH();
+
+#ifdef NATIVE_CODE
+  do_native:
+    // The machine code stops at an instruction which needs the loop: a
+    // call, or the end of the item.
+    SYNC_OUT();
+    ip = code->instr + jit_run(code->native, ip - code->instr, bp, top);
+    SYNC_IN();
+    DISPATCH();
+#endif
+
+#ifndef COMPUTED_GOTO
+    }
+  }
+#endif
+
+#undef TARGET
+#undef GENERIC_TARGET
+#undef DISPATCH
+#undef REWRITE
+#undef SYNC_OUT
+#undef SYNC_IN
+#undef BOTH_INT
+#undef COMPARE_INT
+#undef JUMP_LOCAL_INT
+#undef NATIVE
+#undef HOT
+}
+#endif
+
 VALUE_t interpret(ITEM_t *item) {
   // Given some bytecode, interpret it until the HALT instruction is seen
   // NB: The HALT opcode (currently represented by the character 'h') does
@@ -1067,7 +1806,9 @@ VALUE_t interpret(ITEM_t *item) {
   uint8_t numparams = item->bytecode[1];
 
   // Item is now in use
+  bool inuse = item->inuse;
   item->inuse = true;
+  bool profiled = profiling && profile_enter(item);
 
   // Set up the stack before executing it
   // We have already adjusted the stack to account for the arguments
@@ -1075,19 +1816,38 @@ VALUE_t interpret(ITEM_t *item) {
   VM->stack->current += numlocals - numparams;
   VM->stack->locals = numlocals;
   VM->stack->params = numparams;
-  // The actual bytecode starts at the third byte.
-  uint8_t *op = item->bytecode + 2; 
-  while (*op != 'h') {
-    // We do it this way to avoid undefined behaviour between
-    // two sequence points:
-    uint8_t *nextop = op + 1;
-    op = opcode[*op](nextop, item);
+
+#ifndef DISASS
+  DECODED_t *code = decoded_code(item);
+  if (code->instr) {
+    run_decoded(code, item);
+  } else
+#endif
+  {
+    // Bytecode which could not be decoded (and all bytecode, when
+    // tracing) is run directly through the opcode table.
+    // The actual bytecode starts at the third byte.
+    uint8_t *op = item->bytecode + 2;
+    while (*op != 'h') {
+      // We do it this way to avoid undefined behaviour between
+      // two sequence points:
+      uint8_t *nextop = op + 1;
+      if (profiling) {
+        profile_ops[*op]++;
+      }
+      op = opcode[*op](nextop, item);
+    }
   }
 
-  // Item is now free to be replaced or deleted
-  item->inuse = false;
+  if (profiled) {
+    profile_leave();
+  }
+  // Item is now free to be replaced or deleted, unless it is still
+  // running further up the callstack.
+  item->inuse = inuse;
 
-  if (size_stack(VM->stack) > 0) {
+  // The result is whatever was left on the stack above the locals.
+  if (VM->stack->current >= VM->stack->base + numlocals) {
     return pop_stack(VM->stack);
   } else {
     // Otherwise return a nil.
@@ -12,3 +12,11 @@ typedef uint8_t *(*OP_t)(uint8_t *nextop, ITEM_t *item);
 
 void init_interpreter();
 VALUE_t interpret(ITEM_t *item);
+
+// Also called from the machine code made by the JIT.
+typedef struct Assembly ASSEMBLY_t;
+DECODED_t *decoded_code(ITEM_t *item);
+void fetchitem(ITEM_t *i, const char *itemname, uint16_t arg_count,
+                                          uint8_t *nextop, ITEM_t *item);
+void assemble_decoded(ASSEMBLY_t *assembly, ITEM_t *item);
+void assignitem_static(ASSEMBLY_t *assembly, VALUE_t val);
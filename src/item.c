@@ -14,216 +14,238 @@
 #include "memory.h"
 #include "log.h"
 #include "item.h"
+#include "decode.h"
+#include "journal.h"
 
 // The configuration object, defined in sin.c
 extern CONFIG_t config;
 
-HASHTABLE_t *create_hashtable(int size) {
-  // Create a hashtable with the given number of buckets
-  HASHTABLE_t *hashtable = allocate_hashtable();
-  hashtable->size = size;
-  hashtable->table = (ENTRY_t **)malloc(sizeof(ENTRY_t *) * size);
-  for (int i = 0; i < size; i++) {
-    hashtable->table[i] = NULL;
+// An old slot whose child has since been removed.  Only the old table of
+// a child index which is being rehashed ever holds one of these.
+#define SLOT_REMOVED UINT32_MAX
+
+static CHILDREN_t *create_children(uint32_t slots) {
+  // Create an empty child index with the given number of slots.
+  CHILDREN_t *children = allocate_children();
+  children->mask = slots - 1;
+  children->capacity = slots - (slots / 4);
+  children->slot = (SLOT_t *)slab_allocate(sizeof(SLOT_t) * slots);
+  children->child = (ITEM_t **)slab_allocate(sizeof(ITEM_t *)
+                                                      * children->capacity);
+  return children;
+}
+
+static void place_slot(SLOT_t *slot, uint32_t mask, uint32_t hash,
+                                                            uint32_t index) {
+  // Put a child into the first free slot on from its hash.
+  uint32_t s = hash & mask;
+  while (slot[s].index) {
+    s = (s + 1) & mask;
+  }
+  slot[s].hash = hash;
+  slot[s].index = index;
+}
+
+static void rehash_children(CHILDREN_t *children, uint32_t steps) {
+  // Move up to this many of the old slots into the new table.  The old
+  // slots are left as they are, so that the runs of the old table stay
+  // intact for lookups.  Anything before the rehash position counts as
+  // moved.
+  uint32_t oldslots = children->oldmask + 1;
+  while (steps-- && children->rehashed < oldslots) {
+    SLOT_t *old = &children->oldslot[children->rehashed++];
+    if (old->index && old->index != SLOT_REMOVED) {
+      place_slot(children->slot, children->mask, old->hash, old->index);
+    }
   }
-  return hashtable;
-}
-
-void create_ordered_array(ITEM_t *item) {
-  // This must be called after a new hashtable has been created,
-  // but must not be called when a hashtable is resized, or memory
-  // will leak like a very leaky thing.
-  item->ordered_size = 0;
-  item->ordered_capacity = ITEM_ARRAY_INIT_CAPACITY;
-  item->ordered_array = (ITEM_t **)malloc(sizeof(ITEM_t *) *
-                                              item->ordered_capacity);
-}
-
-uint32_t simple_hash(const char *key, size_t len) {
-  // It is pointless to create a 4-byte hash for a key of 4 bytes or less
-  uint32_t hash = 0;
-  memcpy(&hash, key, len);
-  return hash;
-}
-
-HASHTABLE_t *resize_hashtable(HASHTABLE_t *oldhashtable, int newsize) {
-  // Create a new hash table with the new size
-  HASHTABLE_t *newhashtable = create_hashtable(newsize);
-  // Rehash all the existing entries
-  for (int i = 0; i < (oldhashtable)->size; i++) {
-    ENTRY_t *current_entry = (oldhashtable)->table[i];
-    while (current_entry != NULL) {
-      // Save the next entry before we move this one
-      ENTRY_t *nextEntry = current_entry->next;
-      // Recalculate the hash index for the current entry's key
-      size_t keylen = strlen(current_entry->key);
-      uint32_t newhashindex;
-      if (keylen <= 4) {
-        newhashindex = simple_hash(current_entry->key, keylen);
-      } else {
-        newhashindex = murmur3_32(current_entry->key, keylen, 0);
+  if (children->rehashed == oldslots) {
+    slab_release(children->oldslot, sizeof(SLOT_t) * oldslots);
+    children->oldslot = NULL;
+  }
+}
+
+static void grow_children(CHILDREN_t *children) {
+  // Double the number of slots.  The children are moved across to the
+  // new table a few at a time by the operations which follow, so that
+  // adding a child to a big parent never stops everything while the
+  // whole lot is rehashed.  The hashes are already known, so the names of
+  // the children don't need to be looked at.
+  if (children->oldslot) {
+    // Still busy with the last one.  This can only happen if
+    // CHILD_REHASH_STEP is too small.
+    rehash_children(children, UINT32_MAX);
+  }
+  uint32_t oldslots = children->mask + 1;
+  uint32_t oldcapacity = children->capacity;
+  children->oldslot = children->slot;
+  children->oldmask = children->mask;
+  children->rehashed = 0;
+  children->mask = (oldslots * 2) - 1;
+  children->capacity = (oldslots * 2) - (oldslots / 2);
+  children->slot = (SLOT_t *)slab_allocate(sizeof(SLOT_t) * oldslots * 2);
+  children->child = (ITEM_t **)slab_reallocate(children->child,
+                                      sizeof(ITEM_t *) * oldcapacity,
+                                      sizeof(ITEM_t *) * children->capacity);
+}
+
+static void squeeze_children(CHILDREN_t *children) {
+  // Close up the gaps left in the child array by deleted children, and
+  // correct the slots of those which moved.  The order of the children,
+  // and so their sequence numbers, are unchanged.
+  if (children->oldslot) {
+    rehash_children(children, UINT32_MAX);
+  }
+  uint32_t *moved = GROW_ARRAY(uint32_t, NULL, 0, children->used);
+  uint32_t to = 0;
+  for (uint32_t from = 0; from < children->used; from++) {
+    if (children->child[from]) {
+      children->child[to] = children->child[from];
+      moved[from] = ++to;
+    }
+  }
+  for (uint32_t s = 0; s <= children->mask; s++) {
+    if (children->slot[s].index) {
+      children->slot[s].index = moved[children->slot[s].index - 1];
+    }
+  }
+  FREE_ARRAY(uint32_t, moved, children->used);
+  children->used = to;
+  // Positions have changed, so the remembered cursor is no good.
+  children->cursor = 0;
+  children->cursorpos = 0;
+}
+
+static SLOT_t *find_slot(CHILDREN_t *children, uint32_t hash,
+                                          const char *key, ITEM_t *item) {
+  // Find the slot of a child, either by name or by the item itself.
+  // While a rehash is under way, a child not yet in the new table is
+  // still in the old one.
+  uint32_t s = hash & children->mask;
+  while (children->slot[s].index) {
+    if (children->slot[s].hash == hash) {
+      ITEM_t *child = children->child[children->slot[s].index - 1];
+      if (item ? child == item : strcmp(child->name, key) == 0) {
+        return &children->slot[s];
       }
-      newhashindex %= newhashtable->size;
-      // Remove it from the old list
-      current_entry->next = NULL;
-      // Add it to the new list
-      // No need to allocate new memory for the entry itself
-      if (newhashtable->table[newhashindex] == NULL) {
-        newhashtable->table[newhashindex] = current_entry;
-      } else {
-        // Handle collision with separate chaining
-        ENTRY_t *temp = newhashtable->table[newhashindex];
-        while (temp->next != NULL) {
-          temp = temp->next;
+    }
+    s = (s + 1) & children->mask;
+  }
+  if (children->oldslot) {
+    s = hash & children->oldmask;
+    while (children->oldslot[s].index) {
+      SLOT_t *old = &children->oldslot[s];
+      if (s >= children->rehashed && old->index != SLOT_REMOVED
+                                                  && old->hash == hash) {
+        ITEM_t *child = children->child[old->index - 1];
+        if (item ? child == item : strcmp(child->name, key) == 0) {
+          return old;
         }
-        temp->next = current_entry;
       }
-      // Move to the next entry
-      current_entry = nextEntry;
+      s = (s + 1) & children->oldmask;
     }
   }
-  // Free the old table's array of pointers
-  // - but not the entries themselves as we reused them
-  free((oldhashtable)->table);
-  // Free the old hash table struct
-  deallocate_hashtable(oldhashtable);
-  return newhashtable;
+  return NULL;
 }
 
-void resize_ordered_array(ITEM_t *item) {
-  // If the ordered array is full, embiggen it
-  if (item->ordered_size >= item->ordered_capacity) {
-    item->ordered_capacity += ITEM_ARRAY_INIT_CAPACITY;
-    item->ordered_array = (ITEM_t **)realloc(item->ordered_array,
-                                item->ordered_capacity * sizeof(ITEM_t *));
+void insert_child(ITEM_t *parent, ITEM_t *child) {
+  // Add a child to the end of its parent's children.  The child must not
+  // already be there.
+  if (!parent->children) {
+    parent->children = create_children(CHILD_INIT_SLOTS);
   }
-}
-
-float calculate_load_factor(HASHTABLE_t *hashtable) {
-  int numentries = 0;
-  for (int i = 0; i < hashtable->size; i++) {
-    ENTRY_t *entry = hashtable->table[i];
-    while (entry) {
-      numentries++;
-      entry = entry->next;
+  CHILDREN_t *children = parent->children;
+  if (children->oldslot) {
+    rehash_children(children, CHILD_REHASH_STEP);
+  }
+  if (children->used >= children->capacity) {
+    // If at least half of the array is deleted children, it is enough to
+    // squeeze them out.
+    if (children->count <= children->capacity / 2) {
+      squeeze_children(children);
+    } else {
+      grow_children(children);
     }
   }
-  return (float)numentries / (float)hashtable->size;
+  child->seq = children->nextseq++;
+  children->child[children->used++] = child;
+  children->count++;
+  place_slot(children->slot, children->mask,
+                    murmur3_32(child->name, strlen(child->name), 0),
+                    children->used);
 }
 
-HASHTABLE_t *maybe_resize_hashtable(HASHTABLE_t *hashtable) {
-  float loadfactor = calculate_load_factor(hashtable);
-  const float maxloadfactor = 0.75; // Tweak for performance as needed
-  if (loadfactor > maxloadfactor) {
-    // Double the size - maybe tweak for performance
-    int newsize = (hashtable->size * 2) + 1;
-    return resize_hashtable(hashtable, newsize);
+ITEM_t *search_children(CHILDREN_t *children, const char *key) {
+  // Find the child with this name, or NULL if there isn't one.
+  if (!children) {
+    return NULL;
   }
-  // hashtable has not changed.
-  return hashtable;
-}
-
-void insert_hashtable(HASHTABLE_t *hashtable, const char *key, ITEM_t *child) {
-  size_t keylen = strlen(key);
-  uint32_t hashindex;
-  // Compute the hash - use the key itself if 4 bytes or less
-  if (keylen <= 4) {
-    // Use the key itself for the hash value
-    hashindex = simple_hash(key, keylen);
-  } else {
-    // Use the MurmurHash function for longer keys.
-    hashindex = murmur3_32(key, keylen, 0);
-  }
-  hashindex %= hashtable->size;
-  // Create a new entry
-  ENTRY_t *newEntry = allocate_entry();
-  newEntry->key = strdup(key);
-  newEntry->child = child;
-  newEntry->next = NULL;
-
-  // Insert into the hash table
-  ENTRY_t* current = hashtable->table[hashindex];
-  if (current == NULL) {
-    hashtable->table[hashindex] = newEntry;
-  }
-  else {
-    // Handle collision with separate chaining
-    while (current->next != NULL) {
-      current = current->next;
-    }
-    current->next = newEntry;
+  if (children->oldslot) {
+    rehash_children(children, CHILD_REHASH_STEP);
   }
+  SLOT_t *slot = find_slot(children, murmur3_32(key, strlen(key), 0),
+                                                                key, NULL);
+  return slot ? children->child[slot->index - 1] : NULL;
 }
 
-ITEM_t *search_hashtable(HASHTABLE_t *hashtable, const char *key) {
-  size_t keylen = strlen(key);
-  uint32_t hashindex;
-  // Check if the key is less than or equal to 4 characters.
-  if (keylen <= 4) {
-    // Use the key itself for the hash value.
-    hashindex = simple_hash(key, keylen);
-  } else {
-    // Use the MurmurHash function for longer keys.
-    hashindex = murmur3_32(key, keylen, 0);
+void remove_child(ITEM_t *parent, ITEM_t *child) {
+  // Take a child out of its parent's children.  Its place in the child
+  // array is left empty, so nothing else moves.
+  CHILDREN_t *children = parent->children;
+  uint32_t hash = murmur3_32(child->name, strlen(child->name), 0);
+  if (children->oldslot) {
+    rehash_children(children, CHILD_REHASH_STEP);
   }
-  hashindex %= hashtable->size;
-  ENTRY_t *current = hashtable->table[hashindex];
-
-  while (current) {
-    if (strcmp(current->key, key) == 0) {
-      return current->child;
+  SLOT_t *slot = find_slot(children, hash, NULL, child);
+  if (!slot) {
+    return;
+  }
+  uint32_t index = slot->index;
+  if (children->count == 1) {
+    // That was the only child.  The index is emptied rather than freed,
+    // so that sequence numbers carry on from where they were, and a
+    // cursor held across the gap doesn't skip the children added next.
+    if (children->oldslot) {
+      rehash_children(children, UINT32_MAX);
     }
-    current = current->next;
+    memset(children->slot, 0, sizeof(SLOT_t) * (children->mask + 1));
+    children->count = 0;
+    children->used = 0;
+    children->cursor = 0;
+    children->cursorpos = 0;
+    return;
   }
-  return NULL;
-}
-
-void delete_hashtable(HASHTABLE_t *hashtable, const char *key) {
-    size_t keylen = strlen(key);
-  uint32_t hashindex;
-
-  // Check if the key is less than or equal to 4 characters.
-  if (keylen <= 4) {
-    // Use the key itself for the hash value.
-    hashindex = simple_hash(key, keylen);
-  } else {
-    // Use the MurmurHash function for longer keys.
-    hashindex = murmur3_32(key, keylen, 0);
-  }
-  hashindex %= hashtable->size;
-  ENTRY_t *current = hashtable->table[hashindex];
-  ENTRY_t *previous = NULL;
-  while (current) {
-    if (strcmp(current->key, key) == 0) {
-      if (previous == NULL) {
-        // Remove the first entry in the chain
-        hashtable->table[hashindex] = current->next;
-      } else {
-        // Remove the entry from the chain
-        previous->next = current->next;
-      }
-      free(current->key);
-      deallocate_entry(current);
-      return;
+  children->child[index - 1] = NULL;
+  children->count--;
+  if (children->oldslot && slot >= children->oldslot
+                        && slot <= &children->oldslot[children->oldmask]) {
+    // The old table must keep its runs intact, so just mark the slot.
+    slot->index = SLOT_REMOVED;
+    return;
+  }
+  // Empty the slot, moving back any later slot in the same run which
+  // would no longer be found once there is a hole in front of it.
+  uint32_t mask = children->mask;
+  uint32_t hole = slot - children->slot;
+  for (uint32_t next = (hole + 1) & mask; children->slot[next].index;
+                                                  next = (next + 1) & mask) {
+    uint32_t home = children->slot[next].hash & mask;
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      children->slot[hole] = children->slot[next];
+      hole = next;
     }
-    previous = current;
-    current = current->next;
   }
+  children->slot[hole].index = 0;
 }
 
-void free_hashtable(HASHTABLE_t* hashtable) {
-  for (int i = 0; i < hashtable->size; i++) {
-    ENTRY_t *current = hashtable->table[i];
-    while (current) {
-      ENTRY_t *temp = current;
-      current = current->next;
-      destroy_item(temp->child);
-      free(temp->key);
-      deallocate_entry(temp);
-    }
+void free_children(CHILDREN_t *children) {
+  // Free a child index.  The children themselves must already be gone.
+  slab_release(children->slot, sizeof(SLOT_t) * (children->mask + 1));
+  if (children->oldslot) {
+    slab_release(children->oldslot,
+                              sizeof(SLOT_t) * (children->oldmask + 1));
   }
-  free(hashtable->table);
-  deallocate_hashtable(hashtable);
+  slab_release(children->child, sizeof(ITEM_t *) * children->capacity);
+  deallocate_children(children);
 }
 
 uint32_t murmur3_32(const char *key, size_t len, uint32_t seed) {
@@ -278,40 +300,43 @@ char *substr(const char *str, size_t begin, size_t len) {
   }
 }
 
-ENTRY_t *allocate_entry() {
-  // Allocator API: Gimme a new ENTRY_t
-  ENTRY_t *newentry = NULL;
-  newentry = GROW_ARRAY(ENTRY_t, newentry, 0, 1);
-  return newentry;
-}
+// The allocator API hands out objects from slabs, so that a large
+// itemstore is built from a few big allocations rather than millions of
+// small ones, and deleted items are recycled.
 
-HASHTABLE_t *allocate_hashtable() {
-  // Allocator API: Gimme a new HASHTABLE_t
-  HASHTABLE_t *newhash = NULL;
-  newhash = GROW_ARRAY(HASHTABLE_t, newhash, 0, 1);
-  return newhash;
+CHILDREN_t *allocate_children() {
+  // Allocator API: Gimme a new CHILDREN_t
+  return (CHILDREN_t *)slab_allocate(sizeof(CHILDREN_t));
 }
 
 ITEM_t *allocate_item() {
-  ITEM_t *newitem = NULL;
-  newitem = GROW_ARRAY(ITEM_t, newitem, 0, 1);
   // Allocator API: Gimme a new Item
-  return newitem;
-}
-
-void deallocate_entry(ENTRY_t *entry) {
-  // Allocator API: Take this ENTRY_t back.
-  FREE_ARRAY(ENTRY_t, entry, 1);
+  return (ITEM_t *)slab_allocate(sizeof(ITEM_t));
 }
 
-void deallocate_hashtable(HASHTABLE_t *hashtable) {
-  // Allocator API: Take this HashTable back.
-  FREE_ARRAY(HASHTABLE_t, hashtable, 1);
+void deallocate_children(CHILDREN_t *children) {
+  // Allocator API: Take this CHILDREN_t back.
+  slab_release(children, sizeof(CHILDREN_t));
 }
 
 void deallocate_item(ITEM_t *item) {
   // Allocator API: Take this Item back.
-  FREE_ARRAY(ITEM_t, item, 1);
+  slab_release(item, sizeof(ITEM_t));
+}
+
+// Starts at 1, so that a zeroed cache is never current.
+_Thread_local uint32_t item_generation = 1;
+
+// Starts at 1, so that loaded items are older than any change.
+uint32_t change_epoch = 1;
+
+void mark_changed(ITEM_t *item) {
+  // Mark an item, and everything above it, as changed in this epoch.  Once
+  // an item is marked, so is everything above it, so stop there.
+  while (item && item->changed != change_epoch) {
+    item->changed = change_epoch;
+    item = item->parent;
+  }
 }
 
 ITEM_t *make_item(const char *name, ITEM_t *parent, ITEM_e type,
@@ -329,49 +354,59 @@ ITEM_t *make_item(const char *name, ITEM_t *parent, ITEM_e type,
     item->value = value;
   } else {
     // The bytecode is allocated elsewhere, before calling this function.
+    // It is decoded when the item is first run, so that loading a big
+    // itemstore doesn't decode code which may never be used.
     item->bytecode = bytecode;
     item->bytecode_len = len;
   }
   strncpy(item->name, name, strlen(name)+1);
-  item->children = create_hashtable(16); // Size is chosen arbitrarily
-  create_ordered_array(item);
-  // Now add the newly-created item to its parent's hashtable
-  insert_hashtable(parent->children, name, item);
-  // Maybe resize the hashtable?
-  parent->children = maybe_resize_hashtable(parent->children);
-
-  // And insert into the ordered array
-  resize_ordered_array(parent);
-  parent->ordered_array[parent->ordered_size++] = item;
+  // Now add the newly-created item to its parent's children.  Its own
+  // child index is only made when it gets a child.
+  insert_child(parent, item);
+  item_generation++;
   return item;
 }
 
 ITEM_t *make_root_item(const char* name) {
   // This is exactly the same as make_item, except that it doesn't try to
-  // insert the item into its parent's hashtable.  This is a separate
+  // insert the item into its parent's children.  This is a separate
   // function for performance reasons - it is only ever used ONCE, so there
   // is no point having an additional if statement that always evaluates
   // one way.
   ITEM_t *item = allocate_item();
   item->parent = NULL;
   item->type = ITEM_value;
-  item->value.type = VALUE_int;
-  item->value.i = 0; // Root item is never reference, so this doesn't matter
+  // Root item is never reference, so this doesn't matter
+  item->value = VALUE_ZERO;
   strncpy(item->name, name, strlen(name)+1);
-  item->children = create_hashtable(16); // Size is chosen arbitrarily
-  create_ordered_array(item);
+  item_generation++;
   return item;
 }
 
+static void free_bytecode(ITEM_t *item) {
+  // Bytecode in a mapped itemstore isn't ours to free.
+  if (item->bytecode_len > 0 && !item->mapped) {
+    FREE_ARRAY(uint8_t, item->bytecode, item->bytecode_len);
+  }
+  item->mapped = false;
+}
+
 void destroy_item(ITEM_t *item) {
   if (item->type == ITEM_code) {
-    free(item->bytecode);
-  } else if (item->type == ITEM_value && item->value.type == VALUE_str) {
-    free(item->value.s);
+    free_bytecode(item);
+    free_decoded(item->decoded);
+  } else if (item->type == ITEM_value && IS_STR(item->value)) {
+    release_string(AS_STR(item->value));
   }
   // Free the item's innards
-  free_hashtable(item->children);
-  free(item->ordered_array);
+  if (item->children) {
+    for (uint32_t i = 0; i < item->children->used; i++) {
+      if (item->children->child[i]) {
+        destroy_item(item->children->child[i]);
+      }
+    }
+    free_children(item->children);
+  }
   // Then free the item
   deallocate_item(item);
 }
@@ -393,11 +428,11 @@ ITEM_t *insert_item(ITEM_t *root, const char *item_name, VALUE_t value) {
     memcpy(layer, current_pos, layer_len);
     layer[layer_len] = '\0';
     // Check if the current layer exists as a child of the current item
-    ITEM_t *child_item = search_hashtable(current_item->children, layer);
+    ITEM_t *child_item = search_children(current_item->children, layer);
     if (child_item == NULL) {
       // If the child does not exist, create it with a default value of 0
-      VALUE_t nil = {VALUE_nil, {0}};
-      child_item = make_item(layer, current_item, ITEM_value, nil, NULL, 0);
+      child_item = make_item(layer, current_item, ITEM_value, VALUE_NIL,
+                                                                    NULL, 0);
     }
     // Move to the child item
     current_item = child_item;
@@ -406,9 +441,8 @@ ITEM_t *insert_item(ITEM_t *root, const char *item_name, VALUE_t value) {
       // Possibly free currently in-use memory
       // (it might have been newly-created, or might already exist)
       if (current_item->type == ITEM_value &&
-                                    current_item->value.type == VALUE_str) {
-          FREE_ARRAY(char, current_item->value.s,
-                                           strlen(current_item->value.s+1));
+                                    IS_STR(current_item->value)) {
+        release_string(AS_STR(current_item->value));
       } else if (current_item->type == ITEM_code) {
         if (current_item->inuse) {
           char name[MAX_ITEM_NAME];
@@ -416,12 +450,20 @@ ITEM_t *insert_item(ITEM_t *root, const char *item_name, VALUE_t value) {
           logerr("Cannot delete item %s: currently in use.\n", name);
           return NULL;
         }
-        if (current_item->bytecode_len > 0) {
-          FREE_ARRAY(uint8_t, current_item->bytecode,
-                                                current_item->bytecode_len);
-        }
+        free_bytecode(current_item);
+        free_decoded(current_item->decoded);
+        current_item->decoded = NULL;
+        current_item->bytecode = NULL;
+        current_item->bytecode_len = 0;
+        current_item->type = ITEM_value;
+      }
+      if (IS_STR(value)) {
+        // Items keep their strings in one piece.
+        STRING_CHARS(AS_STR(value));
       }
       current_item->value = value;
+      mark_changed(current_item);
+      journal_insert(item_name, value);
       break;
     }
     // Otherwise, move past the dot to the beginning of the next layer
@@ -448,11 +490,11 @@ ITEM_t *insert_code_item(ITEM_t *root, const char *item_name, uint32_t len,
     memcpy(layer, current_pos, layer_len);
     layer[layer_len] = '\0';
     // Check if the current layer exists as a child of the current item
-    ITEM_t *child_item = search_hashtable(current_item->children, layer);
+    ITEM_t *child_item = search_children(current_item->children, layer);
     if (child_item == NULL) {
       // If the child does not exist, create it with a default value of 0
-      VALUE_t nil = {VALUE_nil, {0}};
-      child_item = make_item(layer, current_item, ITEM_value, nil, NULL, 0);
+      child_item = make_item(layer, current_item, ITEM_value, VALUE_NIL,
+                                                                    NULL, 0);
     }
     // Move to the child item
     current_item = child_item;
@@ -460,18 +502,19 @@ ITEM_t *insert_code_item(ITEM_t *root, const char *item_name, uint32_t len,
       // If there's no next dot, we've reached the last layer
       // It's code item, remember!
       if (current_item->type == ITEM_value
-                              && current_item->value.type == VALUE_str) {
-        FREE_ARRAY(char, current_item->value.s,
-                                           strlen(current_item->value.s+1));
+                              && IS_STR(current_item->value)) {
+        release_string(AS_STR(current_item->value));
       }
       current_item->type = ITEM_code;
-      current_item->value.type = VALUE_nil; // Just to be safe
-      if (current_item->bytecode_len > 0) {
-        FREE_ARRAY(unsigned char, current_item->bytecode,
-                                           current_item->bytecode_len);
-      }
+      current_item->value = VALUE_NIL; // Just to be safe
+      free_bytecode(current_item);
+      // Any previously decoded form belongs to the old bytecode.
+      free_decoded(current_item->decoded);
       current_item->bytecode_len = len;
       current_item->bytecode = bytecode;
+      current_item->decoded = decode_bytecode(bytecode, len);
+      mark_changed(current_item);
+      journal_code(item_name, len, bytecode);
       break;
     }
     // Otherwise, move past the dot to the beginning of the next layer
@@ -496,7 +539,7 @@ ITEM_t *find_item(ITEM_t *root, const char *item_name) {
     memcpy(layer, current_pos, layer_len);
     layer[layer_len] = '\0'; // Null-terminate the layer string
     // Move to the next layer of the item
-    current_item = search_hashtable(current_item->children, layer);
+    current_item = search_children(current_item->children, layer);
     // If there's no next dot, we've reached the last layer
     if (next_dot == NULL) {
       break;
@@ -507,13 +550,82 @@ ITEM_t *find_item(ITEM_t *root, const char *item_name) {
   return current_item;
 }
 
+ITEM_t *find_item_cached(ITEM_t *root, const char *item_name,
+                                                      ITEM_CACHE_t *cache) {
+  // As find_item(), but remember the result.  While no item has been
+  // created or deleted, the same answer is given without a lookup.
+  if (cache->generation != item_generation) {
+    cache->item = find_item(root, item_name);
+    cache->generation = item_generation;
+  }
+  return cache->item;
+}
+
 ITEM_t *find_item_by_index(ITEM_t *parent, const size_t index) {
-  // Given the parent item, return the indexed child.
-  if (index >= parent->ordered_size) {
+  // Given the parent item, return the indexed child.  If children have
+  // been deleted, they have to be counted past, so next_child() is the
+  // better way to visit them all.
+  CHILDREN_t *children = parent->children;
+  if (!children || index >= children->count) {
     // No item at that index.
     return NULL;
   }
-  return parent->ordered_array[index];
+  if (children->count == children->used) {
+    return children->child[index];
+  }
+  size_t n = index;
+  for (uint32_t i = 0; i < children->used; i++) {
+    if (children->child[i] && n-- == 0) {
+      return children->child[i];
+    }
+  }
+  return NULL;
+}
+
+ITEM_t *next_child(ITEM_t *parent, uint32_t *cursor) {
+  // Given the parent item and a cursor, return the next child and move
+  // the cursor past it, or return NULL when there are no more.  A cursor
+  // of 0 starts from the first child.  The cursor is the sequence number
+  // of the child to carry on from, so children may be added and deleted
+  // between calls without any being visited twice or missed (apart from
+  // those deleted, of course).
+  CHILDREN_t *children = parent->children;
+  if (!children) {
+    return NULL;
+  }
+  uint32_t pos;
+  if (*cursor == children->cursor) {
+    // Usually this is carrying on from where the last call left off.
+    pos = children->cursorpos;
+  } else {
+    // Otherwise, the children are in sequence order, so search for the
+    // first at or after the cursor.  Deleted children are skipped over.
+    uint32_t lo = 0, hi = children->used;
+    while (lo < hi) {
+      uint32_t mid = lo + (hi - lo) / 2;
+      uint32_t m = mid;
+      while (m < hi && !children->child[m]) {
+        m++;
+      }
+      if (m == hi || children->child[m]->seq >= *cursor) {
+        hi = mid;
+      } else {
+        lo = m + 1;
+      }
+    }
+    pos = lo;
+  }
+  while (pos < children->used && !children->child[pos]) {
+    pos++;
+  }
+  if (pos >= children->used) {
+    return NULL;
+  }
+  ITEM_t *child = children->child[pos];
+  *cursor = child->seq + 1;
+  children->cursor = *cursor;
+  children->cursorpos = pos + 1;
+  return child;
 }
 
 void delete_item(ITEM_t *root, const char *item_name) {
@@ -528,21 +640,13 @@ void delete_item(ITEM_t *root, const char *item_name) {
     }
     // We don't care about items that don't exist, just silently ignore the
     // delete request.  It's not there anyway, so why the complaining?
-    // First, remove the item from its parent's hashtable:
-    delete_hashtable(item->parent->children, item->name);
-    // Remove from order array
-    for (size_t i = 0; i < item->parent->ordered_size; i++) {
-      if (item->parent->ordered_array[i] == item) {
-        // Shift elements left
-        for (size_t j = i; j < item->parent->ordered_size - 1; j++) {
-          item->parent->ordered_array[j] = item->parent->ordered_array[j + 1];
-        }
-        item->parent->ordered_size--;
-        break;
-      }
-    }
+    // First, remove the item from its parent's children:
+    mark_changed(item->parent);
+    remove_child(item->parent, item);
     // Now we have isolated this item, delete it and all its children.
     destroy_item(item);
+    item_generation++;
+    journal_delete(item_name);
     ITEMDEBUG_LOG("Item %s has been deleted, along with all of its children.\n",
                                                                  item_name);
   }
@@ -555,10 +659,15 @@ void set_item(ITEM_t *root, const char *item_name, VALUE_t value) {
   ITEM_t *item = find_item(root, item_name);
   if (item) {
     // Item exists, so just update its value.
-    if (item->value.type == VALUE_str) {
-      free(item->value.s);
+    if (IS_STR(item->value)) {
+      release_string(AS_STR(item->value));
+    }
+    if (IS_STR(value)) {
+      STRING_CHARS(AS_STR(value));
     }
     item->value = value;
+    mark_changed(item);
+    journal_set(item_name, value);
   } else {
     // Item doesn't exist, so create it.
     insert_item(root, item_name, value);
@@ -631,126 +740,6 @@ bool save_itemsource(ITEM_t *item, char *source) {
   return true;
 }
 
-void write_item(FILE *file, ITEM_t *item) {
-  // Write the item name as a fixed size of 32 bytes
-  char name[33]; // 32 characters + 1 for null-terminator
-  strncpy(name, item->name, 32);
-  name[32] = '\0'; // Ensure null-termination
-  fwrite(name, sizeof(char), 33, file); // Write the fixed size name
-  // Write the type of the item - there are several types but on disk they
-  // degrade to either an int or a string.  When reading the item back
-  // from disk, the item type determines how exactly it is created.
-  fwrite(&(item->type), sizeof(item->type), 1, file);
-  if (item->type == ITEM_value) {
-    fwrite(&(item->value.type), sizeof(item->value.type), 1, file);
-    if (item->value.type == VALUE_str) {
-      int l = strlen(item->value.s);
-      fwrite(&(l), sizeof(l), 1, file);
-      fwrite(item->value.s, sizeof(char), l, file);
-    } else {
-      fwrite(&(item->value.i), sizeof(item->value.i), 1, file);
-    }
-  } else if (item->type == ITEM_code) {
-    fwrite(&(item->bytecode_len), sizeof(item->bytecode_len), 1, file);
-    fwrite(item->bytecode, sizeof(uint8_t), item->bytecode_len, file);
-  }
-  // Write the number of children
-  uint32_t numchildren = 0;
-  for (int i = 0; i < item->children->size; i++) {
-    ENTRY_t *entry = item->children->table[i];
-    while (entry) {
-      numchildren++;
-      entry = entry->next;
-    }
-  }
-  fwrite(&numchildren, sizeof(numchildren), 1, file);
-  // Write each child
-  for (int i = 0; i < item->children->size; i++) {
-    ENTRY_t *entry = item->children->table[i];
-    while (entry) {
-      // Write the child item
-      write_item(file, entry->child);
-      entry = entry->next;
-    }
-  }
-}
-
-void save_itemstore(const char *filename, ITEM_t *root) {
-  FILE* file = fopen(filename, "wb");
-  if (file == NULL) {
-    logerr("Failed to open itemstore for writing");
-    return;
-  } else {
-    write_item(file, root);
-    fclose(file);
-  }
-}
-
-ITEM_t *read_item(FILE *file, ITEM_t *parent) {
-  char name[33];
-  fread(name, sizeof(char), 33, file);
-  name[32] = '\0'; // Ensure null-termination
-  ITEM_e type;
-  fread(&type, sizeof(ITEM_e), 1, file);
-  int64_t value;
-  char *strvalue;
-  uint8_t *bytecode;
-  uint32_t bytecode_len;
-  VALUE_e valtype;
-  VALUE_t itemval;
-  if (type == ITEM_value) {
-    fread(&valtype, sizeof(valtype), 1, file);
-    itemval.type = valtype;
-    switch (valtype) {
-      // These types are all represented as an int - only the type differs
-      case VALUE_nil:
-      case VALUE_int:
-      case VALUE_bool:
-      {
-        fread(&value, sizeof(value), 1, file);
-        itemval.i = value;
-        break;
-      }
-      case VALUE_str:
-      {
-        int l;
-        fread(&l, sizeof(l), 1, file); // length of string
-        strvalue = (char*)malloc(l+1); // +1 for terminator
-        fread(strvalue, sizeof(char), l, file);
-        strvalue[l] = '\0';
-        itemval.s = strvalue;
-        break;
-      }
-    }
-  } else if(type == ITEM_code) {
-    fread(&bytecode_len, sizeof(bytecode_len), 1, file);
-    bytecode = (uint8_t*)malloc(bytecode_len);
-    fread(bytecode, sizeof(uint8_t), bytecode_len, file);
-  }
-  uint32_t numchildren;
-  fread(&numchildren, sizeof(numchildren), 1, file);
-    // Create the item with its value
-  ITEM_t *item = (parent == NULL) ? make_root_item(name)
-         : make_item(name, parent, type, itemval, bytecode, bytecode_len);
-  // Read children if they exist
-  for (uint32_t i = 0; i < numchildren; i++) {
-    read_item(file, item);
-  }
-  return item;
-}
-
-ITEM_t *load_itemstore(const char *filename) {
-  FILE *file = fopen(filename, "rb");
-  if (file == NULL) {
-    logerr("Failed to open itemstore for reading");
-    return NULL;
-  } else {
-    ITEM_t *root = read_item(file, NULL); // Build the itemstore from root.
-    fclose(file);
-    return root;
-  }
-}
-
 void dump_item(ITEM_t *item, char *item_name, bool isroot) {
   // Recursive function to construct and print the fully-qualified itemstore
   // from a given node. If passing the root of the itemstore,
@@ -774,24 +763,21 @@ void dump_item(ITEM_t *item, char *item_name, bool isroot) {
   }
   // Only print if this is not the root item
   if (!isroot) {
-    if (item->value.type == VALUE_int) {
+    if (IS_INT(item->value)) {
       logmsg("Item: %s, Value: %llu\n", currentpath,
-                                     (unsigned long long)item->value.i);
-    } else if (item->value.type == VALUE_str) {
-      logmsg("Item: %s, Value: '%s'\n", currentpath, item->value.s);
+                               (unsigned long long)AS_INT(item->value));
+    } else if (IS_STR(item->value)) {
+      logmsg("Item: %s, Value: '%s'\n", currentpath, STRING_CHARS(AS_STR(item->value)));
     } else {
       logmsg("Item: %s, Value: (unknown)\n", currentpath);
     }
   }
-  // If the item has children, iterate over the hash table and calli
-  // dumpItem on each
+  // If the item has children, call dump_item on each
   if (item->children != NULL) {
-    for (int i = 0; i < item->children->size; ++i) {
-      ENTRY_t *entry = item->children->table[i];
-      while (entry != NULL) {
-        // Pass isroot as false because we are past the root now
-        dump_item(entry->child, currentpath, false);
-        entry = entry->next;
+    for (uint32_t i = 0; i < item->children->used; ++i) {
+      // Pass isroot as false because we are past the root now
+      if (item->children->child[i]) {
+        dump_item(item->children->child[i], currentpath, false);
       }
     }
   }
@@ -820,12 +806,9 @@ bool is_valid_layer(const char *str) {
 
 void set_error_item(const int errnum) {
   // Helper function to set the error item.
-  VALUE_t e, emsg;
-  e.type = VALUE_int;
-  e.i = errnum;
+  VALUE_t e = INT_VALUE(errnum);
   set_item(config.itemroot, "error", e);
-  emsg.type = VALUE_str;
-  emsg.s = strdup(errmsg[errnum]);
+  VALUE_t emsg = make_string_value(errmsg[errnum]);
   set_item(config.itemroot, "error.msg", emsg);
 }
 
@@ -20,66 +20,99 @@
 // and a terminating null.  So the maximum size is (32 * 8) + 7 + 1.
 #define MAX_ITEM_NAME 264
 
-// Item children are also stored in an indexable array for iteration
-// performance.  This value controls the size of that array.
-#define ITEM_ARRAY_INIT_CAPACITY  10
+// An item's child index starts with this many slots, and doubles in size
+// whenever it becomes three quarters full.  It must be a power of two.
+// After doubling, the children are moved into the new table this many
+// slots at a time, by each operation on the index.  There must be at
+// least two, so that the move is finished before it is needed again.
+#define CHILD_INIT_SLOTS  8
+#define CHILD_REHASH_STEP 4
 
 typedef struct Item ITEM_t;
-typedef struct Entry ENTRY_t;
-typedef struct HashTable HASHTABLE_t;
-
-// Define the hash table entry
-struct Entry {
-  char *key;
-  ITEM_t *child;
-  ENTRY_t *next;
-};
+typedef struct Children CHILDREN_t;
+typedef struct Decoded DECODED_t;
+
+// One slot of a child index.  The hash of the child's name is kept here,
+// so that a probe only needs to look at the child when the hashes match.
+typedef struct {
+  uint32_t hash;
+  uint32_t index;  // Position in the child array plus one, or 0 if empty
+} SLOT_t;
 
-// This hashtable contains pointers to all the children of this Item.
-struct HashTable {
-  uint32_t size;
-  ENTRY_t **table; // An array of pointers to ENTRY_t
+// The children of an item, in the order in which they were added.  The
+// array is used for iteration, and the open-addressed table of slots
+// finds a child by name.  Items which have never had children don't have
+// one at all, but one whose children have all gone keeps its empty index,
+// so that sequence numbers are never used twice.
+// A deleted child leaves a NULL in the array, and the array is squeezed
+// when it fills up with too many of them.
+struct Children {
+  uint32_t count;    // Number of children
+  uint32_t used;     // Entries of the child array used, including NULLs
+  uint32_t capacity; // Size of the child array
+  uint32_t nextseq;  // Sequence number of the next child added
+  uint32_t cursor;   // The cursor last returned by next_child()...
+  uint32_t cursorpos; // ...and the array position it continues from
+  uint32_t mask;     // Number of slots, less one
+  SLOT_t *slot;      // The lookup table
+  uint32_t oldmask;  // Number of slots in the old table, less one
+  uint32_t rehashed; // Old slots which have been moved to the new table
+  SLOT_t *oldslot;   // The table before it grew, or NULL
+  ITEM_t **child;    // The children themselves
 };
 
 typedef enum {ITEM_value, ITEM_code} ITEM_e;
+// A remembered item lookup.  It only holds while the generation of the
+// itemstore is unchanged, because any item may have been created or
+// deleted since.  A NULL item records that the item did not exist.
+typedef struct {
+  ITEM_t *item;
+  uint32_t generation;
+} ITEM_CACHE_t;
+
 struct Item {
   ITEM_e type;           // 4 bytes
   uint32_t bytecode_len; // 4 bytes
   char name[33];         // 33 bytes (32 characters + null terminator)
   bool inuse;            // Set when an item is being executed.
-  uint8_t pad[7];        // 6 bytes of padding for 8-byte alignment
+  bool mapped;           // Set when the bytecode is in a mapped itemstore
+  uint8_t pad[1];        // 1 byte of padding for 4-byte alignment
+  uint32_t seq;          // 4 bytes - Order among its siblings
+  uint32_t changed;      // 4 bytes - Epoch of the last change at or below
+  uint32_t saved;        // 4 bytes - Epoch of its segment, if top-level
   ITEM_t *parent;        // 8 bytes - Pointer to the parent item
-  HASHTABLE_t *children; // 8 bytes - Hash table for immediate children
+  CHILDREN_t *children;  // 8 bytes - Immediate children, or NULL if none
   uint8_t *bytecode;     // 8 bytes - Bytecode if a code item
-  VALUE_t value;         // 16 bytes - (at present)
-  uint8_t ordered_size;  // Number of children in the ordered array
-  uint8_t ordered_capacity; // Max size of ordered array
-  ITEM_t **ordered_array; // Ordered array of all children
+  DECODED_t *decoded;    // 8 bytes - Pre-decoded bytecode if a code item
+  VALUE_t value;         // 8 bytes
 };
 
+// Bumped whenever an item is created or deleted.  Threads which build
+// items while the itemstore loads each count their own; only the main
+// thread's count is ever looked at.
+extern _Thread_local uint32_t item_generation;
+
+// Changes to the itemstore are marked with the current epoch, on the item
+// changed and all of the items above it, so that a checkpoint can tell
+// which parts of the itemstore need saving.  Each checkpoint begins a new
+// epoch.  Items which have not changed since they were loaded have an
+// epoch of 0.
+extern uint32_t change_epoch;
+
 // These functions are not intended to be called externally.
-HASHTABLE_t *create_hashtable(int size);
-uint32_t simple_hash(const char *key, size_t len);
-HASHTABLE_t *resize_hashtable(HASHTABLE_t *oldhashtable, int newsize);
-float calculate_load_factor(HASHTABLE_t *hashTable);
-HASHTABLE_t *maybe_resize_hashtable(HASHTABLE_t *hashtable);
-void insert_hashtable(HASHTABLE_t *hashtable, const char *key, ITEM_t *child);
-ITEM_t *search_hashtable(HASHTABLE_t *hashtable, const char *key);
-void delete_hashtable(HASHTABLE_t *hashtable, const char *key);
-void free_hashtable(HASHTABLE_t *hashtable);
+void insert_child(ITEM_t *parent, ITEM_t *child);
+ITEM_t *search_children(CHILDREN_t *children, const char *key);
+void remove_child(ITEM_t *parent, ITEM_t *child);
+void free_children(CHILDREN_t *children);
 uint32_t murmur3_32(const char *key, size_t len, uint32_t seed);
 char *substr(const char *str, size_t begin, size_t len);
-void write_item(FILE *file, ITEM_t *item);
-ITEM_t *read_item(FILE *file, ITEM_t *parent);
 
 // Allocator API
 // Defined in the itemstore as it defines allocators for specific
 // object types.  Probably needs to be defined elsewhere, though.
-ENTRY_t *allocate_entry();
-HASHTABLE_t *allocate_hashtable();
+CHILDREN_t *allocate_children();
 ITEM_t *allocate_item();
-void deallocate_entry(ENTRY_t *entry);
-void deallocate_hashtable(HASHTABLE_t *hashtable);
+void deallocate_children(CHILDREN_t *children);
 void deallocate_item(ITEM_t *item);
 
 // Itemstore API
@@ -91,14 +124,16 @@ ITEM_t *insert_item(ITEM_t *root, const char *item_name, VALUE_t value);
 ITEM_t *insert_code_item(ITEM_t *root, const char *item_name, uint32_t len,
                                                         uint8_t *bytecode);
 ITEM_t *find_item(ITEM_t *root, const char *item_name);
+ITEM_t *find_item_cached(ITEM_t *root, const char *item_name,
+                                                      ITEM_CACHE_t *cache);
 ITEM_t *find_item_by_index(ITEM_t *parent, const size_t index);
+ITEM_t *next_child(ITEM_t *parent, uint32_t *cursor);
+void mark_changed(ITEM_t *item);
 void delete_item(ITEM_t *root, const char *item_name);
 void set_item(ITEM_t *root, const char *item_name, VALUE_t value);
 void get_itemname(ITEM_t *item, char *itemname);
 char *get_itemfilename(ITEM_t *item);
 bool save_itemsource(ITEM_t *item, char *source);
-void save_itemstore(const char *filename, ITEM_t *root); 
-ITEM_t *load_itemstore(const char *filename); 
 void dump_item(ITEM_t *item, char *item_name, bool isroot);
 
 // Other item-related API functions
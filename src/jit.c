@@ -0,0 +1,710 @@
+// The template JIT
+
+// Licensed under the MIT License - see LICENSE file for details.
+
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "config.h"
+#include "memory.h"
+#include "log.h"
+#include "item.h"
+#include "jit.h"
+
+// The configuration object, defined in sin.c
+extern CONFIG_t config;
+
+// Some shorthand
+#define VM config.vm
+
+#ifdef NATIVE_CODE
+
+// While the machine code runs, the registers which survive calls hold:
+//
+//   rbx  where to write the stack pointer back to
+//   r12  the stack pointer (the top value, as sp in the interpreter)
+//   r13  the frame base (bp)
+//   r14  a scratch value to keep across a call
+//   r15  the top of the stack, for overflow checks
+//
+// The code starts with a prologue, which is called from C as an ENTRY_t,
+// saves those registers, and jumps to the instruction to start from.  It
+// finishes at the epilogue with the index of an instruction in eax: the
+// one for the interpreter to carry on with.
+typedef uint32_t (*ENTRY_t)(VALUE_t **sp, VALUE_t *bp, VALUE_t *top,
+                                                        const uint8_t *from);
+
+// Registers, as numbered in the instruction encodings.
+#define RAX 0
+#define RCX 1
+#define RDX 2
+#define RSI 6
+#define RDI 7
+
+// Condition codes.  The opposite of each is the one with the low bit
+// flipped.
+#define CC_E   0x4
+#define CC_NE  0x5
+#define CC_AE  0x3
+#define CC_L   0xc
+#define CC_GE  0xd
+#define CC_LE  0xe
+#define CC_G   0xf
+#define CC_JMP 0xff // Not a condition at all
+
+// A jump to an instruction, to be filled in once every instruction has
+// been placed.
+typedef struct {
+  size_t at;            // Where the 32-bit displacement goes
+  uint32_t target;      // The instruction jumped to
+} FIXUP_t;
+
+typedef struct {
+  uint8_t *buf;
+  size_t len;
+  size_t capacity;
+  FIXUP_t *fixup;
+  uint32_t fixups;
+  uint32_t fixupcapacity;
+  size_t epilogue;      // Where the epilogue starts
+  ITEM_t *item;         // The item being compiled
+  const OP_t *opcode;   // The interpreter's opcode table
+} ASM_t;
+
+static void put(ASM_t *a, const void *bytes, size_t n) {
+  if (a->len + n > a->capacity) {
+    size_t capacity = a->capacity;
+    while (a->len + n > capacity) {
+      capacity = GROW_CAPACITY(capacity);
+    }
+    a->buf = GROW_ARRAY(uint8_t, a->buf, a->capacity, capacity);
+    a->capacity = capacity;
+  }
+  memcpy(a->buf + a->len, bytes, n);
+  a->len += n;
+}
+
+// Put the bytes of an instruction which has no variable parts.
+#define EMIT(a, ...) do { \
+    static const uint8_t bytes_[] = {__VA_ARGS__}; \
+    put(a, bytes_, sizeof(bytes_)); \
+  } while (0)
+
+static void put32(ASM_t *a, uint32_t n) {
+  put(a, &n, 4);
+}
+
+static void put64(ASM_t *a, uint64_t n) {
+  put(a, &n, 8);
+}
+
+static void patch(ASM_t *a, size_t at, size_t to) {
+  // Make the displacement at 'at' reach 'to'.
+  int32_t disp = to - (at + 4);
+  memcpy(a->buf + at, &disp, 4);
+}
+
+static size_t jump_ahead(ASM_t *a, uint8_t cc) {
+  // A jump (or a conditional one) to somewhere not yet known.  Returns
+  // where its displacement is, for land() to fill in.
+  if (cc == CC_JMP) {
+    EMIT(a, 0xe9);
+  } else {
+    EMIT(a, 0x0f);
+    put(a, &(uint8_t){0x80 | cc}, 1);
+  }
+  size_t at = a->len;
+  put32(a, 0);
+  return at;
+}
+
+static void land(ASM_t *a, size_t at) {
+  // Bring a jump made by jump_ahead() here.
+  patch(a, at, a->len);
+}
+
+static void jump_to(ASM_t *a, uint8_t cc, uint32_t target) {
+  // Jump to the instruction at index target.
+  if (a->fixups >= a->fixupcapacity) {
+    uint32_t capacity = GROW_CAPACITY(a->fixupcapacity);
+    a->fixup = GROW_ARRAY(FIXUP_t, a->fixup, a->fixupcapacity, capacity);
+    a->fixupcapacity = capacity;
+  }
+  a->fixup[a->fixups].at = jump_ahead(a, cc);
+  a->fixup[a->fixups].target = target;
+  a->fixups++;
+}
+
+static void mov_imm(ASM_t *a, uint8_t reg, uint64_t n) {
+  // mov reg, imm64
+  put(a, (uint8_t[]){0x48, 0xb8 + reg}, 2);
+  put64(a, n);
+}
+
+static void local_op(ASM_t *a, uint8_t op, uint8_t reg, uint8_t local) {
+  // An instruction between reg and a local: op reg, [r13 + local * 8]
+  put(a, (uint8_t[]){0x49, op, 0x85 | (reg << 3)}, 3);
+  put32(a, local * sizeof(VALUE_t));
+}
+
+static void call(ASM_t *a, const void *fn) {
+  // mov rax, fn; call rax
+  mov_imm(a, RAX, (uintptr_t)fn);
+  EMIT(a, 0xff, 0xd0);
+}
+
+static void leave_at(ASM_t *a, uint32_t index) {
+  // Go back to the interpreter, to carry on with instruction index.
+  put(a, &(uint8_t){0xb8}, 1);           // mov eax, index
+  put32(a, index);
+  EMIT(a, 0xe9);                         // jmp epilogue
+  put32(a, 0);
+  patch(a, a->len - 4, a->epilogue);
+}
+
+// The functions which the machine code calls.  Those which use the VM
+// stack are given the stack pointer, and return it as they leave it.
+
+static VALUE_t *call_op(VALUE_t *sp, OP_t op, uint8_t *raw, ITEM_t *item) {
+  // Run an opcode function, as the interpreter's generic handler does.
+  STACK_t *stack = VM->stack;
+  stack->current = sp - stack->stack;
+  op(raw, item);
+  return stack->stack + stack->current;
+}
+
+static VALUE_t *call_assemble(VALUE_t *sp, ASSEMBLY_t *assembly,
+                                                            ITEM_t *item) {
+  STACK_t *stack = VM->stack;
+  stack->current = sp - stack->stack;
+  assemble_decoded(assembly, item);
+  return stack->stack + stack->current;
+}
+
+static VALUE_t *call_fetch(VALUE_t *sp, INSTR_t *in, ITEM_t *item) {
+  // Fetch an item whose name is on the stack.  If it is a code item to be
+  // called, leave everything as it is and return NULL, so that the
+  // interpreter can call it.  The same goes for a name which is not a
+  // string, which the interpreter complains about.
+  if (!IS_STR(*sp)) {
+    return NULL;
+  }
+  STRING_t *name = AS_STR(*sp);
+  ITEM_t *i = find_item(config.itemroot, STRING_CHARS(name));
+  if (i && i->type == ITEM_code && decoded_code(i)->instr) {
+    return NULL;
+  }
+  STACK_t *stack = VM->stack;
+  *sp = VALUE_NIL;
+  stack->current = (sp - 1) - stack->stack;
+  fetchitem(i, STRING_CHARS(name), in->n, in->raw + 2, item);
+  release_string(name);
+  return stack->stack + stack->current;
+}
+
+static VALUE_t *call_fetchstatic(VALUE_t *sp, INSTR_t *in, ITEM_t *item) {
+  // As call_fetch(), for an item with a fixed name.
+  ASSEMBLY_t *assembly = in->assembly;
+  ITEM_t *i = find_item_cached(config.itemroot, assembly->name->chars,
+                                                        &assembly->cache);
+  if (i && i->type == ITEM_code && decoded_code(i)->instr) {
+    return NULL;
+  }
+  STACK_t *stack = VM->stack;
+  stack->current = sp - stack->stack;
+  fetchitem(i, assembly->name->chars, in->n, in->raw, item);
+  return stack->stack + stack->current;
+}
+
+static VALUE_t *call_existsstatic(VALUE_t *sp, ASSEMBLY_t *assembly) {
+  STACK_t *stack = VM->stack;
+  stack->current = sp - stack->stack;
+  push_stack(stack, find_item_cached(config.itemroot, assembly->name->chars,
+                              &assembly->cache) ? VALUE_TRUE : VALUE_FALSE);
+  return stack->stack + stack->current;
+}
+
+static VALUE_t *call_assignstatic(VALUE_t *sp, ASSEMBLY_t *assembly) {
+  STACK_t *stack = VM->stack;
+  VALUE_t val = *sp;
+  *sp = VALUE_NIL;
+  stack->current = (sp - 1) - stack->stack;
+  assignitem_static(assembly, val);
+  return stack->stack + stack->current;
+}
+
+static bool string_truth(VALUE_t v) {
+  // A string is true if it is not empty.  The value is used up.
+  bool truth = AS_STR(v)->len > 0;
+  release_string(AS_STR(v));
+  return truth;
+}
+
+static void pass_sp(ASM_t *a, const void *fn, uint64_t arg1,
+                                          uint64_t arg2, uint64_t arg3) {
+  // rax = fn(sp, arg1, arg2, arg3)
+  EMIT(a, 0x4c, 0x89, 0xe7);             // mov rdi, r12
+  mov_imm(a, RSI, arg1);
+  mov_imm(a, RDX, arg2);
+  mov_imm(a, RCX, arg3);
+  call(a, fn);
+}
+
+static void call_helper(ASM_t *a, const void *fn, uint64_t arg1,
+                                          uint64_t arg2, uint64_t arg3) {
+  // sp = fn(sp, arg1, arg2, arg3)
+  pass_sp(a, fn, arg1, arg2, arg3);
+  EMIT(a, 0x49, 0x89, 0xc4);             // mov r12, rax
+}
+
+static void generic(ASM_t *a, OP_t op, uint8_t *raw) {
+  // Hand an instruction to its opcode function.
+  call_helper(a, call_op, (uintptr_t)op, (uintptr_t)raw,
+                                                    (uintptr_t)a->item);
+}
+
+static void free_local(ASM_t *a, uint8_t local) {
+  // FREE_STR(bp[local])
+  local_op(a, 0x8b, RDI, local);         // mov rdi, [r13 + local]
+  EMIT(a, 0x89, 0xf8,                    // mov eax, edi
+          0x83, 0xe0, VALUE_TAG_MASK,    // and eax, 7
+          0x83, 0xf8, VALUE_TAG_str);    // cmp eax, 2
+  size_t notstr = jump_ahead(a, CC_NE);
+  EMIT(a, 0x48, 0x83, 0xef, VALUE_TAG_str); // sub rdi, 2
+  call(a, release_string);
+  land(a, notstr);
+}
+
+static void emit_getlocal(ASM_t *a, INSTR_t *in) {
+  EMIT(a, 0x4d, 0x39, 0xfc);             // cmp r12, r15
+  size_t full = jump_ahead(a, CC_AE);
+  local_op(a, 0x8b, RAX, in->local);     // mov rax, [r13 + local]
+  EMIT(a, 0x49, 0x83, 0xc4, 0x08,        // add r12, 8
+          0x49, 0x89, 0x04, 0x24,        // mov [r12], rax
+          0x89, 0xc1,                    // mov ecx, eax
+          0x83, 0xe1, VALUE_TAG_MASK,    // and ecx, 7
+          0x83, 0xf9, VALUE_TAG_str);    // cmp ecx, 2
+  size_t notstr = jump_ahead(a, CC_NE);
+  EMIT(a, 0x83, 0x40, 0xfe, 0x01);   // add dword [rax - 2], 1
+  size_t done = jump_ahead(a, CC_JMP);
+  land(a, full);
+  generic(a, a->opcode['e'], in->raw);
+  land(a, notstr);
+  land(a, done);
+}
+
+static void emit_push(ASM_t *a, INSTR_t *in, VALUE_t v) {
+  // Push a literal.  A string literal belongs to the code, so the stack
+  // just takes another reference to it.
+  EMIT(a, 0x4d, 0x39, 0xfc);             // cmp r12, r15
+  size_t full = jump_ahead(a, CC_AE);
+  mov_imm(a, RAX, v.bits);
+  if (IS_STR(v)) {
+    EMIT(a, 0x83, 0x40, 0xfe, 0x01);   // add dword [rax - 2], 1
+  }
+  EMIT(a, 0x49, 0x83, 0xc4, 0x08,        // add r12, 8
+          0x49, 0x89, 0x04, 0x24);       // mov [r12], rax
+  size_t done = jump_ahead(a, CC_JMP);
+  land(a, full);
+  generic(a, a->opcode[in->op], in->raw);
+  land(a, done);
+}
+
+static void emit_savelocal(ASM_t *a, INSTR_t *in) {
+  free_local(a, in->local);
+  EMIT(a, 0x49, 0x8b, 0x04, 0x24);       // mov rax, [r12]
+  local_op(a, 0x89, RAX, in->local);     // mov [r13 + local], rax
+  EMIT(a, 0x49, 0xc7, 0x04, 0x24, 0, 0, 0, 0, // mov qword [r12], 0
+          0x49, 0x83, 0xec, 0x08);       // sub r12, 8
+}
+
+static void emit_steplocal(ASM_t *a, INSTR_t *in, bool up) {
+  // Increment or decrement a local which holds an int.  Anything else is
+  // left to the opcode function to complain about.
+  local_op(a, 0x8b, RAX, in->local);     // mov rax, [r13 + local]
+  EMIT(a, 0xa8, VALUE_TAG_int);          // test al, 1
+  size_t notint = jump_ahead(a, CC_E);
+  if (up) {
+    EMIT(a, 0x48, 0x83, 0xc0, 0x02);     // add rax, 2
+  } else {
+    EMIT(a, 0x48, 0x83, 0xe8, 0x02);     // sub rax, 2
+  }
+  local_op(a, 0x89, RAX, in->local);     // mov [r13 + local], rax
+  size_t done = jump_ahead(a, CC_JMP);
+  land(a, notint);
+  generic(a, a->opcode[in->op], in->raw);
+  land(a, done);
+}
+
+static void emit_jumpfalse(ASM_t *a, INSTR_t *in) {
+  // Pop the top value, and jump unless it is true.
+  EMIT(a, 0x49, 0x8b, 0x04, 0x24,        // mov rax, [r12]
+          0x49, 0xc7, 0x04, 0x24, 0, 0, 0, 0, // mov qword [r12], 0
+          0x49, 0x83, 0xec, 0x08,        // sub r12, 8
+          0xa8, VALUE_TAG_int);          // test al, 1
+  size_t notint = jump_ahead(a, CC_E);
+  EMIT(a, 0x48, 0x83, 0xf8, 0x01);      // cmp rax, 0 (as an int)
+  jump_to(a, CC_E, in->target);
+  size_t done = jump_ahead(a, CC_JMP);
+  land(a, notint);
+  EMIT(a, 0x48, 0x83, 0xf8, 0x0c);      // cmp rax, true
+  size_t truth = jump_ahead(a, CC_E);
+  EMIT(a, 0x89, 0xc1,                    // mov ecx, eax
+          0x83, 0xe1, VALUE_TAG_MASK,    // and ecx, 7
+          0x83, 0xf9, VALUE_TAG_str);    // cmp ecx, 2
+  jump_to(a, CC_NE, in->target);         // false or nil
+  EMIT(a, 0x48, 0x89, 0xc7);             // mov rdi, rax
+  call(a, string_truth);
+  EMIT(a, 0x84, 0xc0);                   // test al, al
+  jump_to(a, CC_E, in->target);
+  land(a, truth);
+  land(a, done);
+}
+
+static size_t both_int(ASM_t *a) {
+  // Load the top two values into rax (the first) and rcx (the second),
+  // and jump ahead unless both are ints.
+  EMIT(a, 0x49, 0x8b, 0x44, 0x24, 0xf8,  // mov rax, [r12 - 8]
+          0x49, 0x8b, 0x0c, 0x24,        // mov rcx, [r12]
+          0x89, 0xc2,                    // mov edx, eax
+          0x21, 0xca,                    // and edx, ecx
+          0xf6, 0xc2, VALUE_TAG_int);    // test dl, 1
+  return jump_ahead(a, CC_E);
+}
+
+static void emit_arith(ASM_t *a, INSTR_t *in, uint8_t op) {
+  // Ints are kept shifted up by one with the low bit set, so adding and
+  // subtracting can be done without unpacking them.  The popped slot
+  // held an int, so there is no string in it to forget.
+  size_t notint = both_int(a);
+  size_t zero = 0;
+  switch (op) {
+    case 'a':
+      EMIT(a, 0x48, 0x01, 0xc8,          // add rax, rcx
+              0x48, 0x83, 0xe8, 0x01);   // sub rax, 1
+      break;
+    case 's':
+      EMIT(a, 0x48, 0x29, 0xc8,          // sub rax, rcx
+              0x48, 0x83, 0xc0, 0x01);   // add rax, 1
+      break;
+    case 'm':
+      EMIT(a, 0x48, 0xd1, 0xf8,          // sar rax, 1
+              0x48, 0xd1, 0xf9,          // sar rcx, 1
+              0x48, 0x0f, 0xaf, 0xc1,    // imul rax, rcx
+              0x48, 0x01, 0xc0,          // add rax, rax
+              0x48, 0x83, 0xc8, 0x01);   // or rax, 1
+      break;
+    case 'd':
+      // Dividing by zero is left to op_divide to complain about.
+      EMIT(a, 0x48, 0x83, 0xf9, 0x01);  // cmp rcx, 0 (as an int)
+      zero = jump_ahead(a, CC_E);
+      EMIT(a, 0x48, 0xd1, 0xf8,          // sar rax, 1
+              0x48, 0xd1, 0xf9,          // sar rcx, 1
+              0x48, 0x99,                // cqo
+              0x48, 0xf7, 0xf9,          // idiv rcx
+              0x48, 0x01, 0xc0,          // add rax, rax
+              0x48, 0x83, 0xc8, 0x01);   // or rax, 1
+      break;
+  }
+  EMIT(a, 0x49, 0x89, 0x44, 0x24, 0xf8,  // mov [r12 - 8], rax
+          0x49, 0x83, 0xec, 0x08);       // sub r12, 8
+  size_t done = jump_ahead(a, CC_JMP);
+  land(a, notint);
+  if (op == 'd') {
+    land(a, zero);
+  }
+  generic(a, a->opcode[op], in->raw);
+  land(a, done);
+}
+
+static void emit_negate(ASM_t *a, INSTR_t *in) {
+  EMIT(a, 0x49, 0x8b, 0x04, 0x24,        // mov rax, [r12]
+          0xa8, VALUE_TAG_int);          // test al, 1
+  size_t notint = jump_ahead(a, CC_E);
+  EMIT(a, 0xb9, 0x02, 0, 0, 0,           // mov ecx, 2
+          0x48, 0x29, 0xc1,              // sub rcx, rax
+          0x49, 0x89, 0x0c, 0x24);       // mov [r12], rcx
+  size_t done = jump_ahead(a, CC_JMP);
+  land(a, notint);
+  generic(a, a->opcode['n'], in->raw);
+  land(a, done);
+}
+
+static uint8_t condition(uint8_t op) {
+  // The condition under which a comparison is true.  Shifting ints up by
+  // one keeps their order, so they can be compared as they are.
+  switch (op) {
+    case 'o': return CC_E;
+    case 'q': return CC_NE;
+    case 'r': return CC_L;
+    case 't': return CC_G;
+    case 'u': return CC_LE;
+    default:  return CC_GE;
+  }
+}
+
+static void emit_compare(ASM_t *a, INSTR_t *in, uint8_t op, bool branch,
+                                                            uint32_t index) {
+  // Compare two ints.  If the comparison is followed by a jumpfalse which
+  // nothing else jumps to, branch on the flags instead of making a bool,
+  // and step over the jumpfalse.  Otherwise the opcode function makes the
+  // bool, and the jumpfalse tests it.
+  size_t notint = both_int(a);
+  EMIT(a, 0x48, 0x39, 0xc8);             // cmp rax, rcx
+  if (branch) {
+    EMIT(a, 0x4d, 0x8d, 0x64, 0x24, 0xf0); // lea r12, [r12 - 16]
+    jump_to(a, condition(op) ^ 1, in[1].target);
+    jump_to(a, CC_JMP, index + 2);
+    land(a, notint);
+    generic(a, a->opcode[op], in->raw);
+    return;
+  }
+  EMIT(a, 0x0f);
+  put(a, &(uint8_t){0x90 | condition(op)}, 1); // setcc al
+  EMIT(a, 0xc0,
+          0x0f, 0xb6, 0xc0,              // movzx eax, al
+          0xc1, 0xe0, 0x03,              // shl eax, 3
+          0x83, 0xc8, VALUE_TAG_bool,    // or eax, 4
+          0x49, 0x89, 0x44, 0x24, 0xf8,  // mov [r12 - 8], rax
+          0x49, 0x83, 0xec, 0x08);       // sub r12, 8
+  size_t done = jump_ahead(a, CC_JMP);
+  land(a, notint);
+  generic(a, a->opcode[op], in->raw);
+  land(a, done);
+}
+
+static void emit_fused(ASM_t *a, INSTR_t *in, uint32_t index) {
+  // A run of instructions fused by the decoder: a local and an int
+  // literal, which are added or subtracted and saved, or compared and
+  // branched on.  If the local is not an int, the run is done one
+  // instruction at a time, starting with the getlocal here, and carrying
+  // on into the code of the instructions after it.
+  local_op(a, 0x8b, RAX, in->local);     // mov rax, [r13 + local]
+  EMIT(a, 0xa8, VALUE_TAG_int);          // test al, 1
+  size_t notint = jump_ahead(a, CC_E);
+  switch (in->op) {
+    case OP_ADDLOCALINT:
+    case OP_SUBTRACTLOCALINT:
+      mov_imm(a, RCX, in[1].value.bits - VALUE_TAG_int);
+      if (in->op == OP_ADDLOCALINT) {
+        EMIT(a, 0x48, 0x01, 0xc8);       // add rax, rcx
+      } else {
+        EMIT(a, 0x48, 0x29, 0xc8);       // sub rax, rcx
+      }
+      EMIT(a, 0x49, 0x89, 0xc6);         // mov r14, rax
+      free_local(a, in[3].local);
+      EMIT(a, 0x4d, 0x89, 0xb5);         // mov [r13 + local], r14
+      put32(a, in[3].local * sizeof(VALUE_t));
+      break;
+    default:
+      mov_imm(a, RCX, in[1].value.bits);
+      EMIT(a, 0x48, 0x39, 0xc8);         // cmp rax, rcx
+      jump_to(a, condition(in[2].op) ^ 1, in[3].target);
+      break;
+  }
+  jump_to(a, CC_JMP, index + 4);
+  land(a, notint);
+  emit_getlocal(a, in);
+}
+
+static uint8_t base_op(uint8_t op) {
+  // The opcode an int-only form was made from.
+  static const uint8_t unquickened[256] = {
+    [OP_ADDINT] = 'a', [OP_SUBTRACTINT] = 's', [OP_MULTIPLYINT] = 'm',
+    [OP_DIVIDEINT] = 'd', [OP_NEGATEINT] = 'n', [OP_EQUALINT] = 'o',
+    [OP_NOTEQUALINT] = 'q', [OP_LESSTHANINT] = 'r',
+    [OP_GREATERTHANINT] = 't', [OP_LESSTHANOREQUALINT] = 'u',
+    [OP_GREATERTHANOREQUALINT] = 'v',
+  };
+  return unquickened[op] ? unquickened[op] : op;
+}
+
+static void emit_instruction(ASM_t *a, DECODED_t *code, uint32_t index,
+                                                              bool *target) {
+  INSTR_t *in = &code->instr[index];
+  uint8_t op = base_op(in->op);
+  switch (op) {
+    case 'e':
+      emit_getlocal(a, in);
+      break;
+    case 'p':
+      emit_push(a, in, in->value);
+      break;
+    case 'l':
+      emit_push(a, in, STR_VALUE(in->s));
+      break;
+    case 'c':
+      emit_savelocal(a, in);
+      break;
+    case 'f':
+    case 'g':
+      emit_steplocal(a, in, op == 'f');
+      break;
+    case 'j':
+      jump_to(a, CC_JMP, in->target);
+      break;
+    case 'k':
+      emit_jumpfalse(a, in);
+      break;
+    case 'a': case 's': case 'm': case 'd':
+      emit_arith(a, in, op);
+      break;
+    case 'n':
+      emit_negate(a, in);
+      break;
+    case 'o': case 'q': case 'r': case 't': case 'u': case 'v':
+      emit_compare(a, in, op, in[1].op == 'k' && !target[index + 1], index);
+      break;
+    case OP_ADDLOCALINT: case OP_SUBTRACTLOCALINT:
+    case OP_EQUALJUMP: case OP_NOTEQUALJUMP: case OP_LESSTHANJUMP:
+    case OP_GREATERTHANJUMP: case OP_LESSTHANOREQUALJUMP:
+    case OP_GREATERTHANOREQUALJUMP:
+      emit_fused(a, in, index);
+      break;
+    case 'A':
+      // The library function was looked up when the item was decoded.
+      generic(a, in->libcall, in->raw);
+      break;
+    case 'I':
+      call_helper(a, call_assemble, (uintptr_t)in->assembly,
+                                                    (uintptr_t)a->item, 0);
+      break;
+    case 'F':
+    case OP_FETCHSTATIC: {
+      // Calls to code items are made by the interpreter.
+      pass_sp(a, op == 'F' ? (void *)call_fetch : (void *)call_fetchstatic,
+                                    (uintptr_t)in, (uintptr_t)a->item, 0);
+      EMIT(a, 0x48, 0x85, 0xc0);         // test rax, rax
+      size_t fetched = jump_ahead(a, CC_NE);
+      leave_at(a, index);
+      land(a, fetched);
+      EMIT(a, 0x49, 0x89, 0xc4);         // mov r12, rax
+      if (op == OP_FETCHSTATIC) {
+        jump_to(a, CC_JMP, index + 2);
+      }
+      break;
+    }
+    case OP_EXISTSSTATIC:
+      call_helper(a, call_existsstatic, (uintptr_t)in->assembly, 0, 0);
+      jump_to(a, CC_JMP, index + 2);
+      break;
+    case OP_NAMESTATIC:
+      // The name is not needed, as the assignment already knows it.
+      break;
+    case OP_ASSIGNSTATIC:
+      call_helper(a, call_assignstatic, (uintptr_t)in->assembly, 0, 0);
+      break;
+    case 'h':
+      leave_at(a, index);
+      break;
+    default:
+      generic(a, a->opcode[op], in->raw);
+  }
+}
+
+NATIVE_t *jit_compile(DECODED_t *code, ITEM_t *item, const OP_t *opcode) {
+  // Turn the instructions of an item into machine code.  Returns NULL if
+  // that cannot be done, in which case the item is only ever interpreted.
+  if (!code->instr) {
+    return NULL;
+  }
+  ASM_t a = {.item = item, .opcode = opcode};
+  uint32_t *entry = malloc(sizeof(uint32_t) * code->count);
+  bool *target = calloc(code->count, sizeof(bool));
+  for (uint32_t i = 0; i < code->count; i++) {
+    if (code->instr[i].op == 'j' || code->instr[i].op == 'k') {
+      target[code->instr[i].target] = true;
+    }
+  }
+
+  EMIT(&a, 0x53,                         // push rbx
+           0x41, 0x54,                   // push r12
+           0x41, 0x55,                   // push r13
+           0x41, 0x56,                   // push r14
+           0x41, 0x57,                   // push r15
+           0x48, 0x89, 0xfb,             // mov rbx, rdi
+           0x4c, 0x8b, 0x27,             // mov r12, [rdi]
+           0x49, 0x89, 0xf5,             // mov r13, rsi
+           0x49, 0x89, 0xd7,             // mov r15, rdx
+           0xff, 0xe1);                  // jmp rcx
+  a.epilogue = a.len;
+  EMIT(&a, 0x4c, 0x89, 0x23,             // mov [rbx], r12
+           0x41, 0x5f,                   // pop r15
+           0x41, 0x5e,                   // pop r14
+           0x41, 0x5d,                   // pop r13
+           0x41, 0x5c,                   // pop r12
+           0x5b,                         // pop rbx
+           0xc3);                        // ret
+  for (uint32_t i = 0; i < code->count; i++) {
+    entry[i] = a.len;
+    emit_instruction(&a, code, i, target);
+  }
+  for (uint32_t f = 0; f < a.fixups; f++) {
+    patch(&a, a.fixup[f].at, entry[a.fixup[f].target]);
+  }
+  free(target);
+  FREE_ARRAY(FIXUP_t, a.fixup, a.fixupcapacity);
+
+  // The code is written, then made executable instead of writable.
+  NATIVE_t *native = NULL;
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t size = (a.len + page - 1) & ~(page - 1);
+  uint8_t *mem = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED) {
+    logerr("Unable to map memory for machine code.\n");
+    free(entry);
+  } else {
+    memcpy(mem, a.buf, a.len);
+    if (mprotect(mem, size, PROT_READ | PROT_EXEC) != 0) {
+      logerr("Unable to make machine code executable.\n");
+      munmap(mem, size);
+      free(entry);
+    } else {
+      native = GROW_ARRAY(NATIVE_t, NULL, 0, 1);
+      native->code = mem;
+      native->size = size;
+      native->entry = entry;
+      DEBUG_LOG("Compiled %s: %u instructions into %zu bytes.\n",
+                                              item->name, code->count, a.len);
+    }
+  }
+  FREE_ARRAY(uint8_t, a.buf, a.capacity);
+  return native;
+}
+
+uint32_t jit_run(NATIVE_t *native, uint32_t from, VALUE_t *bp,
+                                                            VALUE_t *top) {
+  // Run the machine code from instruction from, with the VM stack and the
+  // given frame, and return the instruction the interpreter is to carry
+  // on with.
+  STACK_t *stack = VM->stack;
+  VALUE_t *sp = stack->stack + stack->current;
+  ENTRY_t run = (ENTRY_t)native->code;
+  uint32_t at = run(&sp, bp, top, native->code + native->entry[from]);
+  stack->current = sp - stack->stack;
+  return at;
+}
+
+#else
+
+NATIVE_t *jit_compile(DECODED_t *code, ITEM_t *item, const OP_t *opcode) {
+  return NULL;
+}
+
+uint32_t jit_run(NATIVE_t *native, uint32_t from, VALUE_t *bp,
+                                                            VALUE_t *top) {
+  return from;
+}
+
+#endif
+
+void jit_free(NATIVE_t *native) {
+  if (native) {
+    munmap(native->code, native->size);
+    free(native->entry);
+    FREE_ARRAY(NATIVE_t, native, 1);
+  }
+}
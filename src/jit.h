@@ -0,0 +1,36 @@
+// The template JIT.  Turns the pre-decoded instructions of a code item
+// which is run a lot into x86_64 machine code, a fixed template for each
+// instruction.  Int arithmetic, locals and jumps are done by the machine
+// code itself, and everything else calls the same functions that the
+// interpreter does.  The interpreter loop still makes calls and returns
+// from them, so the machine code hands back to it for those.
+
+// Licensed under the MIT License - see LICENSE file for details.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "decode.h"
+
+// Only x86_64 machine code is made.  Tracing every opcode needs the
+// interpreter.
+#if defined(JIT) && defined(__x86_64__) && !defined(DISASS)
+#define NATIVE_CODE
+#endif
+
+// An item is compiled once it has been called, or has gone round a loop,
+// this many times.
+#define JIT_THRESHOLD 1000
+
+typedef struct Native {
+  uint8_t *code;        // The machine code, mapped executable
+  size_t size;          // Size of the mapping
+  uint32_t *entry;      // Where in the code each instruction starts
+} NATIVE_t;
+
+NATIVE_t *jit_compile(DECODED_t *code, ITEM_t *item, const OP_t *opcode);
+uint32_t jit_run(NATIVE_t *native, uint32_t from, VALUE_t *bp,
+                                                            VALUE_t *top);
+void jit_free(NATIVE_t *native);
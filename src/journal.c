@@ -0,0 +1,464 @@
+// The itemstore journal.  See journal.h for how it works.
+
+// Licensed under the MIT License - see LICENSE file for details.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "memory.h"
+#include "log.h"
+#include "item.h"
+#include "store.h"
+#include "journal.h"
+
+typedef struct {
+  bool active;          // Are changes being recorded?
+  int fd;               // The journal file
+  char *name;           // <itemstore>.journal
+  char *oldname;        // <itemstore>.journal.old, while it is compacted
+  char *itemstore;
+  ITEM_t *root;
+  uint8_t *buf;         // Records not yet written
+  size_t len;
+  size_t capacity;
+  uint64_t size;        // Bytes written to the journal file
+  bool dirty;           // Written since the last sync?
+  bool syncing;         // Is a sync under way?
+  uv_fs_t syncreq;
+  uv_timer_t timer;
+  bool timing;
+} JOURNAL_t;
+
+static JOURNAL_t journal;
+
+static void put(const void *data, size_t len) {
+  if (journal.len + len > journal.capacity) {
+    size_t oldcapacity = journal.capacity;
+    while (journal.len + len > journal.capacity) {
+      journal.capacity = GROW_CAPACITY(journal.capacity);
+    }
+    journal.buf = GROW_ARRAY(uint8_t, journal.buf, oldcapacity,
+                                                        journal.capacity);
+  }
+  memcpy(journal.buf + journal.len, data, len);
+  journal.len += len;
+}
+
+static int encode_varint(uint8_t *bytes, uint64_t v) {
+  // Seven bits at a time, least significant first, as in the itemstore.
+  int n = 0;
+  while (v >= 0x80) {
+    bytes[n++] = (v & 0x7f) | 0x80;
+    v >>= 7;
+  }
+  bytes[n++] = v;
+  return n;
+}
+
+static void put_varint(uint64_t v) {
+  uint8_t bytes[10];
+  put(bytes, encode_varint(bytes, v));
+}
+
+static size_t begin_record(JOURNAL_OP_e op, const char *name) {
+  // Start a record.  Returns where it starts, for end_record().
+  size_t start = journal.len;
+  uint8_t opbyte = op;
+  size_t namelen = strlen(name);
+  put(&opbyte, 1);
+  put_varint(namelen);
+  put(name, namelen);
+  return start;
+}
+
+static void put_value(VALUE_t value) {
+  uint8_t tag;
+  int64_t i;
+  switch (VALUE_TYPE(value)) {
+    case VALUE_str:
+      tag = STORE_str;
+      put(&tag, 1);
+      put_varint(AS_STR(value)->len);
+      put(STRING_CHARS(AS_STR(value)), AS_STR(value)->len + 1);
+      break;
+    case VALUE_int:
+    case VALUE_bool:
+      tag = (IS_INT(value)) ? STORE_int : STORE_bool;
+      i = IS_INT(value) ? AS_INT(value) : AS_BOOL(value);
+      put(&tag, 1);
+      put_varint(((uint64_t)i << 1) ^ (uint64_t)(i >> 63));
+      break;
+    default:
+      tag = STORE_nil;
+      put(&tag, 1);
+      break;
+  }
+}
+
+static void write_journal() {
+  // Write out whatever records are waiting.  They are synced later.
+  uint8_t *p = journal.buf;
+  while (journal.len) {
+    ssize_t n = write(journal.fd, p, journal.len);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      logerr("Failed to write journal %s: %s\n", journal.name,
+                                                          strerror(errno));
+      break;
+    }
+    p += n;
+    journal.len -= n;
+    journal.size += n;
+    journal.dirty = true;
+  }
+  journal.len = 0;
+}
+
+static void end_record(size_t start) {
+  // The record is in place from start.  Put its length in front of it,
+  // and its checksum after it.
+  uint8_t bytes[10];
+  size_t len = journal.len - start;
+  int n = encode_varint(bytes, len);
+  put(bytes, n); // Just to make room
+  memmove(journal.buf + start + n, journal.buf + start, len);
+  memcpy(journal.buf + start, bytes, n);
+  uint32_t crc = store_crc32(0, journal.buf + start + n, len);
+  uint8_t crcbytes[4] = {crc, crc >> 8, crc >> 16, crc >> 24};
+  put(crcbytes, 4);
+  if (journal.len >= JOURNAL_BUFFER_SIZE) {
+    write_journal();
+  }
+}
+
+void journal_insert(const char *name, VALUE_t value) {
+  if (journal.active) {
+    size_t start = begin_record(JOURNAL_insert, name);
+    put_value(value);
+    end_record(start);
+  }
+}
+
+void journal_set(const char *name, VALUE_t value) {
+  if (journal.active) {
+    size_t start = begin_record(JOURNAL_set, name);
+    put_value(value);
+    end_record(start);
+  }
+}
+
+void journal_code(const char *name, uint32_t len, uint8_t *bytecode) {
+  if (journal.active) {
+    size_t start = begin_record(JOURNAL_code, name);
+    put_varint(len);
+    put(bytecode, len);
+    end_record(start);
+  }
+}
+
+void journal_delete(const char *name) {
+  if (journal.active) {
+    end_record(begin_record(JOURNAL_delete, name));
+  }
+}
+
+static bool get_varint(const uint8_t **p, const uint8_t *end, uint64_t *v) {
+  *v = 0;
+  for (int shift = 0; shift < 64 && *p < end; shift += 7) {
+    uint8_t byte = *(*p)++;
+    *v |= (uint64_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool apply_record(const uint8_t *p, const uint8_t *end, ITEM_t *root) {
+  // Make the change which a record describes.  Returns false if the record
+  // makes no sense.
+  char name[MAX_ITEM_NAME];
+  uint64_t len;
+  uint8_t op = *p++;
+  if (!get_varint(&p, end, &len) || len >= MAX_ITEM_NAME
+                                          || len > (uint64_t)(end - p)) {
+    return false;
+  }
+  memcpy(name, p, len);
+  name[len] = '\0';
+  p += len;
+  switch (op) {
+    case JOURNAL_insert:
+    case JOURNAL_set: {
+      VALUE_t value = VALUE_NIL;
+      uint8_t tag = (p < end) ? *p++ : 0xff;
+      switch (tag) {
+        case STORE_nil:
+          break;
+        case STORE_int:
+        case STORE_bool:
+          if (!get_varint(&p, end, &len)) {
+            return false;
+          }
+          int64_t i = (int64_t)(len >> 1) ^ -(int64_t)(len & 1);
+          value = (tag == STORE_int) ? INT_VALUE(i) : BOOL_VALUE(i);
+          break;
+        case STORE_str:
+          if (!get_varint(&p, end, &len) || len >= (uint64_t)(end - p)) {
+            return false;
+          }
+          value = STR_VALUE(make_string((char *)p, len));
+          break;
+        default:
+          return false;
+      }
+      if (op == JOURNAL_set) {
+        set_item(root, name, value);
+      } else if (!insert_item(root, name, value)) {
+        FREE_STR(value);
+      }
+      return true;
+    }
+    case JOURNAL_code: {
+      if (!get_varint(&p, end, &len) || len > (uint64_t)(end - p)) {
+        return false;
+      }
+      uint8_t *bytecode = GROW_ARRAY(uint8_t, NULL, 0, len);
+      memcpy(bytecode, p, len);
+      insert_code_item(root, name, len, bytecode);
+      return true;
+    }
+    case JOURNAL_delete:
+      delete_item(root, name);
+      return true;
+    default:
+      return false;
+  }
+}
+
+static bool replay_journal(const char *filename, ITEM_t *root,
+                                                        uint64_t *count) {
+  // Replay a journal, if there is one, over the itemstore.  Returns false
+  // if the journal is not one at all, or it is damaged before the end.
+  FILE *file = fopen(filename, "rb");
+  if (!file) {
+    return true;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t *buf = GROW_ARRAY(uint8_t, NULL, 0, size + 1);
+  bool ok = fread(buf, 1, size, file) == (size_t)size;
+  fclose(file);
+  uint16_t byteorder = STORE_BYTEORDER;
+  if (ok && size >= STORE_HEADER_SIZE
+         && (memcmp(buf, JOURNAL_MAGIC, 8) != 0 || buf[8] != JOURNAL_VERSION
+                               || memcmp(buf + 9, &byteorder, 2) != 0)) {
+    logerr("%s is not a journal which can be replayed.\n", filename);
+    ok = false;
+  }
+  // A journal without even a header never had anything in it.
+  const uint8_t *p = buf + STORE_HEADER_SIZE;
+  const uint8_t *end = buf + size;
+  while (ok && p < end) {
+    uint64_t len;
+    const uint8_t *record = p;
+    if (!get_varint(&p, end, &len) || len == 0
+                                   || len + 4 > (uint64_t)(end - p)) {
+      // The server stopped while this record was being written.
+      logerr("Journal %s ends with an incomplete change, which is lost.\n",
+                                                                  filename);
+      break;
+    }
+    uint32_t crc = p[len] | p[len + 1] << 8 | p[len + 2] << 16
+                                            | (uint32_t)p[len + 3] << 24;
+    if (crc != store_crc32(0, p, len)) {
+      // Only the last record can have been cut short.
+      if (p + len + 4 < end) {
+        logerr("Journal %s is damaged at byte %ld.\n", filename,
+                                                      (long)(record - buf));
+        ok = false;
+      } else {
+        logerr("Journal %s ends with an incomplete change, which is lost.\n",
+                                                                  filename);
+      }
+      break;
+    }
+    if (!apply_record(p, p + len, root)) {
+      logerr("Journal %s has a change which makes no sense at byte %ld.\n",
+                                              filename, (long)(record - buf));
+      ok = false;
+      break;
+    }
+    (*count)++;
+    p += len + 4;
+  }
+  FREE_ARRAY(uint8_t, buf, size + 1);
+  return ok;
+}
+
+static bool create_journal() {
+  // Begin a new, empty journal.
+  journal.fd = open(journal.name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (journal.fd < 0) {
+    logerr("Failed to create journal %s: %s\n", journal.name,
+                                                          strerror(errno));
+    return false;
+  }
+  uint8_t header[STORE_HEADER_SIZE] = {0};
+  uint16_t byteorder = STORE_BYTEORDER;
+  memcpy(header, JOURNAL_MAGIC, 8);
+  header[8] = JOURNAL_VERSION;
+  memcpy(header + 9, &byteorder, 2);
+  if (write(journal.fd, header, STORE_HEADER_SIZE) != STORE_HEADER_SIZE
+                                              || fdatasync(journal.fd) != 0) {
+    logerr("Failed to write journal %s: %s\n", journal.name,
+                                                          strerror(errno));
+    close(journal.fd);
+    return false;
+  }
+  journal.size = STORE_HEADER_SIZE;
+  journal.dirty = false;
+  return true;
+}
+
+bool open_journal(const char *itemstore, ITEM_t *root) {
+  // Replay any journal left over from last time, then save the itemstore
+  // so that it can be started afresh.  Returns false if the journal can't
+  // be replayed or begun, in which case it is not safe to carry on.
+  journal.itemstore = strdup(itemstore);
+  journal.root = root;
+  journal.name = malloc(strlen(itemstore) + 9);
+  journal.oldname = malloc(strlen(itemstore) + 13);
+  sprintf(journal.name, "%s.journal", itemstore);
+  sprintf(journal.oldname, "%s.journal.old", itemstore);
+
+  // The old journal, if there is one, comes before the current one.
+  uint64_t count = 0;
+  if (!replay_journal(journal.oldname, root, &count)
+                      || !replay_journal(journal.name, root, &count)) {
+    return false;
+  }
+  if (count) {
+    logmsg("Replayed %llu changes from the journal.\n",
+                                                  (unsigned long long)count);
+  }
+  if (count && !save_itemstore(itemstore, root)) {
+    return false;
+  }
+  unlink(journal.oldname);
+  if (!create_journal()) {
+    return false;
+  }
+  journal.active = true;
+  return true;
+}
+
+static void compact_done(bool ok) {
+  if (ok) {
+    ITEMDEBUG_LOG("Journal compacted into %s.\n", journal.itemstore);
+    unlink(journal.oldname);
+  } else {
+    logerr("Failed to save the itemstore.  Keeping %s.\n", journal.oldname);
+  }
+}
+
+static void compact_journal(uv_loop_t *loop) {
+  // Set the journal aside and begin a new one, while the itemstore is
+  // saved as it is now.  The old journal is kept until the save is done.
+  // If an earlier save failed, its journal is still needed, so wait until
+  // the itemstore is next saved at shutdown.  If something else is saving
+  // the itemstore, try again later.
+  if (access(journal.oldname, F_OK) == 0 || checkpoint_running()) {
+    return;
+  }
+  write_journal();
+  fdatasync(journal.fd);
+  close(journal.fd);
+  journal.dirty = false;
+  if (rename(journal.name, journal.oldname) != 0 || !create_journal()) {
+    // Without a journal, there is no way to carry on safely.
+    logerr("Failed to begin a new journal: %s\n", strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  start_checkpoint(loop, journal.itemstore, journal.root, NULL, compact_done);
+}
+
+static void sync_done_cb(uv_fs_t *req) {
+  if (req->result < 0) {
+    logerr("Failed to sync journal %s: %s\n", journal.name,
+                                                uv_strerror(req->result));
+  }
+  uv_fs_req_cleanup(req);
+  journal.syncing = false;
+}
+
+static void commit_cb(uv_timer_t *handle) {
+  // Write out everything since the last commit, and sync it in the
+  // background.  Nothing waits for the sync to finish.
+  write_journal();
+  if (journal.syncing) {
+    return;
+  }
+  if (journal.size >= JOURNAL_COMPACT_SIZE) {
+    compact_journal(handle->loop);
+  }
+  if (journal.dirty) {
+    journal.dirty = false;
+    journal.syncing = true;
+    uv_fs_fdatasync(handle->loop, &journal.syncreq, journal.fd, sync_done_cb);
+  }
+}
+
+void start_journal(uv_loop_t *loop) {
+  // Commit the journal regularly from the run loop.
+  if (journal.active) {
+    uv_timer_init(loop, &journal.timer);
+    uv_timer_start(&journal.timer, commit_cb, JOURNAL_COMMIT_INTERVAL,
+                                                  JOURNAL_COMMIT_INTERVAL);
+    journal.timing = true;
+  }
+}
+
+void finish_journal() {
+  // Stop recording changes, and make sure that those already recorded are
+  // safely on disk.  Called before the itemstore is saved at shutdown.
+  if (!journal.active) {
+    return;
+  }
+  journal.active = false;
+  if (journal.timing) {
+    uv_timer_stop(&journal.timer);
+  }
+  write_journal();
+  fdatasync(journal.fd);
+  if (!journal.syncing) {
+    // A sync still under way will want the file when it finishes.
+    close(journal.fd);
+  }
+  FREE_ARRAY(uint8_t, journal.buf, journal.capacity);
+  journal.capacity = 0;
+}
+
+void close_journal(bool saved) {
+  // Once the itemstore has been saved, the journal is no longer needed.
+  // If it was not, the journal is left to be replayed next time.
+  if (!journal.name) {
+    return;
+  }
+  if (saved) {
+    unlink(journal.name);
+    unlink(journal.oldname);
+  }
+  free(journal.name);
+  free(journal.oldname);
+  free(journal.itemstore);
+  journal.name = NULL;
+}
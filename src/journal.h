@@ -0,0 +1,67 @@
+// The itemstore journal.
+//
+// When journalling is switched on, every change to the itemstore is
+// appended to a journal file alongside it, so that a crash loses no more
+// than the last moment's changes rather than everything since the
+// itemstore was last saved.  Changes are gathered in memory and written
+// out together every JOURNAL_COMMIT_INTERVAL milliseconds, with a single
+// fdatasync() for the lot, which is done away from the run loop.
+//
+// At startup, the journal is replayed on top of the itemstore, which is
+// then saved, and the journal started afresh.  When the journal grows
+// past JOURNAL_COMPACT_SIZE, it is set aside as <itemstore>.journal.old
+// and a new one begun, while a child process saves the itemstore.  Once
+// that is done, the old journal is no longer needed.  An orderly
+// shutdown saves the itemstore and removes the journal.
+//
+//   Header:  "SINJOURN" (8 bytes), the format version (1 byte), a byte
+//            order marker (2 bytes) and 5 reserved bytes, as for the
+//            itemstore.
+//   Record:  The length of the rest of the record (varint), then the
+//            operation (1 byte), the item name (varint length, then the
+//            characters), and anything the operation needs: a tag byte
+//            and the value as in the itemstore for an insert or set, or a
+//            varint length and the bytecode for code.  Finally, the CRC-32
+//            of the record from the operation onwards, little-endian.
+//
+// A record which was only partly written when the server stopped ends the
+// replay.  Every record replaces what it names outright, so replaying
+// a journal over an itemstore which already has its changes does no harm.
+
+// Licensed under the MIT License - see LICENSE file for details.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <uv.h>
+
+#include "item.h"
+
+#define JOURNAL_MAGIC       "SINJOURN"
+#define JOURNAL_VERSION     1
+
+// How often the journal is written and synced, in milliseconds.
+#define JOURNAL_COMMIT_INTERVAL 100
+// Write the journal early if this much is waiting.
+#define JOURNAL_BUFFER_SIZE (1024 * 1024)
+// Save the itemstore, and begin a new journal, once it is this big.
+#define JOURNAL_COMPACT_SIZE (64 * 1024 * 1024)
+
+// Operations in the journal.  Inserting replaces a code item with a
+// value; setting only changes the value, as set_item() does.
+typedef enum {
+  JOURNAL_insert,
+  JOURNAL_set,
+  JOURNAL_code,
+  JOURNAL_delete
+} JOURNAL_OP_e;
+
+bool open_journal(const char *itemstore, ITEM_t *root);
+void start_journal(uv_loop_t *loop);
+void finish_journal();
+void close_journal(bool saved);
+void journal_insert(const char *name, VALUE_t value);
+void journal_set(const char *name, VALUE_t value);
+void journal_code(const char *name, uint32_t len, uint8_t *bytecode);
+void journal_delete(const char *name);
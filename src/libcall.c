@@ -16,6 +16,8 @@
 #include "log.h"
 #include "stack.h"
 #include "item.h"
+#include "store.h"
+#include "profile.h"
 #include "interpret.h"
 
 // Configuration object.  Defined in sin.c
@@ -27,8 +29,34 @@ extern LINE_t *line;
 // Some shorthand
 #define VM config.vm
 
+// The file of the backup in progress.
+static char *backup_file;
+
+static void backup_done(bool ok) {
+  // The backup has finished.  Record the result in the itemstore so that
+  // Sinistra code can see how it went.
+  if (ok) {
+    logmsg("Backup saved to %s.\n", backup_file);
+  } else {
+    logerr("Backup to %s failed.\n", backup_file);
+  }
+  set_item(config.itemroot, "backup", ok ? VALUE_TRUE : VALUE_FALSE);
+  set_item(config.itemroot, "backup.file", make_string_value(backup_file));
+  free(backup_file);
+  backup_file = NULL;
+}
+
 uint8_t *lc_sys_backup(uint8_t *nextop, ITEM_t *item) {
-  // Create a backup of the itemstore.
+  // Create a backup of the itemstore.  The itemstore is checkpointed in
+  // the background, so the game carries on while it is being saved, and
+  // the backup shares the segments of the checkpoint.  When it is done,
+  // the item `backup` is set to true or false, and `backup.file` to the
+  // name of the file.  Returns true if the backup was started.
+  if (checkpoint_running()) {
+    logerr("Sys.backup called while the itemstore is being saved.\n");
+    push_stack(VM->stack, VALUE_FALSE);
+    return nextop;
+  }
   // All of the following is a long-winded way to get a backup filename.
   char timestamp[64];
   time_t now = time(NULL);
@@ -37,9 +65,11 @@ uint8_t *lc_sys_backup(uint8_t *nextop, ITEM_t *item) {
   char backupfile[strlen(config.itemstore)+strlen(timestamp)+2];
   snprintf(backupfile, sizeof(backupfile), "%s_%s", config.itemstore,
                                                                 timestamp);
-  save_itemstore(backupfile, config.itemroot);
-  // libcalls always return a value.
-  push_stack(VM->stack, VALUE_NIL);
+  logmsg("Backup to %s started.\n", backupfile);
+  backup_file = strdup(backupfile);
+  start_checkpoint(config.loop, config.itemstore, config.itemroot,
+                                                  backupfile, backup_done);
+  push_stack(VM->stack, VALUE_TRUE);
   return nextop;
 }
 
@@ -47,19 +77,19 @@ uint8_t *lc_sys_log(uint8_t *nextop, ITEM_t *item) {
   // Pop the top of the stack and write it to the syslog
   // Try to do something sensible if the type is not a string.
   VALUE_t val = pop_stack(VM->stack);
-  switch (val.type) {
+  switch (VALUE_TYPE(val)) {
     case VALUE_str:
-      logmsg(val.s);
-      free(val.s);
+      logmsg(STRING_CHARS(AS_STR(val)));
+      release_string(AS_STR(val));
       break;
     case VALUE_int:
-      logmsg("%d", val.i);
+      logmsg("%d", AS_INT(val));
       break;
     case VALUE_nil:
       // One cannot logically output nil.
       break;
     case VALUE_bool:
-      logmsg("%s", val.i?"true":"false");
+      logmsg("%s", AS_BOOL(val)?"true":"false");
       break;
     default:
       logmsg("Sys.log called with unknown value type.\n");
@@ -93,6 +123,25 @@ uint8_t *lc_sys_abort(uint8_t *nextop, ITEM_t *item) {
   return nextop;
 }
 
+uint8_t *lc_sys_profile(uint8_t *nextop, ITEM_t *item) {
+  // Start the profiler if given true (or a number other than 0), or stop
+  // it and log its report if given anything else.  If that is a string,
+  // the folded stacks are also written to the file it names.  Returns
+  // whether the profiler was running before.
+  VALUE_t val = pop_stack(VM->stack);
+  bool wasrunning = profiling;
+  if (IS_TRUE(val)) {
+    start_profile();
+  } else if (IS_STR(val)) {
+    stop_profile(STRING_CHARS(AS_STR(val)));
+  } else {
+    stop_profile(NULL);
+  }
+  FREE_STR(val);
+  push_stack(VM->stack, wasrunning ? VALUE_TRUE : VALUE_FALSE);
+  return nextop;
+}
+
 void execute_task_cb(uv_timer_t *req) {
   // This callback is for executing tasks when they are due.
   TASK_t *task = req->data;
@@ -104,17 +153,19 @@ void execute_task_cb(uv_timer_t *req) {
   if (item && item->type == ITEM_code) {
     VALUE_t ret = interpret(item);
     reset_stack(VM->stack);
-    if (ret.type == VALUE_int) {
-      logmsg("Bytecode interpreter returned: %ld\n", ret.i);
-    } else if (ret.type == VALUE_str) {
-      logmsg("Bytecode interpreter returned: %s\n", ret.s);
-      FREE_ARRAY(char, ret.s, strlen(ret.s));
-    } else if (ret.type == VALUE_bool) {
-      logmsg("Bytecode interpreter returned: %s\n", ret.i?"true":"false");
-    } else if (ret.type == VALUE_nil) {
+    if (IS_INT(ret)) {
+      logmsg("Bytecode interpreter returned: %ld\n", AS_INT(ret));
+    } else if (IS_STR(ret)) {
+      logmsg("Bytecode interpreter returned: %s\n",
+                                                  STRING_CHARS(AS_STR(ret)));
+      release_string(AS_STR(ret));
+    } else if (IS_BOOL(ret)) {
+      logmsg("Bytecode interpreter returned: %s\n",
+                                              AS_BOOL(ret)?"true":"false");
+    } else if (IS_NIL(ret)) {
       logmsg("Bytecode interpreter returned nil.\n");
     } else {
-      logerr("Interpreter returned unknown value type: '%c'.\n", ret.type);
+      logerr("Interpreter returned unknown value type: '%c'.\n", VALUE_TYPE(ret));
     }
   } else {
     logerr("Cannot execute %s - not a code item.\n", task->itemname);
@@ -132,8 +183,8 @@ uint8_t *lc_task_newgametask(uint8_t *nextop, ITEM_t *item) {
   VALUE_t repeatin = pop_stack(VM->stack);
   VALUE_t startin = pop_stack(VM->stack);
   VALUE_t itemname = pop_stack(VM->stack);
-  if (repeatin.type != VALUE_int || startin.type != VALUE_int
-                               || itemname.type != VALUE_str) {
+  if (!IS_INT(repeatin) || !IS_INT(startin)
+                               || !IS_STR(itemname)) {
     // Invalid parameters.  Clean them up, set the error item,
     // and return.
     FREE_STR(repeatin);
@@ -143,7 +194,8 @@ uint8_t *lc_task_newgametask(uint8_t *nextop, ITEM_t *item) {
     push_stack(VM->stack, VALUE_NIL);
     return nextop;
   }
-  ITEM_t *taskitem = find_item(config.itemroot, itemname.s);
+  ITEM_t *taskitem = find_item(config.itemroot,
+                                          STRING_CHARS(AS_STR(itemname)));
   if (!taskitem) {
     // If the task item doesn't exist, it can't be run.
     FREE_STR(itemname);
@@ -153,19 +205,19 @@ uint8_t *lc_task_newgametask(uint8_t *nextop, ITEM_t *item) {
   }
   // We have the task item, and the start and repeat intervals.
   // Intervals are given in 10ths of a second, but we need milliseconds.
-  repeatin.i *= 100;
-  startin.i *= 100;
-  TASK_t *newtask = make_task(itemname.s, repeatin.i);
+  int64_t repeat = AS_INT(repeatin) * 100;
+  int64_t start = AS_INT(startin) * 100;
+  TASK_t *newtask = make_task(STRING_CHARS(AS_STR(itemname)), repeat);
   FREE_STR(itemname);
   // Now add the task to the game loop starting at the correct interval
   uv_timer_init(config.loop, newtask->timer);
   // The handle needs to be able to access its task
   newtask->timer->data = newtask;
   // Off we go!
-  uv_timer_start(newtask->timer, execute_task_cb, startin.i, repeatin.i);
+  uv_timer_start(newtask->timer, execute_task_cb, start, repeat);
 
   // libcalls always return a value. In this case, the id of the task.
-  VALUE_t ret = {VALUE_int, {newtask->id}};
+  VALUE_t ret = INT_VALUE(newtask->id);
   push_stack(VM->stack, ret);
   return nextop;
 }
@@ -174,7 +226,7 @@ uint8_t *lc_task_killtask(uint8_t *nextop, ITEM_t *item) {
   // Given a task id, kill it.
   // First validate the argument
   VALUE_t taskid = pop_stack(VM->stack);
-  if (taskid.type != VALUE_int) {
+  if (!IS_INT(taskid)) {
     FREE_STR(taskid);
     set_error_item(ERR_RUNTIME_INVALIDARGS);
     push_stack(VM->stack, VALUE_NIL);
@@ -182,7 +234,7 @@ uint8_t *lc_task_killtask(uint8_t *nextop, ITEM_t *item) {
   }
 
   // Does this task even exist?
-  TASK_t *task = find_task_by_id(taskid.i);
+  TASK_t *task = find_task_by_id(AS_INT(taskid));
   if (!task) {
     // Nope!
     push_stack(VM->stack, VALUE_FALSE);
@@ -194,53 +246,107 @@ uint8_t *lc_task_killtask(uint8_t *nextop, ITEM_t *item) {
   return nextop;
 }
 
+static int64_t take_event(LINE_t *next, VALUE_t *text) {
+  // Deal with what has happened on a line, and say what it was: 1 for a
+  // connection, 2 for a disconnection, or 3 for a line of input, which is
+  // put in text.
+  switch (next->status) {
+    case LINE_connecting:
+      line_connected(next);
+      return 1;
+    case LINE_disconnecting:
+      destroy_line(next);
+      next->status = LINE_empty;
+      return 2;
+    case LINE_data:
+      *text = STR_VALUE(get_input(next));
+      return 3;
+    default:
+      // Nothing left to report.
+      return 0;
+  }
+}
+
 uint8_t *lc_net_input(uint8_t *nextop, ITEM_t *item) {
   // Called by the task which checks for player input.
-  // We operate a fair queuing process here.  Everyone
-  // gets a turn.  Find the next activity.
-  config.lastconn++;
-  if (config.lastconn >= config.maxconns) {
-    config.lastconn = 0;
+  // Lines are reported in the order things happened on them, and a line
+  // with more input waiting goes to the back of the queue, so everyone
+  // gets a turn.
+  LINE_t *next = next_event();
+  if (!next) {
+    // No activity found.
+    push_stack(VM->stack, VALUE_ZERO);
+    return nextop;
   }
-  while (config.lastconn < config.maxconns) {
-    VALUE_t val = {VALUE_int, {0}};
-    // Find some activity.
-    switch (line[config.lastconn].status) {
-      case LINE_connecting:
-        line[config.lastconn].status = LINE_idle;
-        // Set the input item to the current line
-        val.i = config.lastconn;
-        set_item(config.itemroot, config.inputline, val);
-        // And return a value from this libcall to say what happened.
-        val.i = 1;
-        push_stack(VM->stack, val);
-        return nextop;
-      case LINE_disconnecting:
-        destroy_line(&line[config.lastconn]);
-        line[config.lastconn].status = LINE_empty;
-        // Set the input item to the current line
-        val.i = config.lastconn;
-        set_item(config.itemroot, config.inputline, val);
-        val.i = 2;
-        push_stack(VM->stack, val);
-        return nextop;
-      case LINE_data:
-        // Set the input item to the current line
-        val.i = config.lastconn;
-        set_item(config.itemroot, config.inputline, val);
-        // And grab some data.
-        VALUE_t str = {VALUE_str, {0}};
-        str.s = get_input(&line[config.lastconn]);
-        set_item(config.itemroot, config.inputtext, str);
-        val.i = 3;
-        push_stack(VM->stack, val);
-        return nextop;
-      default:
-        config.lastconn++;
-    }
+  VALUE_t str = VALUE_NIL;
+  // Set the input item to the current line
+  set_item(config.itemroot, config.inputline, INT_VALUE(next->linenum));
+  // And return a value from this libcall to say what happened.
+  VALUE_t val = INT_VALUE(take_event(next, &str));
+  if (IS_STR(str)) {
+    set_item(config.itemroot, config.inputtext, str);
+  }
+  push_stack(VM->stack, val);
+  return nextop;
+}
+
+static ITEM_t *event_item(ITEM_t *parent, const char *name) {
+  // Find a child of one of the event items, or make it.
+  ITEM_t *child = search_children(parent->children, name);
+  if (!child) {
+    child = make_item(name, parent, ITEM_value, VALUE_NIL, NULL, 0);
+  }
+  return child;
+}
+
+static void set_event_value(ITEM_t *parent, const char *name,
+                                                          VALUE_t value) {
+  // Events are thrown away as soon as they have been dealt with, so they
+  // are not journalled.
+  ITEM_t *item = event_item(parent, name);
+  if (item->type != ITEM_value) {
+    FREE_STR(value);
+    return;
   }
-  // No activity found.
-  push_stack(VM->stack, VALUE_ZERO);
+  FREE_STR(item->value);
+  item->value = value;
+  mark_changed(item);
+}
+
+uint8_t *lc_net_events(uint8_t *nextop, ITEM_t *item) {
+  // The batched form of net.input.  Every line with something to report
+  // gets one turn, and each event goes into its own numbered item, from
+  // input.event.1 up:
+  //   input.event.<n>.type  1, 2 or 3, as returned by net.input
+  //   input.event.<n>.line  the line number
+  //   input.event.<n>.text  the line of input, or nil
+  // Returns the number of events.  Items left over from a bigger batch
+  // are not cleared.
+  uint32_t count = pending_events();
+  if (count == 0) {
+    push_stack(VM->stack, VALUE_ZERO);
+    return nextop;
+  }
+  ITEM_t *events = find_item(config.itemroot, config.inputevent);
+  if (!events) {
+    events = insert_item(config.itemroot, config.inputevent, VALUE_NIL);
+  }
+  if (!events || events->type != ITEM_value) {
+    set_error_item(ERR_RUNTIME_INVALIDARGS);
+    push_stack(VM->stack, VALUE_NIL);
+    return nextop;
+  }
+  char name[12];
+  for (uint32_t n = 1; n <= count; n++) {
+    LINE_t *next = next_event();
+    VALUE_t str = VALUE_NIL;
+    sprintf(name, "%u", n);
+    ITEM_t *event = event_item(events, name);
+    set_event_value(event, "line", INT_VALUE(next->linenum));
+    set_event_value(event, "type", INT_VALUE(take_event(next, &str)));
+    set_event_value(event, "text", str);
+  }
+  push_stack(VM->stack, INT_VALUE(count));
   return nextop;
 }
 
@@ -250,22 +356,23 @@ uint8_t *lc_net_write(uint8_t *nextop, ITEM_t *item) {
   VALUE_t out = pop_stack(VM->stack);
   VALUE_t linenum = pop_stack(VM->stack);
 
-  if (linenum.type != VALUE_int || linenum.i < 0 
-                                        || linenum.i >= config.maxconns) {
+  if (!IS_INT(linenum) || AS_INT(linenum) < 0
+                                    || AS_INT(linenum) >= config.maxconns) {
     FREE_STR(out);
     set_error_item(ERR_RUNTIME_INVALIDARGS);
     push_stack(VM->stack, VALUE_NIL);
     return nextop;
   } else {
-    switch(out.type) {
+    telnet_t *telnet = line[AS_INT(linenum)].telnet;
+    switch(VALUE_TYPE(out)) {
       case VALUE_str:
-        telnet_send_text(line[linenum.i].telnet, out.s, strlen(out.s));
+        telnet_send_text(telnet, STRING_CHARS(AS_STR(out)), AS_STR(out)->len);
         FREE_STR(out);
         break;
       case VALUE_int:
         char buffer[22];
-        itoa(out.i, buffer, 10);
-        telnet_send_text(line[linenum.i].telnet, buffer, strlen(buffer));
+        itoa(AS_INT(out), buffer, 10);
+        telnet_send_text(telnet, buffer, strlen(buffer));
         break;
       case VALUE_nil:
         // Nothing to output
@@ -273,8 +380,8 @@ uint8_t *lc_net_write(uint8_t *nextop, ITEM_t *item) {
       case VALUE_bool:
         char *t = "true";
         char *f = "false";
-        telnet_send_text(line[linenum.i].telnet, out.i?t:f,
-                                                        strlen(out.i?t:f));
+        telnet_send_text(telnet, AS_BOOL(out)?t:f,
+                                                  strlen(AS_BOOL(out)?t:f));
         break;
     }
   }
@@ -287,9 +394,12 @@ uint8_t *lc_str_capitalise(uint8_t *nextop, ITEM_t *item) {
   // If the value on the top of the stack is a string, capitalise the
   // first letter.  Otherwise pop the top of the stack and push nil.
 
-  if (VM->stack->stack[VM->stack->current].type == VALUE_str) {
-    VM->stack->stack[VM->stack->current].s[0] =
-                        toupper(VM->stack->stack[VM->stack->current].s[0]);
+  VALUE_t *top = &VM->stack->stack[VM->stack->current];
+  if (IS_STR(*top)) {
+    // The string may be shared, so get one we can change.
+    STRING_t *str = unshare_string(AS_STR(*top));
+    *top = STR_VALUE(str);
+    str->chars[0] = toupper(str->chars[0]);
   } else {
     pop_stack(VM->stack);
     push_stack(VM->stack, VALUE_NIL);
@@ -301,8 +411,11 @@ uint8_t *lc_str_upper(uint8_t *nextop, ITEM_t *item) {
   // If the value on the top of the stack is a string, make it
   // uppercase.  Otherwise pop the top of the stack and push nil.
 
-  if (VM->stack->stack[VM->stack->current].type == VALUE_str) {
-    char *c = VM->stack->stack[VM->stack->current].s;
+  VALUE_t *top = &VM->stack->stack[VM->stack->current];
+  if (IS_STR(*top)) {
+    STRING_t *str = unshare_string(AS_STR(*top));
+    *top = STR_VALUE(str);
+    char *c = str->chars;
     while (*c) {
       *c = toupper(*c);
       c++;
@@ -318,8 +431,11 @@ uint8_t *lc_str_lower(uint8_t *nextop, ITEM_t *item) {
   // If the value on the top of the stack is a string, make it
   // lowercase.  Otherwise pop the top of the stack and push nil.
 
-  if (VM->stack->stack[VM->stack->current].type == VALUE_str) {
-    char *c = VM->stack->stack[VM->stack->current].s;
+  VALUE_t *top = &VM->stack->stack[VM->stack->current];
+  if (IS_STR(*top)) {
+    STRING_t *str = unshare_string(AS_STR(*top));
+    *top = STR_VALUE(str);
+    char *c = str->chars;
     while (*c) {
       *c = tolower(*c);
       c++;
@@ -336,10 +452,12 @@ const LIBCALL_t libcalls[] = {
   {"sys", "log", 1, 1, 1, lc_sys_log},
   {"sys", "shutdown", 1, 2, 0, lc_sys_shutdown},
   {"sys", "abort", 1, 3, 0, lc_sys_abort},
+  {"sys", "profile", 1, 4, 1, lc_sys_profile},
   {"task", "newgametask", 2, 0, 3, lc_task_newgametask},
   {"task", "killtask", 2, 1, 1, lc_task_killtask},
   {"net", "input", 3, 0, 0, lc_net_input},
   {"net", "write", 3, 1, 2, lc_net_write},
+  {"net", "events", 3, 2, 0, lc_net_events},
   {"str", "capitalise", 4, 0, 1, lc_str_capitalise},
   {"str", "upper", 4, 1, 1, lc_str_upper},
   {"str", "lower", 4, 2, 1, lc_str_lower},
@@ -375,3 +493,15 @@ void *libcall_func(uint8_t lib, uint8_t call) {
   return NULL;
 }
 
+
+int libcall_args(uint8_t lib, uint8_t call) {
+  // Given a library and call index, return the number of arguments the
+  // call takes, or -1 if there is no such call.
+  for (int i = 0; libcalls[i].libname != NULL; i++) {
+    if (libcalls[i].lib_index == lib &&
+        libcalls[i].call_index == call) {
+      return libcalls[i].args;
+    }
+  }
+  return -1;
+}
@@ -24,4 +24,5 @@ typedef struct {
 bool libcall_lookup(const char *libname, const char *callname,
                     uint8_t *lib_index, uint8_t *call_index, uint8_t *args);
 void *libcall_func(uint8_t lib, uint8_t call);
+int libcall_args(uint8_t lib, uint8_t call);
 
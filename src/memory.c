@@ -3,6 +3,7 @@
 // Licensed under the MIT License - see LICENSE file for details.
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "memory.h"
 #include "log.h"
@@ -36,3 +37,138 @@ void* reallocate(void* ptr, size_t oldcount, size_t newcount) {
 
   // We don't use oldcount yet.  But we will.
 }
+
+// Blocks start small, so that a small itemstore stays small, and double
+// in size up to a limit as the size class gets busier.
+#define SLAB_FIRST_BLOCK  (4 * 1024)
+#define SLAB_LAST_BLOCK   (1024 * 1024)
+
+static _Thread_local SLAB_t slab[SLAB_CLASSES];
+
+void *slab_allocate(size_t size) {
+  // Allocate a zeroed object of the given size.
+  if (size == 0 || size > SLAB_MAX_OBJECT) {
+    return reallocate(NULL, 0, size);
+  }
+  int class = (size - 1) / SLAB_GRANULE;
+  size_t objsize = (class + 1) * SLAB_GRANULE;
+  SLAB_t *s = &slab[class];
+  void *obj;
+  if (s->freelist) {
+    obj = s->freelist;
+    s->freelist = *(void **)obj;
+  } else {
+    if (s->next + objsize > s->end) {
+      // Start a new block.  Whatever is left of the old one is too small
+      // for an object, so it is wasted.
+      if (s->blocksize == 0) {
+        s->blocksize = SLAB_FIRST_BLOCK;
+      }
+      s->next = reallocate(NULL, 0, s->blocksize);
+      s->end = s->next + s->blocksize;
+      s->blocks++;
+      if (s->blocksize < SLAB_LAST_BLOCK) {
+        s->blocksize *= 2;
+      }
+    }
+    obj = s->next;
+    s->next += objsize;
+  }
+  memset(obj, 0, objsize);
+  s->allocs++;
+  if (++s->inuse > s->peak) {
+    s->peak = s->inuse;
+  }
+  return obj;
+}
+
+void *slab_reallocate(void *ptr, size_t oldsize, size_t newsize) {
+  // Grow or shrink an object, which may move it between size classes.
+  if (!ptr) {
+    return slab_allocate(newsize);
+  }
+  if (oldsize > SLAB_MAX_OBJECT && newsize > SLAB_MAX_OBJECT) {
+    return reallocate(ptr, oldsize, newsize);
+  }
+  if (oldsize <= SLAB_MAX_OBJECT && newsize <= SLAB_MAX_OBJECT
+         && (oldsize - 1) / SLAB_GRANULE == (newsize - 1) / SLAB_GRANULE) {
+    // Still fits in the same size class.
+    return ptr;
+  }
+  void *newptr = slab_allocate(newsize);
+  memcpy(newptr, ptr, oldsize < newsize ? oldsize : newsize);
+  slab_release(ptr, oldsize);
+  return newptr;
+}
+
+void slab_release(void *ptr, size_t size) {
+  // Put an object back on the free list of its size class.
+  if (size == 0 || size > SLAB_MAX_OBJECT) {
+    reallocate(ptr, size, 0);
+    return;
+  }
+  SLAB_t *s = &slab[(size - 1) / SLAB_GRANULE];
+  *(void **)ptr = s->freelist;
+  s->freelist = ptr;
+  s->inuse--;
+}
+
+void slab_detach(SLAB_t *slabs) {
+  // Hand over this thread's slabs, leaving it with none.
+  memcpy(slabs, slab, sizeof(slab));
+  memset(slab, 0, sizeof(slab));
+}
+
+void slab_attach(SLAB_t *slabs) {
+  // Take on slabs handed over by another thread.  Only one current block
+  // can be kept for each size class, so the rest of the other goes on the
+  // free list.
+  for (int class = 0; class < SLAB_CLASSES; class++) {
+    SLAB_t *s = &slab[class];
+    SLAB_t *other = &slabs[class];
+    size_t objsize = (class + 1) * SLAB_GRANULE;
+    if (other->end - other->next > s->end - s->next) {
+      char *next = s->next, *end = s->end;
+      s->next = other->next;
+      s->end = other->end;
+      other->next = next;
+      other->end = end;
+    }
+    while (other->next && other->next + objsize <= other->end) {
+      *(void **)other->next = s->freelist;
+      s->freelist = other->next;
+      other->next += objsize;
+    }
+    if (other->freelist) {
+      void **last = other->freelist;
+      while (*last) {
+        last = *last;
+      }
+      *last = s->freelist;
+      s->freelist = other->freelist;
+    }
+    if (other->blocksize > s->blocksize) {
+      s->blocksize = other->blocksize;
+    }
+    s->blocks += other->blocks;
+    s->inuse += other->inuse;
+    s->allocs += other->allocs;
+    if (s->inuse > s->peak) {
+      s->peak = s->inuse;
+    }
+  }
+  memset(slabs, 0, sizeof(SLAB_t) * SLAB_CLASSES);
+}
+
+void log_slab_stats() {
+  // Show how each size class has been used.
+  logmsg("Slab statistics:\n");
+  for (int class = 0; class < SLAB_CLASSES; class++) {
+    SLAB_t *s = &slab[class];
+    if (s->allocs > 0) {
+      logmsg("  %3d bytes: %zu in use, %zu peak, %zu allocations, "
+                   "%zu blocks\n", (class + 1) * SLAB_GRANULE, s->inuse,
+                                           s->peak, s->allocs, s->blocks);
+    }
+  }
+}
@@ -22,3 +22,37 @@
 
 void* reallocate(void* pointer, size_t oldSize, size_t newSize);
 
+// Small objects which are made and destroyed in great numbers (such as
+// items) come from slabs instead.  Each size class carves its objects out
+// of large blocks, and keeps freed objects on a list to be reused.  The
+// size must be given again when the memory is released.  Anything bigger
+// than SLAB_MAX_OBJECT simply goes to reallocate().
+//
+// Each thread has slabs of its own, so that threads which build items
+// (such as those loading the itemstore) need no locking.  Before such a
+// thread ends, it hands its slabs over with slab_detach(), and the main
+// thread takes them on with slab_attach(), after which the objects are
+// just like any others.
+#define SLAB_GRANULE      16    // Size classes are multiples of this
+#define SLAB_CLASSES      16    // Number of size classes
+#define SLAB_MAX_OBJECT   (SLAB_GRANULE * SLAB_CLASSES)
+
+typedef struct {
+  void *freelist;       // Released objects, each pointing to the next
+  char *next;           // Next unused object in the current block
+  char *end;            // End of the current block
+  size_t blocksize;     // Size of the next block to be allocated
+  // Statistics
+  size_t blocks;        // Number of blocks allocated
+  size_t inuse;         // Objects currently allocated
+  size_t peak;          // Most objects ever allocated at once
+  size_t allocs;        // Total number of allocations
+} SLAB_t;
+
+void *slab_allocate(size_t size);
+void *slab_reallocate(void *ptr, size_t oldsize, size_t newsize);
+void slab_release(void *ptr, size_t size);
+void slab_detach(SLAB_t *slabs);
+void slab_attach(SLAB_t *slabs);
+void log_slab_stats();
+
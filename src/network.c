@@ -27,6 +27,18 @@ static const telnet_telopt_t telopts[] = {
 
 LINE_t *line;
 
+// Lines with something for net.input to report, in the order it happened.
+// A line is never in the queue more than once, so it needs no more room
+// than there are lines.
+static uint8_t *queue;
+static uint32_t queue_head;
+static uint32_t queue_count;
+// Events taken from the queue so far, so that input_processor() can tell
+// whether the input item is taking any.
+static uint64_t events_taken;
+// Is there output waiting to be sent to any line?
+static bool output_waiting;
+
 void init_networking() {
   // Do that which needs to be done before starting the network interface
 
@@ -34,6 +46,46 @@ void init_networking() {
   for (int l = 0; l < config.maxconns; l++) {
     line[l].status = LINE_empty;
     line[l].linenum = l;
+    line[l].queued = false;
+  }
+  queue = GROW_ARRAY(uint8_t, NULL, 0, config.maxconns);
+  queue_head = queue_count = 0;
+}
+
+static void queue_line(LINE_t *line) {
+  // Let net.input know that something has happened on this line.
+  if (!line->queued) {
+    line->queued = true;
+    queue[(queue_head + queue_count++) % config.maxconns] = line->linenum;
+  }
+}
+
+uint32_t pending_events() {
+  // How many lines have something to report.
+  return queue_count;
+}
+
+LINE_t *next_event() {
+  // Take the next line with something to report, or NULL if there are
+  // none.
+  if (queue_count == 0) {
+    return NULL;
+  }
+  LINE_t *next = &line[queue[queue_head]];
+  queue_head = (queue_head + 1) % config.maxconns;
+  queue_count--;
+  events_taken++;
+  next->queued = false;
+  return next;
+}
+
+void line_connected(LINE_t *line) {
+  // The connection has been reported.  Any input which arrived before it
+  // was is reported next.
+  line->status = LINE_idle;
+  if (strchr(line->inbuf->buf.base, '\n')) {
+    line->status = LINE_data;
+    queue_line(line);
   }
 }
 
@@ -89,6 +141,12 @@ void client_on_close(uv_handle_t *handle) {
   LINE_t *line = find_line((uv_tcp_t *)handle);
   logmsg("Line %d: %s disconnected.\n", line->linenum, line->address);
   line->status = LINE_disconnecting;
+  queue_line(line);
+}
+
+static void refused_on_close(uv_handle_t *handle) {
+  // A client which never got a line has nothing to clean up but itself
+  free(handle);
 }
 
 void append_output(LINE_t *line, const char *msg, const ssize_t len) {
@@ -103,6 +161,7 @@ void append_output(LINE_t *line, const char *msg, const ssize_t len) {
     }
     memcpy(line->outbuf->buf.base + line->outbuf->buf.len, msg, len);
     line->outbuf->buf.len += len;
+    output_waiting = true;
   }
 }
 
@@ -113,9 +172,10 @@ void append_input(LINE_t *line, const char *msg, const ssize_t len) {
   if (line->status != LINE_empty && line->status != LINE_disconnecting) {
     // No point in doing this if there is no connection.
     // If there is a newline in the input, we have received
-    // a complete line of input.
-    if (memchr(msg, '\n', len)) {
+    // a complete line of input.  A new connection is reported first.
+    if (memchr(msg, '\n', len) && line->status != LINE_connecting) {
       line->status = LINE_data;
+      queue_line(line);
     }
     while (line->inbuf->buf.len + len + 1 >= line->inbuf->length) {
       line->inbuf->length += INBUF_LENGTH;
@@ -128,16 +188,18 @@ void append_input(LINE_t *line, const char *msg, const ssize_t len) {
   }
 }
 
-char *get_input(LINE_t *line) {
+STRING_t *get_input(LINE_t *line) {
   // Extract a line of input from the input buffer.  Should only be called
   // when the line status is LINE_data.  If there is nothing left in the
   // input buffer, set the status to LINE_idle, otherwise leave it
-  // unchanged.  The buffer allocated by this function will need to be
-  // freed by the calling function when it is no longer needed.
+  // unchanged, and put the line back at the end of the queue, so that
+  // everyone gets a turn.  The string returned by this function will need to be
+  // released by the calling function when it is no longer needed.
   // If there isn't a newline in the input buffer, explode messily.
   char *eol = strchr(line->inbuf->buf.base, '\n');
   *eol = '\0';
-  char *data = strdup(line->inbuf->buf.base);
+  STRING_t *data = make_string(line->inbuf->buf.base,
+                                            eol - line->inbuf->buf.base);
   // Ok, we have the line of data, now take it out of the input buffer.
   eol++;
   char *newbuffer = malloc(INBUF_LENGTH);
@@ -148,6 +210,8 @@ char *get_input(LINE_t *line) {
   line->inbuf->buf.len = strlen(newbuffer);
   if (!strchr(line->inbuf->buf.base, '\n')) {
     line->status = LINE_idle;
+  } else {
+    queue_line(line);
   }
   return data;
 }
@@ -178,11 +242,31 @@ void telnet_event_handler(telnet_t *telnet, telnet_event_t *ev,
 	}
 }
 
+void write_done(uv_write_t *req, int status) {
+  write_req_t *wr = (write_req_t *)req;
+  free(wr->buf.base);
+  free(wr);
+}
+
 void flush_output(LINE_t *line) {
-  // Send the output to the line, and reset the buffer.
+  // Send the output to the line, and reset the buffer.  Usually it can
+  // all be sent straight away.  Whatever can't is given a request and a
+  // buffer of its own, because the line's buffer is about to be reused.
   if (line->outbuf->buf.len > 0) {
-    uv_write((uv_write_t*) &line->outbuf->req,
-            (uv_stream_t*)line->line_handle, &line->outbuf->buf, 1, NULL);
+    uv_stream_t *stream = (uv_stream_t *)line->line_handle;
+    int sent = uv_try_write(stream, &line->outbuf->buf, 1);
+    if (sent == UV_EAGAIN) {
+      sent = 0;
+    }
+    if (sent >= 0 && sent < line->outbuf->buf.len) {
+      write_req_t *wr = (write_req_t *)malloc(sizeof(write_req_t));
+      wr->length = line->outbuf->buf.len - sent;
+      wr->buf = uv_buf_init(malloc(wr->length), wr->length);
+      memcpy(wr->buf.base, line->outbuf->buf.base + sent, wr->length);
+      if (uv_write(&wr->req, stream, &wr->buf, 1, write_done) != 0) {
+        write_done(&wr->req, 0);
+      }
+    }
     line->outbuf->buf.len = 0;
     line->outbuf->buf.base[0] = '\0';
   }
@@ -226,7 +310,8 @@ void on_new_connection(uv_stream_t *server, int status) {
       uv_buf_t gamefull = {"Too many connections.\r\n", 23};
       uv_try_write((uv_stream_t *)client, &gamefull, 1);
       logmsg("Maximum connections (%d) exceeded.\n", config.maxconns);
-      uv_close((uv_handle_t *)client, client_on_close);
+      uv_close((uv_handle_t *)client, refused_on_close);
+      return;
     }
     newline->telnet = telnet_init(telopts, telnet_event_handler, 
                                               TELNET_FLAG_NVT_EOL, newline);
@@ -237,11 +322,12 @@ void on_new_connection(uv_stream_t *server, int status) {
     uv_tcp_getpeername(client, (struct sockaddr *)&peername, &peernamelen);
     uv_ip_name((struct sockaddr *)&peername, newline->address, 40);
     uv_read_start((uv_stream_t *)client, alloc_buffer, client_read);
+    queue_line(newline);
     logmsg("Line %d: %s connected.\n", newline->linenum,
                                                           newline->address);
   }
   else {
-    uv_close((uv_handle_t *)client, client_on_close);
+    uv_close((uv_handle_t *)client, refused_on_close);
   }
 }
 
@@ -252,7 +338,8 @@ void init_listener(uint32_t port) {
   uv_ip6_addr("::", port, &addr);
   uv_tcp_bind(&config.listener, (const struct sockaddr *)&addr, 0);
   uv_tcp_nodelay(&config.listener, 1);
-  int r = uv_listen((uv_stream_t *) &config.listener, 10, on_new_connection);
+  int r = uv_listen((uv_stream_t *) &config.listener, SOMAXCONN,
+                                                        on_new_connection);
   if (r) {
     logerr("Failed to start listening: %s\n", uv_strerror(r));
   } else {
@@ -260,25 +347,73 @@ void init_listener(uint32_t port) {
   }
 }
 
-void input_processor(uv_idle_t* handle) {
-  // Called once per iteration of the game loop
-  config.vm = config.input_vm;
-  ITEM_t *input = find_item(config.itemroot, config.input);
-  if (!input) {
-    logerr("Input item does not exist!  Cannot continue.\n");
-    exit(EXIT_FAILURE);
-  }
-  interpret(input);
-  reset_stack(VM->stack);
+static void flush_all_output() {
   // Flush the output of every connected line
+  if (!output_waiting) {
+    return;
+  }
+  output_waiting = false;
   for (int l = 0; l < config.maxconns; l++) {
     if (line[l].status != LINE_empty 
                                   && line[l].status != LINE_disconnecting) {
       flush_output(&line[l]);
     }
   }
-  // Don't hog the CPU.
-  usleep(100);
+}
+
+static void run_input() {
+  // If anything has happened on the lines, run the input item until it
+  // has taken every event.
+  if (queue_count > 0) {
+    config.vm = config.input_vm;
+    ITEM_t *input = find_item(config.itemroot, config.input);
+    if (!input) {
+      logerr("Input item does not exist!  Cannot continue.\n");
+      exit(EXIT_FAILURE);
+    }
+    while (queue_count > 0) {
+      uint64_t taken = events_taken;
+      interpret(input);
+      reset_stack(VM->stack);
+      if (events_taken == taken) {
+        // It isn't calling net.input, so running it again won't help.
+        break;
+      }
+    }
+  }
+}
+
+void input_processor(uv_check_t *handle) {
+  // Called on every iteration of the run loop, just after it has waited
+  // for network activity, so that the loop can wait again.
+  run_input();
+  flush_all_output();
+}
+
+void output_flusher(uv_prepare_t *handle) {
+  // Called on every iteration of the run loop, just before it waits, to
+  // send what the tasks have written.  A line closed by the network is
+  // only queued after the input item has run, so its events are taken
+  // here, as otherwise nothing would report them until the loop woke up
+  // again.
+  run_input();
+  flush_all_output();
+}
+
+void close_sockets() {
+  // Close the listener and every line, without telling libuv.  This is
+  // only for a forked child, so that it does not keep open any socket
+  // which the parent closes.
+  uv_os_fd_t fd;
+  if (uv_fileno((uv_handle_t *)&config.listener, &fd) == 0) {
+    close(fd);
+  }
+  for (int l = 0; line && l < config.maxconns; l++) {
+    if (line[l].status != LINE_empty
+            && uv_fileno((uv_handle_t *)line[l].line_handle, &fd) == 0) {
+      close(fd);
+    }
+  }
 }
 
 void shutdown_listener() {
@@ -289,5 +424,6 @@ void shutdown_networking() {
   // Having been set-up, now shut it down.  Shut it down forever.
   // All the lines will have been disconnected by this point.
   FREE_ARRAY(LINE_t, line, config.maxconns);
+  FREE_ARRAY(uint8_t, queue, config.maxconns);
 }
 
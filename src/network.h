@@ -5,10 +5,12 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <sys/socket.h>
 #include <uv.h>
 
 #include "libtelnet.h"
+#include "value.h"
 
 // Default maximum connections
 #define MAXCONNS  50
@@ -24,6 +26,7 @@ typedef struct {
   enum { LINE_empty, LINE_connecting,
          LINE_disconnecting, LINE_data, LINE_idle } status;
   uint8_t linenum;
+  bool queued;  // Waiting to be reported by net.input
   char address[40];
   telnet_t *telnet;
   write_req_t *outbuf;
@@ -33,8 +36,13 @@ typedef struct {
 void init_networking();
 void init_listener(uint32_t port);
 void destroy_line(LINE_t *line);
-void input_processor(uv_idle_t* handle);
-char *get_input(LINE_t *line);
+uint32_t pending_events();
+LINE_t *next_event();
+void line_connected(LINE_t *line);
+void input_processor(uv_check_t *handle);
+void output_flusher(uv_prepare_t *handle);
+STRING_t *get_input(LINE_t *line);
+void close_sockets();
 void shutdown_listener();
 void shutdown_networking();
 
@@ -0,0 +1,2361 @@
+/* A Bison parser, made by GNU Bison 3.8.2.  */
+
+/* Bison implementation for Yacc-like parsers in C
+
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+/* As a special exception, you may create a larger work that contains
+   part or all of the Bison parser skeleton and distribute that work
+   under terms of your choice, so long as that work isn't itself a
+   parser generator using the skeleton or a modified version thereof
+   as a parser skeleton.  Alternatively, if you modify or redistribute
+   the parser skeleton itself, you may (at your option) remove this
+   special exception, which will cause the skeleton and the resulting
+   Bison output files to be licensed under the GNU General Public
+   License without this special exception.
+
+   This special exception was added by the Free Software Foundation in
+   version 2.2 of Bison.  */
+
+/* C LALR(1) parser skeleton written by Richard Stallman, by
+   simplifying the original so-called "semantic" parser.  */
+
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
+/* All symbols defined below should begin with yy or YY, to avoid
+   infringing on user name space.  This should be done even for local
+   variables, as they might otherwise be expanded by user macros.
+   There are some unavoidable exceptions within include files to
+   define necessary library symbols; they are noted "INFRINGES ON
+   USER NAME SPACE" below.  */
+
+/* Identify Bison output, and Bison version.  */
+#define YYBISON 30802
+
+/* Bison version string.  */
+#define YYBISON_VERSION "3.8.2"
+
+/* Skeleton name.  */
+#define YYSKELETON_NAME "yacc.c"
+
+/* Pure parsers.  */
+#define YYPURE 2
+
+/* Push parsers.  */
+#define YYPUSH 0
+
+/* Pull parsers.  */
+#define YYPULL 1
+
+
+
+
+/* First part of user prologue.  */
+#line 74 "src/parser.y"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "error.h"
+#include "parser.h"
+#include "memory.h"
+#include "libcall.h"
+
+typedef void *yyscan_t;
+int yylex (YYSTYPE *yylval_param, yyscan_t yyscanner);
+int yylex_init(yyscan_t* scanner);
+int yylex_init_extra(yy_extra_type my_extra, yyscan_t* sc);
+void yyset_in(FILE *_in_str, yyscan_t yyscanner);
+int yylex_destroy(yyscan_t yyscanner);
+int yyparse();
+
+void yyerror(yyscan_t locp, SCANNER_STATE_t *state, char const *s) {
+  // We don't actually do anything in yyerror, we just need to define it.
+  // yyerror() is called whenever there is a syntax error, so we need to
+  // set the error number in the state appropriately.
+  state->local->errnum = ERR_COMP_SYNTAX;
+}
+
+void emit_byte(unsigned char c, OUTPUT_t *out) {
+    // Check if there is enough space in the buffer
+    if (out->nextbyte - out->bytecode >= out->maxsize) {
+        // Calculate the new buffer size
+        int oldsize = out->maxsize;
+        out->maxsize = GROW_CAPACITY(oldsize * 1.25);
+        
+        // Reallocate the buffer
+        unsigned char *new_buffer = GROW_ARRAY(unsigned char, out->bytecode, oldsize, out->maxsize);
+        
+        // Update buffer pointers
+        out->nextbyte = new_buffer + (out->nextbyte - out->bytecode);
+        out->bytecode = new_buffer;
+    }
+    
+    // Add the byte directly
+    *out->nextbyte++ = c;
+}
+
+void emit_int64(uint64_t i, OUTPUT_t *out) {
+  for (int j = 0; j < 8; j++) {
+    emit_byte((unsigned char)(i & 0xFF), out);
+    i >>= 8;
+  }
+}
+
+void emit_int16(uint16_t i, OUTPUT_t *out) {
+  // This is signedness-agnostic.  It just spits out two bytes.
+  // It is up to the interpreter to know what to do with them.
+  emit_byte((unsigned char)(i & 0xFF), out);
+  emit_byte((unsigned char)((i >> 8) & 0xFF), out);
+}
+
+void emit_string(const char *s, OUTPUT_t *out) {
+  uint16_t l = strlen(s);
+  emit_int16(l, out);  // Write the length of the string (uint16_t)
+  memcpy(out->nextbyte, s, l); // Copy the string directly
+  out->nextbyte += l;
+}
+
+void emit_layer(const char *s, OUTPUT_t *out) {
+  // A bit like emit_string, but emits layers, which are not enclosed by
+  // quotes, and have a maximum length of 255.
+  uint8_t l = strlen(s);
+  emit_byte(l, out);  // Write the length of the string (uint8_t)
+  memcpy(out->nextbyte, s, l); // Copy the string directly (minus quotes)
+  out->nextbyte += l;
+}
+
+bool emit_local_index(char *id, OUTPUT_t *out, LOCAL_t *local) {
+  // Find the identifier in the list and return its index.
+  // Complain if not found.
+  for (uint8_t l = 0; l < local->count; l++) {
+    if (strcmp(id, local->id[l]) == 0) {
+      emit_byte(l, out);
+      return true; // Found, no need to continue searching.
+    }
+  }
+  
+  // No local found, this is a syntax error.
+  return false;
+}
+
+bool prepare_local_assign(char *id, OUTPUT_t *out, LOCAL_t *local) {
+  // Called before actually assigning a local variable.
+  // This is necessary to enable the parser to clean up in the event
+  // of a syntax error.
+
+  // First check to see if the variable has been seen already
+  for (uint8_t l = 0; l < local->count; l++) {
+    if (strcmp(id, local->id[l]) == 0) {
+      // Yes, so do nothing.
+      return true;
+    }
+  }
+  // This is the first time we have seen this local, so add it.
+  // Check if the maximum number of locals has been reached.
+  if (local->count >= MAX_LOCAL_VARS) {
+    free(id);
+    return false;
+  }
+  // Add the new local variable.
+  local->id[local->count] = strdup(id);
+  local->count++;
+  return true;
+}
+
+void emit_local_assign(char *id, OUTPUT_t *out, LOCAL_t *local) {
+  // prepare_local_assign() must be called before this!
+  // Otherwise there will be no matching local variable.
+  for (uint8_t l = 0; l < local->count; l++) {
+    if (strcmp(id, local->id[l]) == 0) {
+      // Local variable already exists, emit bytecode to assign it.
+      emit_byte('c', out);
+      emit_byte(l, out);
+    }
+  }
+}
+
+bool emit_local_op(char *id, LOCAL_t *local, OUTPUT_t *out, char op) {
+  // Emit the specified local operation ('f' for increment, 'g'
+  // for decrement), followed by the local to increment or decrement.
+  emit_byte(op, out);
+  if (emit_local_index(id, out, local)) {
+    return true;
+  } else {
+    local->errnum = ERR_COMP_LOCALBEFOREDEF;
+    return false;
+  }
+}
+
+bool prepare_loop(SCANNER_STATE_t *state) {
+  // We have encountered the start of a loop, so record it for
+  // fixing up later.
+  if (state->control_count >= MAX_NESTED_CONTROLS) {
+    return false;
+  }
+  state->control_count++; // We be looping.
+  state->loop[state->control_count].loop_start = state->out->nextbyte;
+  return true;
+}
+
+void finalise_loop(SCANNER_STATE_t *state) {
+  // Calculate the offset from the jump-to-end to the actual end
+  // Then fix up the jump instruction with the calculated value.
+  int16_t offset = state->out->nextbyte
+                          - state->loop[state->control_count].jump_to_end;
+  unsigned char *store_nextbyte = state->out->nextbyte; // Ugh
+  state->out->nextbyte = state->loop[state->control_count].jump_to_end;
+  emit_int16(offset, state->out);
+  state->out->nextbyte = store_nextbyte;
+  state->control_count--; // Loop be gone.
+}
+
+void emit_jump_to_end(SCANNER_STATE_t *state) {
+  // Emit a conditional jump opcode with a dummy offset.  Record this in
+  // the current loop record for fixing up later.
+  emit_byte('k', state->out);
+  state->loop[state->control_count].jump_to_end = state->out->nextbyte;
+  emit_int16(0, state->out);
+}
+
+void emit_jump_to_start(SCANNER_STATE_t *state) {
+  // Emit an unconditional jump opcode and the offset to jump back
+  // to the start of the loop.
+  emit_byte('j', state->out);
+  int16_t offset = state->loop[state->control_count].loop_start
+                                                  - state->out->nextbyte;
+  emit_int16(offset, state->out);
+}
+
+bool prepare_if(SCANNER_STATE_t *state) {
+  // Called before the first IF expression.
+  // We have encountered the start of an if statement, so record it for
+  // fixing up later.
+  if (state->control_count >= MAX_NESTED_CONTROLS) {
+    return false;
+  }
+  state->control_count++;
+  state->if_stmt[state->control_count].next_else = NULL;
+  state->if_stmt[state->control_count].list = NULL;
+  return true;
+}
+
+void emit_jump_to_next_else(SCANNER_STATE_t *state) {
+  // After every IF or ELSIF condition, there needs to be a jump-if-false
+  // to the next condition (or to the end of the structure).  Insert a
+  // placeholder for later updating.
+  emit_byte('k', state->out);
+  state->if_stmt[state->control_count].next_else = state->out->nextbyte;
+  emit_int16(0, state->out);
+}
+
+void fixup_last_else_jump(SCANNER_STATE_t *state) {
+  // When we encounter an ELSE/ELSIF, update the last jump-to-next-else
+  // with the correct offset.
+  int16_t offset = state->out->nextbyte
+                          - state->if_stmt[state->control_count].next_else;
+  unsigned char *store_nextbyte = state->out->nextbyte; // Ugh
+  state->out->nextbyte = state->if_stmt[state->control_count].next_else;
+  emit_int16(offset, state->out);
+  state->out->nextbyte = store_nextbyte;
+  state->if_stmt[state->control_count].next_else = NULL;
+}
+
+void emit_jump_to_endif(SCANNER_STATE_t *state) {
+  // After every statement block in an IF statement, emit an unconditional
+  // jump to the end of the statement with a placeholder for the offset.
+  // Remember where the offset is, for later fixing-up
+  emit_byte('j', state->out);
+  IF_FIXUP_ADDR_t *fixup = malloc(sizeof(IF_FIXUP_ADDR_t));
+  fixup->addr = state->out->nextbyte;
+  fixup->next = NULL;
+  if (state->if_stmt[state->control_count].list) {
+    fixup->next = state->if_stmt[state->control_count].list;
+  }
+  state->if_stmt[state->control_count].list = fixup;
+  emit_int16(0, state->out);
+}
+
+void finalise_if(SCANNER_STATE_t *state) {
+  // Update all of the jump-to-end addresses with the correct offset.
+  unsigned char *store_nextbyte = state->out->nextbyte;
+  // There might be an ELSE jump still to fix, if this statement had no
+  // ELSE clause.
+  if (state->if_stmt[state->control_count].next_else) {
+    fixup_last_else_jump(state);
+  } else {
+  }
+  // Loop through state->if_stmt[state->control_count].list.
+  // .list will be NULL if there are no more addresses to process.
+  while (state->if_stmt[state->control_count].list) {
+    // Calculate the offset to the end of the IF statement.
+    int16_t offset = store_nextbyte -
+                            state->if_stmt[state->control_count].list->addr;
+    // Update the placeholder with the correct offset.
+    state->out->nextbyte = state->if_stmt[state->control_count].list->addr;
+    emit_int16(offset, state->out);
+    // Free this address and loop to the next in the list.
+    IF_FIXUP_ADDR_t *last = state->if_stmt[state->control_count].list;
+    state->if_stmt[state->control_count].list =
+                        state->if_stmt[state->control_count].list->next;
+    free(last);
+  }
+  // All done.
+  state->out->nextbyte = store_nextbyte;
+  state->control_count--;
+}
+
+void emit_embedded_code(OUTPUT_t *out, char *code) {
+  // Emit embedded code to be compiled by the interpreter.
+  emit_byte('B', out);
+  emit_string(code, out); // Aaaand the code.
+}
+
+void merge_item_buffer(OUTPUT_t *out, OUTPUT_t *item_out) {
+  // Items are assembled in a separate buffer, to facilitate the passing
+  // of arguments.  This function merges the item buffer into the main
+  // output buffer.
+
+  // Check if there is enough space in the buffer
+  int mainbuf_size = out->nextbyte - out->bytecode;
+  int itembuf_size = item_out->nextbyte - item_out->bytecode;
+  if (mainbuf_size + itembuf_size >= out->maxsize) {
+    // Calculate the new buffer size
+    int oldsize = out->maxsize;
+    out->maxsize = GROW_CAPACITY((mainbuf_size + itembuf_size) * 1.25);
+    // Reallocate the buffer
+    unsigned char *new_buffer = GROW_ARRAY(unsigned char, out->bytecode, oldsize, out->maxsize);
+    // Update buffer pointers
+    out->nextbyte = new_buffer + (out->nextbyte - out->bytecode);
+    out->bytecode = new_buffer;
+  }
+  // Now we are sure the buffer is big enough, smush the item buffer
+  // into the main output buffer.
+  memcpy(out->nextbyte, item_out->bytecode, itembuf_size);
+  out->nextbyte += itembuf_size;
+  // Reset the item buffer for its next use
+  item_out->nextbyte = item_out->bytecode;
+}
+
+bool prepare_item(SCANNER_STATE_t *state) {
+  // We have encountered the start of an item, so begin shoving it into
+  // a temporary buffer until we've processed the arguments (if any).
+  if (state->item_count >= MAX_NESTED_CONTROLS) {
+    return false;
+  }
+  state->item_count++;
+  int8_t c = state->item_count;
+  state->arg_count[c] = 0;
+  state->item_out[c] = GROW_ARRAY(OUTPUT_t, NULL, 0, 1);
+  state->item_out[c]->maxsize = 1024;
+  state->item_out[c]->bytecode = GROW_ARRAY(unsigned char, NULL, 0,
+                                              state->item_out[c]->maxsize);
+  state->item_out[c]->nextbyte = state->item_out[c]->bytecode;
+  state->item_buf = state->item_out[c];
+  return true;
+}
+
+void finalise_item(SCANNER_STATE_t *state) {
+  // Having processed the item, merge its buffer into the bytestream
+  // and clean up after ourselves.
+  int8_t c = state->item_count;
+  merge_item_buffer(state->out, state->item_out[c]);
+  FREE_ARRAY(unsigned char, state->item_out[c]->bytecode,
+                                               state->item_out[c]->maxsize);
+  FREE_ARRAY(OUTPUT_t, state->item_out[c], 1);
+  state->item_count--;
+  if (state->item_count > -1) {
+    state->item_buf = state->item_out[state->item_count];
+  } else {
+    state->item_buf = NULL;
+  }
+}
+
+void cleanup_item(SCANNER_STATE_t *state) {
+  // Called when there is a failed parse to clean up any item buffers
+  // which may have been allocated.
+  int8_t c = state->item_count;
+  while (c >= 0) {
+    FREE_ARRAY(unsigned char, state->item_out[c]->bytecode,
+                                               state->item_out[c]->maxsize);
+    FREE_ARRAY(OUTPUT_t, state->item_out[c], 1);
+    c--;
+  }
+}
+
+bool parse_source(char *source, int sourcelen, OUTPUT_t *out,
+                                                          LOCAL_t *local) {
+  // source holds the source input string
+  // sourcelen holds the length of the input
+  // out is a pointer to a struct which holds the output buffer
+  yyscan_t sc;
+  yy_extra_type my_extra;
+  my_extra.deref_depth = 0;
+
+  // Wrap all these bits of state up into a nice package
+  // for ease of transport
+  SCANNER_STATE_t scanner_state;
+  scanner_state.out = out;
+  scanner_state.local = local;
+  scanner_state.local->errnum = ERR_NOERROR;
+  scanner_state.control_count = -1; // We start in no loop.
+  scanner_state.item_count = -1; // We start processing no item.
+  scanner_state.item_buf = NULL;
+
+  yylex_init_extra(my_extra, &sc);
+  FILE *in = fmemopen(source, sourcelen, "r");
+  yyset_in(in, sc);
+
+  // Before we start parsing, make space in the output for the number
+  // of locals - we will backfill the actual number later.
+  emit_byte(0, out);
+  // And the number of parameters this item can receive.
+  // NOTE! Parameters are treated internally as local variables, so the
+  // number of local variables will INCLUDE the number of parameters.
+  emit_byte(0, out);
+
+  bool failed = yyparse(sc, &scanner_state);
+
+  // Clean up
+  fclose(in);
+  yylex_destroy(sc);
+
+  if (!failed) {
+    // ...and now we know how many locals there are, update the first
+    // two bytes of the bytecode.
+    out->bytecode[0] = local->count;
+    out->bytecode[1] = local->param_count;
+    return true;
+  } else {
+    cleanup_item(&scanner_state);
+    return false;
+  }
+}
+
+
+#line 454 "src/parser.c"
+
+# ifndef YY_CAST
+#  ifdef __cplusplus
+#   define YY_CAST(Type, Val) static_cast<Type> (Val)
+#   define YY_REINTERPRET_CAST(Type, Val) reinterpret_cast<Type> (Val)
+#  else
+#   define YY_CAST(Type, Val) ((Type) (Val))
+#   define YY_REINTERPRET_CAST(Type, Val) ((Type) (Val))
+#  endif
+# endif
+# ifndef YY_NULLPTR
+#  if defined __cplusplus
+#   if 201103L <= __cplusplus
+#    define YY_NULLPTR nullptr
+#   else
+#    define YY_NULLPTR 0
+#   endif
+#  else
+#   define YY_NULLPTR ((void*)0)
+#  endif
+# endif
+
+#include "parser.h"
+/* Symbol kind.  */
+enum yysymbol_kind_t
+{
+  YYSYMBOL_YYEMPTY = -2,
+  YYSYMBOL_YYEOF = 0,                      /* "end of file"  */
+  YYSYMBOL_YYerror = 1,                    /* error  */
+  YYSYMBOL_YYUNDEF = 2,                    /* "invalid token"  */
+  YYSYMBOL_TINTEGER = 3,                   /* TINTEGER  */
+  YYSYMBOL_TSTRINGLIT = 4,                 /* TSTRINGLIT  */
+  YYSYMBOL_TLOCAL = 5,                     /* TLOCAL  */
+  YYSYMBOL_TLAYER = 6,                     /* TLAYER  */
+  YYSYMBOL_TLIBNAME = 7,                   /* TLIBNAME  */
+  YYSYMBOL_TCODEBODY = 8,                  /* TCODEBODY  */
+  YYSYMBOL_TUNKNOWNCHAR = 9,               /* TUNKNOWNCHAR  */
+  YYSYMBOL_TSEMI = 10,                     /* TSEMI  */
+  YYSYMBOL_TWHILE = 11,                    /* TWHILE  */
+  YYSYMBOL_TDO = 12,                       /* TDO  */
+  YYSYMBOL_TENDWHILE = 13,                 /* TENDWHILE  */
+  YYSYMBOL_TIF = 14,                       /* TIF  */
+  YYSYMBOL_TTHEN = 15,                     /* TTHEN  */
+  YYSYMBOL_TELSE = 16,                     /* TELSE  */
+  YYSYMBOL_TELSIF = 17,                    /* TELSIF  */
+  YYSYMBOL_TENDIF = 18,                    /* TENDIF  */
+  YYSYMBOL_TRETURN = 19,                   /* TRETURN  */
+  YYSYMBOL_TASSIGN = 20,                   /* TASSIGN  */
+  YYSYMBOL_TEQUAL = 21,                    /* TEQUAL  */
+  YYSYMBOL_TNOTEQUAL = 22,                 /* TNOTEQUAL  */
+  YYSYMBOL_TLESSTHAN = 23,                 /* TLESSTHAN  */
+  YYSYMBOL_TGREATERTHAN = 24,              /* TGREATERTHAN  */
+  YYSYMBOL_TLTEQ = 25,                     /* TLTEQ  */
+  YYSYMBOL_TGTEQ = 26,                     /* TGTEQ  */
+  YYSYMBOL_TAND = 27,                      /* TAND  */
+  YYSYMBOL_TOR = 28,                       /* TOR  */
+  YYSYMBOL_TPLUS = 29,                     /* TPLUS  */
+  YYSYMBOL_TMINUS = 30,                    /* TMINUS  */
+  YYSYMBOL_TMULT = 31,                     /* TMULT  */
+  YYSYMBOL_TDIV = 32,                      /* TDIV  */
+  YYSYMBOL_TINC = 33,                      /* TINC  */
+  YYSYMBOL_TDEC = 34,                      /* TDEC  */
+  YYSYMBOL_TLAYERSEP = 35,                 /* TLAYERSEP  */
+  YYSYMBOL_TDEREFSTART = 36,               /* TDEREFSTART  */
+  YYSYMBOL_TCODE = 37,                     /* TCODE  */
+  YYSYMBOL_TDEREFEND = 38,                 /* TDEREFEND  */
+  YYSYMBOL_TEXISTS = 39,                   /* TEXISTS  */
+  YYSYMBOL_TDELETE = 40,                   /* TDELETE  */
+  YYSYMBOL_TNTHNAME = 41,                  /* TNTHNAME  */
+  YYSYMBOL_TNEXTNAME = 42,                 /* TNEXTNAME  */
+  YYSYMBOL_TROOTNAME = 43,                 /* TROOTNAME  */
+  YYSYMBOL_UMINUS = 44,                    /* UMINUS  */
+  YYSYMBOL_TNOT = 45,                      /* TNOT  */
+  YYSYMBOL_TLPAREN = 46,                   /* TLPAREN  */
+  YYSYMBOL_TRPAREN = 47,                   /* TRPAREN  */
+  YYSYMBOL_TLBRACE = 48,                   /* TLBRACE  */
+  YYSYMBOL_TRBRACE = 49,                   /* TRBRACE  */
+  YYSYMBOL_TCOMMA = 50,                    /* TCOMMA  */
+  YYSYMBOL_YYACCEPT = 51,                  /* $accept  */
+  YYSYMBOL_input = 52,                     /* input  */
+  YYSYMBOL_stmtlist = 53,                  /* stmtlist  */
+  YYSYMBOL_stmtsemi = 54,                  /* stmtsemi  */
+  YYSYMBOL_stmt = 55,                      /* stmt  */
+  YYSYMBOL_56_1 = 56,                      /* $@1  */
+  YYSYMBOL_57_2 = 57,                      /* $@2  */
+  YYSYMBOL_58_3 = 58,                      /* $@3  */
+  YYSYMBOL_59_4 = 59,                      /* $@4  */
+  YYSYMBOL_60_5 = 60,                      /* $@5  */
+  YYSYMBOL_61_6 = 61,                      /* $@6  */
+  YYSYMBOL_expr = 62,                      /* expr  */
+  YYSYMBOL_funcop = 63,                    /* funcop  */
+  YYSYMBOL_libcall = 64,                   /* libcall  */
+  YYSYMBOL_65_7 = 65,                      /* $@7  */
+  YYSYMBOL_elsif_else_opt = 66,            /* elsif_else_opt  */
+  YYSYMBOL_67_8 = 67,                      /* $@8  */
+  YYSYMBOL_68_9 = 68,                      /* $@9  */
+  YYSYMBOL_69_10 = 69,                     /* $@10  */
+  YYSYMBOL_70_11 = 70,                     /* $@11  */
+  YYSYMBOL_params = 71,                    /* params  */
+  YYSYMBOL_72_12 = 72,                     /* $@12  */
+  YYSYMBOL_param_list = 73,                /* param_list  */
+  YYSYMBOL_param_local = 74,               /* param_local  */
+  YYSYMBOL_args = 75,                      /* args  */
+  YYSYMBOL_arg_list = 76,                  /* arg_list  */
+  YYSYMBOL_77_13 = 77,                     /* $@13  */
+  YYSYMBOL_item_assignment = 78,           /* item_assignment  */
+  YYSYMBOL_79_14 = 79,                     /* $@14  */
+  YYSYMBOL_complete_item = 80,             /* complete_item  */
+  YYSYMBOL_item = 81,                      /* item  */
+  YYSYMBOL_first_layer = 82,               /* first_layer  */
+  YYSYMBOL_83_15 = 83,                     /* $@15  */
+  YYSYMBOL_layer = 84,                     /* layer  */
+  YYSYMBOL_sublayer = 85,                  /* sublayer  */
+  YYSYMBOL_dereference = 86,               /* dereference  */
+  YYSYMBOL_87_16 = 87,                     /* $@16  */
+  YYSYMBOL_deref_content = 88              /* deref_content  */
+};
+typedef enum yysymbol_kind_t yysymbol_kind_t;
+
+
+
+
+#ifdef short
+# undef short
+#endif
+
+/* On compilers that do not define __PTRDIFF_MAX__ etc., make sure
+   <limits.h> and (if available) <stdint.h> are included
+   so that the code can choose integer types of a good width.  */
+
+#ifndef __PTRDIFF_MAX__
+# include <limits.h> /* INFRINGES ON USER NAME SPACE */
+# if defined __STDC_VERSION__ && 199901 <= __STDC_VERSION__
+#  include <stdint.h> /* INFRINGES ON USER NAME SPACE */
+#  define YY_STDINT_H
+# endif
+#endif
+
+/* Narrow types that promote to a signed type and that can represent a
+   signed or unsigned integer of at least N bits.  In tables they can
+   save space and decrease cache pressure.  Promoting to a signed type
+   helps avoid bugs in integer arithmetic.  */
+
+#ifdef __INT_LEAST8_MAX__
+typedef __INT_LEAST8_TYPE__ yytype_int8;
+#elif defined YY_STDINT_H
+typedef int_least8_t yytype_int8;
+#else
+typedef signed char yytype_int8;
+#endif
+
+#ifdef __INT_LEAST16_MAX__
+typedef __INT_LEAST16_TYPE__ yytype_int16;
+#elif defined YY_STDINT_H
+typedef int_least16_t yytype_int16;
+#else
+typedef short yytype_int16;
+#endif
+
+/* Work around bug in HP-UX 11.23, which defines these macros
+   incorrectly for preprocessor constants.  This workaround can likely
+   be removed in 2023, as HPE has promised support for HP-UX 11.23
+   (aka HP-UX 11i v2) only through the end of 2022; see Table 2 of
+   <https://h20195.www2.hpe.com/V2/getpdf.aspx/4AA4-7673ENW.pdf>.  */
+#ifdef __hpux
+# undef UINT_LEAST8_MAX
+# undef UINT_LEAST16_MAX
+# define UINT_LEAST8_MAX 255
+# define UINT_LEAST16_MAX 65535
+#endif
+
+#if defined __UINT_LEAST8_MAX__ && __UINT_LEAST8_MAX__ <= __INT_MAX__
+typedef __UINT_LEAST8_TYPE__ yytype_uint8;
+#elif (!defined __UINT_LEAST8_MAX__ && defined YY_STDINT_H \
+       && UINT_LEAST8_MAX <= INT_MAX)
+typedef uint_least8_t yytype_uint8;
+#elif !defined __UINT_LEAST8_MAX__ && UCHAR_MAX <= INT_MAX
+typedef unsigned char yytype_uint8;
+#else
+typedef short yytype_uint8;
+#endif
+
+#if defined __UINT_LEAST16_MAX__ && __UINT_LEAST16_MAX__ <= __INT_MAX__
+typedef __UINT_LEAST16_TYPE__ yytype_uint16;
+#elif (!defined __UINT_LEAST16_MAX__ && defined YY_STDINT_H \
+       && UINT_LEAST16_MAX <= INT_MAX)
+typedef uint_least16_t yytype_uint16;
+#elif !defined __UINT_LEAST16_MAX__ && USHRT_MAX <= INT_MAX
+typedef unsigned short yytype_uint16;
+#else
+typedef int yytype_uint16;
+#endif
+
+#ifndef YYPTRDIFF_T
+# if defined __PTRDIFF_TYPE__ && defined __PTRDIFF_MAX__
+#  define YYPTRDIFF_T __PTRDIFF_TYPE__
+#  define YYPTRDIFF_MAXIMUM __PTRDIFF_MAX__
+# elif defined PTRDIFF_MAX
+#  ifndef ptrdiff_t
+#   include <stddef.h> /* INFRINGES ON USER NAME SPACE */
+#  endif
+#  define YYPTRDIFF_T ptrdiff_t
+#  define YYPTRDIFF_MAXIMUM PTRDIFF_MAX
+# else
+#  define YYPTRDIFF_T long
+#  define YYPTRDIFF_MAXIMUM LONG_MAX
+# endif
+#endif
+
+#ifndef YYSIZE_T
+# ifdef __SIZE_TYPE__
+#  define YYSIZE_T __SIZE_TYPE__
+# elif defined size_t
+#  define YYSIZE_T size_t
+# elif defined __STDC_VERSION__ && 199901 <= __STDC_VERSION__
+#  include <stddef.h> /* INFRINGES ON USER NAME SPACE */
+#  define YYSIZE_T size_t
+# else
+#  define YYSIZE_T unsigned
+# endif
+#endif
+
+#define YYSIZE_MAXIMUM                                  \
+  YY_CAST (YYPTRDIFF_T,                                 \
+           (YYPTRDIFF_MAXIMUM < YY_CAST (YYSIZE_T, -1)  \
+            ? YYPTRDIFF_MAXIMUM                         \
+            : YY_CAST (YYSIZE_T, -1)))
+
+#define YYSIZEOF(X) YY_CAST (YYPTRDIFF_T, sizeof (X))
+
+
+/* Stored state numbers (used for stacks). */
+typedef yytype_uint8 yy_state_t;
+
+/* State numbers in computations.  */
+typedef int yy_state_fast_t;
+
+#ifndef YY_
+# if defined YYENABLE_NLS && YYENABLE_NLS
+#  if ENABLE_NLS
+#   include <libintl.h> /* INFRINGES ON USER NAME SPACE */
+#   define YY_(Msgid) dgettext ("bison-runtime", Msgid)
+#  endif
+# endif
+# ifndef YY_
+#  define YY_(Msgid) Msgid
+# endif
+#endif
+
+
+#ifndef YY_ATTRIBUTE_PURE
+# if defined __GNUC__ && 2 < __GNUC__ + (96 <= __GNUC_MINOR__)
+#  define YY_ATTRIBUTE_PURE __attribute__ ((__pure__))
+# else
+#  define YY_ATTRIBUTE_PURE
+# endif
+#endif
+
+#ifndef YY_ATTRIBUTE_UNUSED
+# if defined __GNUC__ && 2 < __GNUC__ + (7 <= __GNUC_MINOR__)
+#  define YY_ATTRIBUTE_UNUSED __attribute__ ((__unused__))
+# else
+#  define YY_ATTRIBUTE_UNUSED
+# endif
+#endif
+
+/* Suppress unused-variable warnings by "using" E.  */
+#if ! defined lint || defined __GNUC__
+# define YY_USE(E) ((void) (E))
+#else
+# define YY_USE(E) /* empty */
+#endif
+
+/* Suppress an incorrect diagnostic about yylval being uninitialized.  */
+#if defined __GNUC__ && ! defined __ICC && 406 <= __GNUC__ * 100 + __GNUC_MINOR__
+# if __GNUC__ * 100 + __GNUC_MINOR__ < 407
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")
+# else
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")              \
+    _Pragma ("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+# endif
+# define YY_IGNORE_MAYBE_UNINITIALIZED_END      \
+    _Pragma ("GCC diagnostic pop")
+#else
+# define YY_INITIAL_VALUE(Value) Value
+#endif
+#ifndef YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+# define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+# define YY_IGNORE_MAYBE_UNINITIALIZED_END
+#endif
+#ifndef YY_INITIAL_VALUE
+# define YY_INITIAL_VALUE(Value) /* Nothing. */
+#endif
+
+#if defined __cplusplus && defined __GNUC__ && ! defined __ICC && 6 <= __GNUC__
+# define YY_IGNORE_USELESS_CAST_BEGIN                          \
+    _Pragma ("GCC diagnostic push")                            \
+    _Pragma ("GCC diagnostic ignored \"-Wuseless-cast\"")
+# define YY_IGNORE_USELESS_CAST_END            \
+    _Pragma ("GCC diagnostic pop")
+#endif
+#ifndef YY_IGNORE_USELESS_CAST_BEGIN
+# define YY_IGNORE_USELESS_CAST_BEGIN
+# define YY_IGNORE_USELESS_CAST_END
+#endif
+
+
+#define YY_ASSERT(E) ((void) (0 && (E)))
+
+#if !defined yyoverflow
+
+/* The parser invokes alloca or malloc; define the necessary symbols.  */
+
+# ifdef YYSTACK_USE_ALLOCA
+#  if YYSTACK_USE_ALLOCA
+#   ifdef __GNUC__
+#    define YYSTACK_ALLOC __builtin_alloca
+#   elif defined __BUILTIN_VA_ARG_INCR
+#    include <alloca.h> /* INFRINGES ON USER NAME SPACE */
+#   elif defined _AIX
+#    define YYSTACK_ALLOC __alloca
+#   elif defined _MSC_VER
+#    include <malloc.h> /* INFRINGES ON USER NAME SPACE */
+#    define alloca _alloca
+#   else
+#    define YYSTACK_ALLOC alloca
+#    if ! defined _ALLOCA_H && ! defined EXIT_SUCCESS
+#     include <stdlib.h> /* INFRINGES ON USER NAME SPACE */
+      /* Use EXIT_SUCCESS as a witness for stdlib.h.  */
+#     ifndef EXIT_SUCCESS
+#      define EXIT_SUCCESS 0
+#     endif
+#    endif
+#   endif
+#  endif
+# endif
+
+# ifdef YYSTACK_ALLOC
+   /* Pacify GCC's 'empty if-body' warning.  */
+#  define YYSTACK_FREE(Ptr) do { /* empty */; } while (0)
+#  ifndef YYSTACK_ALLOC_MAXIMUM
+    /* The OS might guarantee only one guard page at the bottom of the stack,
+       and a page size can be as small as 4096 bytes.  So we cannot safely
+       invoke alloca (N) if N exceeds 4096.  Use a slightly smaller number
+       to allow for a few compiler-allocated temporary stack slots.  */
+#   define YYSTACK_ALLOC_MAXIMUM 4032 /* reasonable circa 2006 */
+#  endif
+# else
+#  define YYSTACK_ALLOC YYMALLOC
+#  define YYSTACK_FREE YYFREE
+#  ifndef YYSTACK_ALLOC_MAXIMUM
+#   define YYSTACK_ALLOC_MAXIMUM YYSIZE_MAXIMUM
+#  endif
+#  if (defined __cplusplus && ! defined EXIT_SUCCESS \
+       && ! ((defined YYMALLOC || defined malloc) \
+             && (defined YYFREE || defined free)))
+#   include <stdlib.h> /* INFRINGES ON USER NAME SPACE */
+#   ifndef EXIT_SUCCESS
+#    define EXIT_SUCCESS 0
+#   endif
+#  endif
+#  ifndef YYMALLOC
+#   define YYMALLOC malloc
+#   if ! defined malloc && ! defined EXIT_SUCCESS
+void *malloc (YYSIZE_T); /* INFRINGES ON USER NAME SPACE */
+#   endif
+#  endif
+#  ifndef YYFREE
+#   define YYFREE free
+#   if ! defined free && ! defined EXIT_SUCCESS
+void free (void *); /* INFRINGES ON USER NAME SPACE */
+#   endif
+#  endif
+# endif
+#endif /* !defined yyoverflow */
+
+#if (! defined yyoverflow \
+     && (! defined __cplusplus \
+         || (defined YYSTYPE_IS_TRIVIAL && YYSTYPE_IS_TRIVIAL)))
+
+/* A type that is properly aligned for any stack member.  */
+union yyalloc
+{
+  yy_state_t yyss_alloc;
+  YYSTYPE yyvs_alloc;
+};
+
+/* The size of the maximum gap between one aligned stack and the next.  */
+# define YYSTACK_GAP_MAXIMUM (YYSIZEOF (union yyalloc) - 1)
+
+/* The size of an array large to enough to hold all stacks, each with
+   N elements.  */
+# define YYSTACK_BYTES(N) \
+     ((N) * (YYSIZEOF (yy_state_t) + YYSIZEOF (YYSTYPE)) \
+      + YYSTACK_GAP_MAXIMUM)
+
+# define YYCOPY_NEEDED 1
+
+/* Relocate STACK from its old location to the new one.  The
+   local variables YYSIZE and YYSTACKSIZE give the old and new number of
+   elements in the stack, and YYPTR gives the new location of the
+   stack.  Advance YYPTR to a properly aligned location for the next
+   stack.  */
+# define YYSTACK_RELOCATE(Stack_alloc, Stack)                           \
+    do                                                                  \
+      {                                                                 \
+        YYPTRDIFF_T yynewbytes;                                         \
+        YYCOPY (&yyptr->Stack_alloc, Stack, yysize);                    \
+        Stack = &yyptr->Stack_alloc;                                    \
+        yynewbytes = yystacksize * YYSIZEOF (*Stack) + YYSTACK_GAP_MAXIMUM; \
+        yyptr += yynewbytes / YYSIZEOF (*yyptr);                        \
+      }                                                                 \
+    while (0)
+
+#endif
+
+#if defined YYCOPY_NEEDED && YYCOPY_NEEDED
+/* Copy COUNT objects from SRC to DST.  The source and destination do
+   not overlap.  */
+# ifndef YYCOPY
+#  if defined __GNUC__ && 1 < __GNUC__
+#   define YYCOPY(Dst, Src, Count) \
+      __builtin_memcpy (Dst, Src, YY_CAST (YYSIZE_T, (Count)) * sizeof (*(Src)))
+#  else
+#   define YYCOPY(Dst, Src, Count)              \
+      do                                        \
+        {                                       \
+          YYPTRDIFF_T yyi;                      \
+          for (yyi = 0; yyi < (Count); yyi++)   \
+            (Dst)[yyi] = (Src)[yyi];            \
+        }                                       \
+      while (0)
+#  endif
+# endif
+#endif /* !YYCOPY_NEEDED */
+
+/* YYFINAL -- State number of the termination state.  */
+#define YYFINAL  3
+/* YYLAST -- Last index in YYTABLE.  */
+#define YYLAST   364
+
+/* YYNTOKENS -- Number of terminals.  */
+#define YYNTOKENS  51
+/* YYNNTS -- Number of nonterminals.  */
+#define YYNNTS  38
+/* YYNRULES -- Number of rules.  */
+#define YYNRULES  83
+/* YYNSTATES -- Number of states.  */
+#define YYNSTATES  151
+
+/* YYMAXUTOK -- Last valid token kind.  */
+#define YYMAXUTOK   305
+
+
+/* YYTRANSLATE(TOKEN-NUM) -- Symbol number corresponding to TOKEN-NUM
+   as returned by yylex, with out-of-bounds checking.  */
+#define YYTRANSLATE(YYX)                                \
+  (0 <= (YYX) && (YYX) <= YYMAXUTOK                     \
+   ? YY_CAST (yysymbol_kind_t, yytranslate[YYX])        \
+   : YYSYMBOL_YYUNDEF)
+
+/* YYTRANSLATE[TOKEN-NUM] -- Symbol number corresponding to TOKEN-NUM
+   as returned by yylex.  */
+static const yytype_int8 yytranslate[] =
+{
+       0,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     1,     2,     3,     4,
+       5,     6,     7,     8,     9,    10,    11,    12,    13,    14,
+      15,    16,    17,    18,    19,    20,    21,    22,    23,    24,
+      25,    26,    27,    28,    29,    30,    31,    32,    33,    34,
+      35,    36,    37,    38,    39,    40,    41,    42,    43,    44,
+      45,    46,    47,    48,    49,    50
+};
+
+#if YYDEBUG
+/* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
+static const yytype_int16 yyrline[] =
+{
+       0,   488,   488,   491,   492,   495,   498,   503,   498,   509,
+     509,   510,   509,   512,   513,   513,   521,   522,   526,   530,
+     533,   537,   540,   543,   550,   551,   552,   553,   554,   555,
+     556,   557,   558,   559,   560,   561,   562,   563,   564,   565,
+     566,   567,   575,   577,   579,   581,   586,   590,   590,   612,
+     613,   614,   615,   613,   616,   616,   619,   620,   620,   624,
+     625,   628,   631,   632,   635,   636,   636,   639,   640,   640,
+     644,   647,   648,   651,   651,   654,   656,   659,   661,   663,
+     666,   666,   670,   674
+};
+#endif
+
+/** Accessing symbol of state STATE.  */
+#define YY_ACCESSING_SYMBOL(State) YY_CAST (yysymbol_kind_t, yystos[State])
+
+#if YYDEBUG || 0
+/* The user-facing name of the symbol whose (internal) number is
+   YYSYMBOL.  No bounds checking.  */
+static const char *yysymbol_name (yysymbol_kind_t yysymbol) YY_ATTRIBUTE_UNUSED;
+
+/* YYTNAME[SYMBOL-NUM] -- String name of the symbol SYMBOL-NUM.
+   First, the terminals, then, starting at YYNTOKENS, nonterminals.  */
+static const char *const yytname[] =
+{
+  "\"end of file\"", "error", "\"invalid token\"", "TINTEGER",
+  "TSTRINGLIT", "TLOCAL", "TLAYER", "TLIBNAME", "TCODEBODY",
+  "TUNKNOWNCHAR", "TSEMI", "TWHILE", "TDO", "TENDWHILE", "TIF", "TTHEN",
+  "TELSE", "TELSIF", "TENDIF", "TRETURN", "TASSIGN", "TEQUAL", "TNOTEQUAL",
+  "TLESSTHAN", "TGREATERTHAN", "TLTEQ", "TGTEQ", "TAND", "TOR", "TPLUS",
+  "TMINUS", "TMULT", "TDIV", "TINC", "TDEC", "TLAYERSEP", "TDEREFSTART",
+  "TCODE", "TDEREFEND", "TEXISTS", "TDELETE", "TNTHNAME", "TNEXTNAME",
+  "TROOTNAME", "UMINUS", "TNOT", "TLPAREN", "TRPAREN", "TLBRACE",
+  "TRBRACE", "TCOMMA", "$accept", "input", "stmtlist", "stmtsemi", "stmt",
+  "$@1", "$@2", "$@3", "$@4", "$@5", "$@6", "expr", "funcop", "libcall",
+  "$@7", "elsif_else_opt", "$@8", "$@9", "$@10", "$@11", "params", "$@12",
+  "param_list", "param_local", "args", "arg_list", "$@13",
+  "item_assignment", "$@14", "complete_item", "item", "first_layer",
+  "$@15", "layer", "sublayer", "dereference", "$@16", "deref_content", YY_NULLPTR
+};
+
+static const char *
+yysymbol_name (yysymbol_kind_t yysymbol)
+{
+  return yytname[yysymbol];
+}
+#endif
+
+#define YYPACT_NINF (-114)
+
+#define yypact_value_is_default(Yyn) \
+  ((Yyn) == YYPACT_NINF)
+
+#define YYTABLE_NINF (-74)
+
+#define yytable_value_is_error(Yyn) \
+  0
+
+/* YYPACT[STATE-NUM] -- Index in YYTABLE of the portion describing
+   STATE-NUM.  */
+static const yytype_int16 yypact[] =
+{
+    -114,     9,    67,  -114,  -114,  -114,   -14,   -20,  -114,  -114,
+    -114,  -114,   226,   -32,   -22,   -18,   -13,    -4,   226,   226,
+    -114,    18,   332,  -114,  -114,    23,    -6,  -114,    -5,  -114,
+    -114,  -114,    52,   226,   226,  -114,  -114,   -27,  -114,  -114,
+    -114,  -114,   226,  -114,   305,  -114,   226,   226,   226,   226,
+     226,   226,   226,   226,   226,   226,   226,   226,   209,     4,
+     226,  -114,  -114,  -114,  -114,  -114,   226,  -114,   332,   332,
+      15,    31,    19,    25,    27,   264,  -114,    -7,    -7,    -7,
+      -7,    -7,    -7,    -7,    -7,   -19,   -19,  -114,  -114,  -114,
+     332,  -114,  -114,  -114,  -114,  -114,   252,    20,    68,   332,
+      32,    70,    64,  -114,  -114,   226,    78,  -114,    36,    35,
+    -114,  -114,    31,    49,  -114,  -114,  -114,   293,    39,  -114,
+      81,   226,  -114,   164,   120,  -114,  -114,    85,  -114,  -114,
+    -114,   -12,  -114,    42,    43,  -114,  -114,    74,  -114,    85,
+    -114,   226,  -114,  -114,   181,   332,    79,  -114,   120,   -12,
+    -114
+};
+
+/* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
+   Performed when YYTABLE does not specify something else to do.  Zero
+   means the default is an error.  */
+static const yytype_int8 yydefact[] =
+{
+       3,     0,    73,     1,    21,    22,    20,     0,    41,     6,
+       9,    13,    73,     0,     0,     0,     0,     0,    73,    73,
+       4,     0,    19,    39,    40,     0,    62,    71,     0,    14,
+      17,    18,     0,    73,    73,    20,    38,    62,    73,    73,
+      73,    73,    73,    37,     0,     5,    73,    73,    73,    73,
+      73,    73,    73,    73,    73,    73,    73,    73,    73,     0,
+      73,    23,    75,    80,    74,    76,    73,    47,     7,    10,
+       0,    70,     0,     0,     0,     0,    36,    24,    25,    28,
+      30,    29,    31,    27,    26,    32,    33,    34,    35,    68,
+      67,    16,    78,    77,    72,    79,    64,     0,    73,    15,
+      62,     0,     0,    42,    43,    73,     0,    46,    56,     0,
+      63,    82,    83,     0,    48,     3,     3,     0,     0,    57,
+       0,    73,    81,    73,    11,    44,    45,     0,    69,    66,
+       8,    49,    61,     0,    59,    54,    50,     0,    58,     0,
+       3,    73,    12,    60,    73,    51,     0,     3,    52,    49,
+      53
+};
+
+/* YYPGOTO[NTERM-NUM].  */
+static const yytype_int8 yypgoto[] =
+{
+    -114,  -114,  -113,  -114,  -114,  -114,  -114,  -114,  -114,  -114,
+    -114,    -1,  -114,  -114,  -114,   -54,  -114,  -114,  -114,  -114,
+    -114,  -114,   -41,  -114,     0,   -16,  -114,  -114,  -114,    22,
+      -2,  -114,  -114,  -114,  -114,    40,  -114,  -114
+};
+
+/* YYDEFGOTO[NTERM-NUM].  */
+static const yytype_uint8 yydefgoto[] =
+{
+       0,     1,     2,    20,    21,    33,   101,    34,   102,   131,
+      66,    22,    23,    24,   100,   137,   141,   146,   149,   140,
+     120,   127,   133,   134,    61,    97,   109,    91,   108,    25,
+      37,    27,    28,    64,    94,    65,    98,   113
+};
+
+/* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
+   positive, shift that token.  If negative, reduce the rule whose
+   number is the opposite.  If YYTABLE_NINF, syntax error.  */
+static const yytype_int16 yytable[] =
+{
+      26,    62,   123,   124,   135,   136,    29,    92,    59,     3,
+      93,    36,    56,    57,   -70,    32,    38,    43,    44,    30,
+      31,    60,    54,    55,    56,    57,    39,   144,    45,    59,
+      40,    63,    68,    69,   148,    41,    71,    71,    71,    71,
+      63,    75,    60,    58,    42,    77,    78,    79,    80,    81,
+      82,    83,    84,    85,    86,    87,    88,    90,    67,    96,
+      70,    72,    73,    74,   103,    99,    59,    -2,   104,   110,
+       4,     5,     6,   111,     7,   105,     8,   106,     9,   116,
+      60,    10,   115,   118,   119,   121,    11,   122,   126,   128,
+     132,   138,   142,   139,   147,   150,   112,    12,   143,    95,
+     114,     0,     0,     0,   117,   129,    13,    14,    15,    16,
+      17,     0,    18,    19,     0,     0,     0,     0,     0,     0,
+      96,    26,    26,     4,     5,     6,   -73,     7,     0,     8,
+       0,     9,     0,     0,    10,     0,     0,     0,     0,    11,
+     145,     0,    26,     0,     0,     0,    26,     0,     0,     0,
+      12,     0,     0,     0,     0,     0,   -73,     0,     0,    13,
+      14,    15,    16,    17,     0,    18,    19,     4,     5,     6,
+       0,     7,     0,     8,     0,     9,     0,   130,    10,     0,
+       0,     0,     0,    11,     4,     5,     6,     0,     7,     0,
+       8,     0,     9,     0,    12,    10,     0,     0,     0,   -55,
+      11,     0,     0,    13,    14,    15,    16,    17,     0,    18,
+      19,    12,     4,     5,    35,     0,     7,     0,     8,     0,
+      13,    14,    15,    16,    17,     0,    18,    19,     0,     4,
+       5,    35,     0,     7,     0,     8,     0,     0,     0,    12,
+       0,     0,     0,     0,     0,     0,    89,     0,    13,    14,
+      15,    16,    17,     0,    18,    19,    12,     0,     0,     0,
+       0,     0,     0,     0,     0,    13,    14,    15,    16,    17,
+       0,    18,    19,    46,    47,    48,    49,    50,    51,    52,
+      53,    54,    55,    56,    57,    46,    47,    48,    49,    50,
+      51,    52,    53,    54,    55,    56,    57,     0,     0,     0,
+       0,     0,   -65,     0,     0,     0,     0,     0,     0,     0,
+       0,     0,     0,   107,    46,    47,    48,    49,    50,    51,
+      52,    53,    54,    55,    56,    57,    46,    47,    48,    49,
+      50,    51,    52,    53,    54,    55,    56,    57,     0,     0,
+       0,     0,   125,     0,     0,     0,     0,     0,     0,     0,
+       0,     0,    76,    46,    47,    48,    49,    50,    51,    52,
+      53,    54,    55,    56,    57
+};
+
+static const yytype_int16 yycheck[] =
+{
+       2,     6,   115,   116,    16,    17,    20,     3,    35,     0,
+       6,    12,    31,    32,    20,    35,    48,    18,    19,    33,
+      34,    48,    29,    30,    31,    32,    48,   140,    10,    35,
+      48,    36,    33,    34,   147,    48,    38,    39,    40,    41,
+      36,    42,    48,    20,    48,    46,    47,    48,    49,    50,
+      51,    52,    53,    54,    55,    56,    57,    58,     6,    60,
+      38,    39,    40,    41,    49,    66,    35,     0,    49,    49,
+       3,     4,     5,     5,     7,    50,     9,    50,    11,    15,
+      48,    14,    12,     5,    48,    50,    19,    38,    49,     8,
+       5,    49,    18,    50,    15,   149,    98,    30,   139,    59,
+     100,    -1,    -1,    -1,   105,   121,    39,    40,    41,    42,
+      43,    -1,    45,    46,    -1,    -1,    -1,    -1,    -1,    -1,
+     121,   123,   124,     3,     4,     5,     6,     7,    -1,     9,
+      -1,    11,    -1,    -1,    14,    -1,    -1,    -1,    -1,    19,
+     141,    -1,   144,    -1,    -1,    -1,   148,    -1,    -1,    -1,
+      30,    -1,    -1,    -1,    -1,    -1,    36,    -1,    -1,    39,
+      40,    41,    42,    43,    -1,    45,    46,     3,     4,     5,
+      -1,     7,    -1,     9,    -1,    11,    -1,    13,    14,    -1,
+      -1,    -1,    -1,    19,     3,     4,     5,    -1,     7,    -1,
+       9,    -1,    11,    -1,    30,    14,    -1,    -1,    -1,    18,
+      19,    -1,    -1,    39,    40,    41,    42,    43,    -1,    45,
+      46,    30,     3,     4,     5,    -1,     7,    -1,     9,    -1,
+      39,    40,    41,    42,    43,    -1,    45,    46,    -1,     3,
+       4,     5,    -1,     7,    -1,     9,    -1,    -1,    -1,    30,
+      -1,    -1,    -1,    -1,    -1,    -1,    37,    -1,    39,    40,
+      41,    42,    43,    -1,    45,    46,    30,    -1,    -1,    -1,
+      -1,    -1,    -1,    -1,    -1,    39,    40,    41,    42,    43,
+      -1,    45,    46,    21,    22,    23,    24,    25,    26,    27,
+      28,    29,    30,    31,    32,    21,    22,    23,    24,    25,
+      26,    27,    28,    29,    30,    31,    32,    -1,    -1,    -1,
+      -1,    -1,    50,    -1,    -1,    -1,    -1,    -1,    -1,    -1,
+      -1,    -1,    -1,    49,    21,    22,    23,    24,    25,    26,
+      27,    28,    29,    30,    31,    32,    21,    22,    23,    24,
+      25,    26,    27,    28,    29,    30,    31,    32,    -1,    -1,
+      -1,    -1,    49,    -1,    -1,    -1,    -1,    -1,    -1,    -1,
+      -1,    -1,    47,    21,    22,    23,    24,    25,    26,    27,
+      28,    29,    30,    31,    32
+};
+
+/* YYSTOS[STATE-NUM] -- The symbol kind of the accessing symbol of
+   state STATE-NUM.  */
+static const yytype_int8 yystos[] =
+{
+       0,    52,    53,     0,     3,     4,     5,     7,     9,    11,
+      14,    19,    30,    39,    40,    41,    42,    43,    45,    46,
+      54,    55,    62,    63,    64,    80,    81,    82,    83,    20,
+      33,    34,    35,    56,    58,     5,    62,    81,    48,    48,
+      48,    48,    48,    62,    62,    10,    21,    22,    23,    24,
+      25,    26,    27,    28,    29,    30,    31,    32,    20,    35,
+      48,    75,     6,    36,    84,    86,    61,     6,    62,    62,
+      80,    81,    80,    80,    80,    62,    47,    62,    62,    62,
+      62,    62,    62,    62,    62,    62,    62,    62,    62,    37,
+      62,    78,     3,     6,    85,    86,    62,    76,    87,    62,
+      65,    57,    59,    49,    49,    50,    50,    49,    79,    77,
+      49,     5,    81,    88,    75,    12,    15,    62,     5,    48,
+      71,    50,    38,    53,    53,    49,    49,    72,     8,    76,
+      13,    60,     5,    73,    74,    16,    17,    66,    49,    50,
+      70,    67,    18,    73,    53,    62,    68,    15,    53,    69,
+      66
+};
+
+/* YYR1[RULE-NUM] -- Symbol kind of the left-hand side of rule RULE-NUM.  */
+static const yytype_int8 yyr1[] =
+{
+       0,    51,    52,    53,    53,    54,    56,    57,    55,    58,
+      59,    60,    55,    55,    61,    55,    55,    55,    55,    55,
+      62,    62,    62,    62,    62,    62,    62,    62,    62,    62,
+      62,    62,    62,    62,    62,    62,    62,    62,    62,    62,
+      62,    62,    63,    63,    63,    63,    63,    65,    64,    66,
+      67,    68,    69,    66,    70,    66,    71,    72,    71,    73,
+      73,    74,    75,    75,    76,    77,    76,    78,    79,    78,
+      80,    81,    81,    83,    82,    84,    84,    85,    85,    85,
+      87,    86,    88,    88
+};
+
+/* YYR2[RULE-NUM] -- Number of symbols on the right-hand side of rule RULE-NUM.  */
+static const yytype_int8 yyr2[] =
+{
+       0,     2,     1,     0,     2,     2,     0,     0,     7,     0,
+       0,     0,     9,     1,     0,     4,     3,     2,     2,     1,
+       1,     1,     1,     2,     3,     3,     3,     3,     3,     3,
+       3,     3,     3,     3,     3,     3,     3,     2,     2,     1,
+       1,     1,     4,     4,     6,     6,     4,     0,     5,     0,
+       0,     0,     0,     8,     0,     3,     0,     0,     4,     1,
+       3,     1,     0,     3,     1,     0,     4,     1,     0,     4,
+       1,     1,     3,     0,     2,     1,     1,     1,     1,     1,
+       0,     4,     1,     1
+};
+
+
+enum { YYENOMEM = -2 };
+
+#define yyerrok         (yyerrstatus = 0)
+#define yyclearin       (yychar = YYEMPTY)
+
+#define YYACCEPT        goto yyacceptlab
+#define YYABORT         goto yyabortlab
+#define YYERROR         goto yyerrorlab
+#define YYNOMEM         goto yyexhaustedlab
+
+
+#define YYRECOVERING()  (!!yyerrstatus)
+
+#define YYBACKUP(Token, Value)                                    \
+  do                                                              \
+    if (yychar == YYEMPTY)                                        \
+      {                                                           \
+        yychar = (Token);                                         \
+        yylval = (Value);                                         \
+        YYPOPSTACK (yylen);                                       \
+        yystate = *yyssp;                                         \
+        goto yybackup;                                            \
+      }                                                           \
+    else                                                          \
+      {                                                           \
+        yyerror (scanner, state, YY_("syntax error: cannot back up")); \
+        YYERROR;                                                  \
+      }                                                           \
+  while (0)
+
+/* Backward compatibility with an undocumented macro.
+   Use YYerror or YYUNDEF. */
+#define YYERRCODE YYUNDEF
+
+
+/* Enable debugging if requested.  */
+#if YYDEBUG
+
+# ifndef YYFPRINTF
+#  include <stdio.h> /* INFRINGES ON USER NAME SPACE */
+#  define YYFPRINTF fprintf
+# endif
+
+# define YYDPRINTF(Args)                        \
+do {                                            \
+  if (yydebug)                                  \
+    YYFPRINTF Args;                             \
+} while (0)
+
+
+
+
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)                    \
+do {                                                                      \
+  if (yydebug)                                                            \
+    {                                                                     \
+      YYFPRINTF (stderr, "%s ", Title);                                   \
+      yy_symbol_print (stderr,                                            \
+                  Kind, Value, scanner, state); \
+      YYFPRINTF (stderr, "\n");                                           \
+    }                                                                     \
+} while (0)
+
+
+/*-----------------------------------.
+| Print this symbol's value on YYO.  |
+`-----------------------------------*/
+
+static void
+yy_symbol_value_print (FILE *yyo,
+                       yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, void *scanner, SCANNER_STATE_t *state)
+{
+  FILE *yyoutput = yyo;
+  YY_USE (yyoutput);
+  YY_USE (scanner);
+  YY_USE (state);
+  if (!yyvaluep)
+    return;
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  YY_USE (yykind);
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
+}
+
+
+/*---------------------------.
+| Print this symbol on YYO.  |
+`---------------------------*/
+
+static void
+yy_symbol_print (FILE *yyo,
+                 yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, void *scanner, SCANNER_STATE_t *state)
+{
+  YYFPRINTF (yyo, "%s %s (",
+             yykind < YYNTOKENS ? "token" : "nterm", yysymbol_name (yykind));
+
+  yy_symbol_value_print (yyo, yykind, yyvaluep, scanner, state);
+  YYFPRINTF (yyo, ")");
+}
+
+/*------------------------------------------------------------------.
+| yy_stack_print -- Print the state stack from its BOTTOM up to its |
+| TOP (included).                                                   |
+`------------------------------------------------------------------*/
+
+static void
+yy_stack_print (yy_state_t *yybottom, yy_state_t *yytop)
+{
+  YYFPRINTF (stderr, "Stack now");
+  for (; yybottom <= yytop; yybottom++)
+    {
+      int yybot = *yybottom;
+      YYFPRINTF (stderr, " %d", yybot);
+    }
+  YYFPRINTF (stderr, "\n");
+}
+
+# define YY_STACK_PRINT(Bottom, Top)                            \
+do {                                                            \
+  if (yydebug)                                                  \
+    yy_stack_print ((Bottom), (Top));                           \
+} while (0)
+
+
+/*------------------------------------------------.
+| Report that the YYRULE is going to be reduced.  |
+`------------------------------------------------*/
+
+static void
+yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp,
+                 int yyrule, void *scanner, SCANNER_STATE_t *state)
+{
+  int yylno = yyrline[yyrule];
+  int yynrhs = yyr2[yyrule];
+  int yyi;
+  YYFPRINTF (stderr, "Reducing stack by rule %d (line %d):\n",
+             yyrule - 1, yylno);
+  /* The symbols being reduced.  */
+  for (yyi = 0; yyi < yynrhs; yyi++)
+    {
+      YYFPRINTF (stderr, "   $%d = ", yyi + 1);
+      yy_symbol_print (stderr,
+                       YY_ACCESSING_SYMBOL (+yyssp[yyi + 1 - yynrhs]),
+                       &yyvsp[(yyi + 1) - (yynrhs)], scanner, state);
+      YYFPRINTF (stderr, "\n");
+    }
+}
+
+# define YY_REDUCE_PRINT(Rule)          \
+do {                                    \
+  if (yydebug)                          \
+    yy_reduce_print (yyssp, yyvsp, Rule, scanner, state); \
+} while (0)
+
+/* Nonzero means print parse trace.  It is left uninitialized so that
+   multiple parsers can coexist.  */
+int yydebug;
+#else /* !YYDEBUG */
+# define YYDPRINTF(Args) ((void) 0)
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)
+# define YY_STACK_PRINT(Bottom, Top)
+# define YY_REDUCE_PRINT(Rule)
+#endif /* !YYDEBUG */
+
+
+/* YYINITDEPTH -- initial size of the parser's stacks.  */
+#ifndef YYINITDEPTH
+# define YYINITDEPTH 200
+#endif
+
+/* YYMAXDEPTH -- maximum size the stacks can grow to (effective only
+   if the built-in stack extension method is used).
+
+   Do not make this value too large; the results are undefined if
+   YYSTACK_ALLOC_MAXIMUM < YYSTACK_BYTES (YYMAXDEPTH)
+   evaluated with infinite-precision integer arithmetic.  */
+
+#ifndef YYMAXDEPTH
+# define YYMAXDEPTH 10000
+#endif
+
+
+
+
+
+
+/*-----------------------------------------------.
+| Release the memory associated to this symbol.  |
+`-----------------------------------------------*/
+
+static void
+yydestruct (const char *yymsg,
+            yysymbol_kind_t yykind, YYSTYPE *yyvaluep, void *scanner, SCANNER_STATE_t *state)
+{
+  YY_USE (yyvaluep);
+  YY_USE (scanner);
+  YY_USE (state);
+  if (!yymsg)
+    yymsg = "Deleting";
+  YY_SYMBOL_PRINT (yymsg, yykind, yyvaluep, yylocationp);
+
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  switch (yykind)
+    {
+    case YYSYMBOL_TINTEGER: /* TINTEGER  */
+#line 484 "src/parser.y"
+            { free (((*yyvaluep).string)); }
+#line 1423 "src/parser.c"
+        break;
+
+    case YYSYMBOL_TSTRINGLIT: /* TSTRINGLIT  */
+#line 484 "src/parser.y"
+            { free (((*yyvaluep).string)); }
+#line 1429 "src/parser.c"
+        break;
+
+    case YYSYMBOL_TLOCAL: /* TLOCAL  */
+#line 484 "src/parser.y"
+            { free (((*yyvaluep).string)); }
+#line 1435 "src/parser.c"
+        break;
+
+    case YYSYMBOL_TLAYER: /* TLAYER  */
+#line 484 "src/parser.y"
+            { free (((*yyvaluep).string)); }
+#line 1441 "src/parser.c"
+        break;
+
+    case YYSYMBOL_TLIBNAME: /* TLIBNAME  */
+#line 484 "src/parser.y"
+            { free (((*yyvaluep).string)); }
+#line 1447 "src/parser.c"
+        break;
+
+    case YYSYMBOL_TCODEBODY: /* TCODEBODY  */
+#line 484 "src/parser.y"
+            { free (((*yyvaluep).string)); }
+#line 1453 "src/parser.c"
+        break;
+
+    case YYSYMBOL_TUNKNOWNCHAR: /* TUNKNOWNCHAR  */
+#line 484 "src/parser.y"
+            { free (((*yyvaluep).string)); }
+#line 1459 "src/parser.c"
+        break;
+
+      default:
+        break;
+    }
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
+}
+
+
+
+
+
+
+/*----------.
+| yyparse.  |
+`----------*/
+
+int
+yyparse (void *scanner, SCANNER_STATE_t *state)
+{
+/* Lookahead token kind.  */
+int yychar;
+
+
+/* The semantic value of the lookahead symbol.  */
+/* Default value used for initialization, for pacifying older GCCs
+   or non-GCC compilers.  */
+YY_INITIAL_VALUE (static YYSTYPE yyval_default;)
+YYSTYPE yylval YY_INITIAL_VALUE (= yyval_default);
+
+    /* Number of syntax errors so far.  */
+    int yynerrs = 0;
+
+    yy_state_fast_t yystate = 0;
+    /* Number of tokens to shift before error messages enabled.  */
+    int yyerrstatus = 0;
+
+    /* Refer to the stacks through separate pointers, to allow yyoverflow
+       to reallocate them elsewhere.  */
+
+    /* Their size.  */
+    YYPTRDIFF_T yystacksize = YYINITDEPTH;
+
+    /* The state stack: array, bottom, top.  */
+    yy_state_t yyssa[YYINITDEPTH];
+    yy_state_t *yyss = yyssa;
+    yy_state_t *yyssp = yyss;
+
+    /* The semantic value stack: array, bottom, top.  */
+    YYSTYPE yyvsa[YYINITDEPTH];
+    YYSTYPE *yyvs = yyvsa;
+    YYSTYPE *yyvsp = yyvs;
+
+  int yyn;
+  /* The return value of yyparse.  */
+  int yyresult;
+  /* Lookahead symbol kind.  */
+  yysymbol_kind_t yytoken = YYSYMBOL_YYEMPTY;
+  /* The variables used to return semantic value and location from the
+     action routines.  */
+  YYSTYPE yyval;
+
+
+
+#define YYPOPSTACK(N)   (yyvsp -= (N), yyssp -= (N))
+
+  /* The number of symbols on the RHS of the reduced rule.
+     Keep to zero when no symbol should be popped.  */
+  int yylen = 0;
+
+  YYDPRINTF ((stderr, "Starting parse\n"));
+
+  yychar = YYEMPTY; /* Cause a token to be read.  */
+
+  goto yysetstate;
+
+
+/*------------------------------------------------------------.
+| yynewstate -- push a new state, which is found in yystate.  |
+`------------------------------------------------------------*/
+yynewstate:
+  /* In all cases, when you get here, the value and location stacks
+     have just been pushed.  So pushing a state here evens the stacks.  */
+  yyssp++;
+
+
+/*--------------------------------------------------------------------.
+| yysetstate -- set current state (the top of the stack) to yystate.  |
+`--------------------------------------------------------------------*/
+yysetstate:
+  YYDPRINTF ((stderr, "Entering state %d\n", yystate));
+  YY_ASSERT (0 <= yystate && yystate < YYNSTATES);
+  YY_IGNORE_USELESS_CAST_BEGIN
+  *yyssp = YY_CAST (yy_state_t, yystate);
+  YY_IGNORE_USELESS_CAST_END
+  YY_STACK_PRINT (yyss, yyssp);
+
+  if (yyss + yystacksize - 1 <= yyssp)
+#if !defined yyoverflow && !defined YYSTACK_RELOCATE
+    YYNOMEM;
+#else
+    {
+      /* Get the current used size of the three stacks, in elements.  */
+      YYPTRDIFF_T yysize = yyssp - yyss + 1;
+
+# if defined yyoverflow
+      {
+        /* Give user a chance to reallocate the stack.  Use copies of
+           these so that the &'s don't force the real ones into
+           memory.  */
+        yy_state_t *yyss1 = yyss;
+        YYSTYPE *yyvs1 = yyvs;
+
+        /* Each stack pointer address is followed by the size of the
+           data in use in that stack, in bytes.  This used to be a
+           conditional around just the two extra args, but that might
+           be undefined if yyoverflow is a macro.  */
+        yyoverflow (YY_("memory exhausted"),
+                    &yyss1, yysize * YYSIZEOF (*yyssp),
+                    &yyvs1, yysize * YYSIZEOF (*yyvsp),
+                    &yystacksize);
+        yyss = yyss1;
+        yyvs = yyvs1;
+      }
+# else /* defined YYSTACK_RELOCATE */
+      /* Extend the stack our own way.  */
+      if (YYMAXDEPTH <= yystacksize)
+        YYNOMEM;
+      yystacksize *= 2;
+      if (YYMAXDEPTH < yystacksize)
+        yystacksize = YYMAXDEPTH;
+
+      {
+        yy_state_t *yyss1 = yyss;
+        union yyalloc *yyptr =
+          YY_CAST (union yyalloc *,
+                   YYSTACK_ALLOC (YY_CAST (YYSIZE_T, YYSTACK_BYTES (yystacksize))));
+        if (! yyptr)
+          YYNOMEM;
+        YYSTACK_RELOCATE (yyss_alloc, yyss);
+        YYSTACK_RELOCATE (yyvs_alloc, yyvs);
+#  undef YYSTACK_RELOCATE
+        if (yyss1 != yyssa)
+          YYSTACK_FREE (yyss1);
+      }
+# endif
+
+      yyssp = yyss + yysize - 1;
+      yyvsp = yyvs + yysize - 1;
+
+      YY_IGNORE_USELESS_CAST_BEGIN
+      YYDPRINTF ((stderr, "Stack size increased to %ld\n",
+                  YY_CAST (long, yystacksize)));
+      YY_IGNORE_USELESS_CAST_END
+
+      if (yyss + yystacksize - 1 <= yyssp)
+        YYABORT;
+    }
+#endif /* !defined yyoverflow && !defined YYSTACK_RELOCATE */
+
+
+  if (yystate == YYFINAL)
+    YYACCEPT;
+
+  goto yybackup;
+
+
+/*-----------.
+| yybackup.  |
+`-----------*/
+yybackup:
+  /* Do appropriate processing given the current state.  Read a
+     lookahead token if we need one and don't already have one.  */
+
+  /* First try to decide what to do without reference to lookahead token.  */
+  yyn = yypact[yystate];
+  if (yypact_value_is_default (yyn))
+    goto yydefault;
+
+  /* Not known => get a lookahead token if don't already have one.  */
+
+  /* YYCHAR is either empty, or end-of-input, or a valid lookahead.  */
+  if (yychar == YYEMPTY)
+    {
+      YYDPRINTF ((stderr, "Reading a token\n"));
+      yychar = yylex (&yylval, scanner);
+    }
+
+  if (yychar <= YYEOF)
+    {
+      yychar = YYEOF;
+      yytoken = YYSYMBOL_YYEOF;
+      YYDPRINTF ((stderr, "Now at end of input.\n"));
+    }
+  else if (yychar == YYerror)
+    {
+      /* The scanner already issued an error message, process directly
+         to error recovery.  But do not keep the error token as
+         lookahead, it is too special and may lead us to an endless
+         loop in error recovery. */
+      yychar = YYUNDEF;
+      yytoken = YYSYMBOL_YYerror;
+      goto yyerrlab1;
+    }
+  else
+    {
+      yytoken = YYTRANSLATE (yychar);
+      YY_SYMBOL_PRINT ("Next token is", yytoken, &yylval, &yylloc);
+    }
+
+  /* If the proper action on seeing token YYTOKEN is to reduce or to
+     detect an error, take that action.  */
+  yyn += yytoken;
+  if (yyn < 0 || YYLAST < yyn || yycheck[yyn] != yytoken)
+    goto yydefault;
+  yyn = yytable[yyn];
+  if (yyn <= 0)
+    {
+      if (yytable_value_is_error (yyn))
+        goto yyerrlab;
+      yyn = -yyn;
+      goto yyreduce;
+    }
+
+  /* Count tokens shifted since error; after three, turn off error
+     status.  */
+  if (yyerrstatus)
+    yyerrstatus--;
+
+  /* Shift the lookahead token.  */
+  YY_SYMBOL_PRINT ("Shifting", yytoken, &yylval, &yylloc);
+  yystate = yyn;
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  *++yyvsp = yylval;
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
+
+  /* Discard the shifted token.  */
+  yychar = YYEMPTY;
+  goto yynewstate;
+
+
+/*-----------------------------------------------------------.
+| yydefault -- do the default action for the current state.  |
+`-----------------------------------------------------------*/
+yydefault:
+  yyn = yydefact[yystate];
+  if (yyn == 0)
+    goto yyerrlab;
+  goto yyreduce;
+
+
+/*-----------------------------.
+| yyreduce -- do a reduction.  |
+`-----------------------------*/
+yyreduce:
+  /* yyn is the number of a rule to reduce with.  */
+  yylen = yyr2[yyn];
+
+  /* If YYLEN is nonzero, implement the default value of the action:
+     '$$ = $1'.
+
+     Otherwise, the following line sets YYVAL to garbage.
+     This behavior is undocumented and Bison
+     users should not rely upon it.  Assigning to YYVAL
+     unconditionally makes the parser a bit smaller, and it avoids a
+     GCC warning that YYVAL may be used uninitialized.  */
+  yyval = yyvsp[1-yylen];
+
+
+  YY_REDUCE_PRINT (yyn);
+  switch (yyn)
+    {
+  case 2: /* input: stmtlist  */
+#line 488 "src/parser.y"
+                 { emit_byte('h', state->out); }
+#line 1735 "src/parser.c"
+    break;
+
+  case 6: /* $@1: %empty  */
+#line 498 "src/parser.y"
+                                {
+                if (!prepare_loop(state)) {
+                  state->local->errnum = ERR_COMP_MAXDEPTH;
+                  YYERROR;
+                }
+                                }
+#line 1746 "src/parser.c"
+    break;
+
+  case 7: /* $@2: %empty  */
+#line 503 "src/parser.y"
+                                       {
+                emit_jump_to_end(state);
+                                }
+#line 1754 "src/parser.c"
+    break;
+
+  case 8: /* stmt: TWHILE $@1 expr $@2 TDO stmtlist TENDWHILE  */
+#line 505 "src/parser.y"
+                                                         {
+                emit_jump_to_start(state);
+                finalise_loop(state);
+                }
+#line 1763 "src/parser.c"
+    break;
+
+  case 9: /* $@3: %empty  */
+#line 509 "src/parser.y"
+              { prepare_if(state); }
+#line 1769 "src/parser.c"
+    break;
+
+  case 10: /* $@4: %empty  */
+#line 509 "src/parser.y"
+                                          { emit_jump_to_next_else(state); }
+#line 1775 "src/parser.c"
+    break;
+
+  case 11: /* $@5: %empty  */
+#line 510 "src/parser.y"
+                         { emit_jump_to_endif(state); }
+#line 1781 "src/parser.c"
+    break;
+
+  case 12: /* stmt: TIF $@3 expr $@4 TTHEN stmtlist $@5 elsif_else_opt TENDIF  */
+#line 511 "src/parser.y"
+                                { finalise_if(state); }
+#line 1787 "src/parser.c"
+    break;
+
+  case 13: /* stmt: TRETURN  */
+#line 512 "src/parser.y"
+                  { emit_byte('h', state->out); }
+#line 1793 "src/parser.c"
+    break;
+
+  case 14: /* $@6: %empty  */
+#line 513 "src/parser.y"
+                         { if (!prepare_local_assign((yyvsp[-1].string), state->out,
+                                                      state->local)) {
+                           state->local->errnum = ERR_COMP_TOOMANYLOCALS;
+                           YYERROR; }
+                                                                                                     }
+#line 1803 "src/parser.c"
+    break;
+
+  case 15: /* stmt: TLOCAL TASSIGN $@6 expr  */
+#line 517 "src/parser.y"
+                                                                                                            {
+                           emit_local_assign((yyvsp[-3].string), state->out, state->local);
+                           free((yyvsp[-3].string));
+                         }
+#line 1812 "src/parser.c"
+    break;
+
+  case 17: /* stmt: TLOCAL TINC  */
+#line 522 "src/parser.y"
+                        { bool tf = emit_local_op((yyvsp[-1].string), state->local,
+                                                          state->out, 'f');
+                          free((yyvsp[-1].string));
+                          if (!tf) YYERROR; }
+#line 1821 "src/parser.c"
+    break;
+
+  case 18: /* stmt: TLOCAL TDEC  */
+#line 526 "src/parser.y"
+                        { bool tf = emit_local_op((yyvsp[-1].string), state->local,
+                                                          state->out, 'g');
+                          free((yyvsp[-1].string));
+                          if (!tf) YYERROR; }
+#line 1830 "src/parser.c"
+    break;
+
+  case 19: /* stmt: expr  */
+#line 530 "src/parser.y"
+                                { }
+#line 1836 "src/parser.c"
+    break;
+
+  case 20: /* expr: TLOCAL  */
+#line 533 "src/parser.y"
+                        { bool tf = emit_local_op((yyvsp[0].string), state->local,
+                                                          state->out, 'e');
+                          free((yyvsp[0].string)); 
+                          if (!tf) YYERROR; }
+#line 1845 "src/parser.c"
+    break;
+
+  case 21: /* expr: TINTEGER  */
+#line 537 "src/parser.y"
+                              { emit_byte('p', state->out);
+                          emit_int64(atoi((yyvsp[0].string)), state->out);
+                          free((yyvsp[0].string)); }
+#line 1853 "src/parser.c"
+    break;
+
+  case 22: /* expr: TSTRINGLIT  */
+#line 540 "src/parser.y"
+                              { emit_byte('l', state->out);
+                          emit_string((yyvsp[0].string), state->out);
+                          free((yyvsp[0].string)); }
+#line 1861 "src/parser.c"
+    break;
+
+  case 23: /* expr: item args  */
+#line 543 "src/parser.y"
+                          { finalise_item(state);
+                      emit_byte('E', state->out);
+                      emit_byte('F', state->out);
+                      /* Use item_count + 1 below because finalise_item()
+                         decremented it. */
+                      emit_int16(state->arg_count[state->item_count + 1],
+                                                              state->out); }
+#line 1873 "src/parser.c"
+    break;
+
+  case 24: /* expr: expr TEQUAL expr  */
+#line 550 "src/parser.y"
+                                { emit_byte('o', state->out); }
+#line 1879 "src/parser.c"
+    break;
+
+  case 25: /* expr: expr TNOTEQUAL expr  */
+#line 551 "src/parser.y"
+                                { emit_byte('q', state->out); }
+#line 1885 "src/parser.c"
+    break;
+
+  case 26: /* expr: expr TOR expr  */
+#line 552 "src/parser.y"
+                                { emit_byte('z', state->out); }
+#line 1891 "src/parser.c"
+    break;
+
+  case 27: /* expr: expr TAND expr  */
+#line 553 "src/parser.y"
+                                { emit_byte('y', state->out); }
+#line 1897 "src/parser.c"
+    break;
+
+  case 28: /* expr: expr TLESSTHAN expr  */
+#line 554 "src/parser.y"
+                                { emit_byte('r', state->out); }
+#line 1903 "src/parser.c"
+    break;
+
+  case 29: /* expr: expr TLTEQ expr  */
+#line 555 "src/parser.y"
+                                { emit_byte('u', state->out); }
+#line 1909 "src/parser.c"
+    break;
+
+  case 30: /* expr: expr TGREATERTHAN expr  */
+#line 556 "src/parser.y"
+                                 { emit_byte('t', state->out); }
+#line 1915 "src/parser.c"
+    break;
+
+  case 31: /* expr: expr TGTEQ expr  */
+#line 557 "src/parser.y"
+                                { emit_byte('v', state->out); }
+#line 1921 "src/parser.c"
+    break;
+
+  case 32: /* expr: expr TPLUS expr  */
+#line 558 "src/parser.y"
+                                { emit_byte('a', state->out); }
+#line 1927 "src/parser.c"
+    break;
+
+  case 33: /* expr: expr TMINUS expr  */
+#line 559 "src/parser.y"
+                                      { emit_byte('s', state->out); }
+#line 1933 "src/parser.c"
+    break;
+
+  case 34: /* expr: expr TMULT expr  */
+#line 560 "src/parser.y"
+                                      { emit_byte('m', state->out); }
+#line 1939 "src/parser.c"
+    break;
+
+  case 35: /* expr: expr TDIV expr  */
+#line 561 "src/parser.y"
+                                      { emit_byte('d', state->out); }
+#line 1945 "src/parser.c"
+    break;
+
+  case 36: /* expr: TLPAREN expr TRPAREN  */
+#line 562 "src/parser.y"
+                                { }
+#line 1951 "src/parser.c"
+    break;
+
+  case 37: /* expr: TNOT expr  */
+#line 563 "src/parser.y"
+                                { emit_byte('x', state->out); }
+#line 1957 "src/parser.c"
+    break;
+
+  case 38: /* expr: TMINUS expr  */
+#line 564 "src/parser.y"
+                                   { emit_byte('n', state->out); }
+#line 1963 "src/parser.c"
+    break;
+
+  case 41: /* expr: TUNKNOWNCHAR  */
+#line 567 "src/parser.y"
+                                {
+                                  state->local->errnum =
+                                                      ERR_COMP_UNKNOWNCHAR;
+                                  free((yyvsp[0].string));
+                                  YYERROR;
+                                }
+#line 1974 "src/parser.c"
+    break;
+
+  case 42: /* funcop: TEXISTS TLBRACE complete_item TRBRACE  */
+#line 576 "src/parser.y"
+                                       { emit_byte('X', state->out); }
+#line 1980 "src/parser.c"
+    break;
+
+  case 43: /* funcop: TDELETE TLBRACE complete_item TRBRACE  */
+#line 578 "src/parser.y"
+                                       { emit_byte('W', state->out); }
+#line 1986 "src/parser.c"
+    break;
+
+  case 44: /* funcop: TNTHNAME TLBRACE complete_item TCOMMA expr TRBRACE  */
+#line 580 "src/parser.y"
+                                       { emit_byte('Y', state->out); }
+#line 1992 "src/parser.c"
+    break;
+
+  case 45: /* funcop: TNEXTNAME TLBRACE complete_item TCOMMA TLOCAL TRBRACE  */
+#line 582 "src/parser.y"
+                                       { bool tf = emit_local_op((yyvsp[-1].string),
+                                             state->local, state->out, 'N');
+                                         free((yyvsp[-1].string));
+                                         if (!tf) YYERROR; }
+#line 2001 "src/parser.c"
+    break;
+
+  case 46: /* funcop: TROOTNAME TLBRACE expr TRBRACE  */
+#line 586 "src/parser.y"
+                                         { emit_byte('Z', state->out); }
+#line 2007 "src/parser.c"
+    break;
+
+  case 47: /* $@7: %empty  */
+#line 590 "src/parser.y"
+                                    { prepare_item(state); }
+#line 2013 "src/parser.c"
+    break;
+
+  case 48: /* libcall: TLIBNAME TLAYERSEP TLAYER $@7 args  */
+#line 591 "src/parser.y"
+                            { uint8_t lib, call, args;
+                         uint8_t arg_count =
+                                       state->arg_count[state->item_count];
+                         if (libcall_lookup((yyvsp[-4].string), (yyvsp[-2].string), &lib, &call, &args)) {
+                           free((yyvsp[-4].string)); free((yyvsp[-2].string));
+                           if (arg_count != args) {
+                             state->local->errnum = ERR_COMP_WRONGARGS;
+                             YYERROR;
+                           }
+                           finalise_item(state);
+                           emit_byte('A', state->out);
+                           emit_byte(lib, state->out);
+                           emit_byte(call, state->out);
+                         } else {
+                           state->local->errnum =
+                                           ERR_COMP_UNKNOWNLIB;
+                           free((yyvsp[-4].string)); free((yyvsp[-2].string)); YYERROR;
+                         }
+                       }
+#line 2037 "src/parser.c"
+    break;
+
+  case 50: /* $@8: %empty  */
+#line 613 "src/parser.y"
+                 { fixup_last_else_jump(state); }
+#line 2043 "src/parser.c"
+    break;
+
+  case 51: /* $@9: %empty  */
+#line 614 "src/parser.y"
+               { emit_jump_to_next_else(state); }
+#line 2049 "src/parser.c"
+    break;
+
+  case 52: /* $@10: %empty  */
+#line 615 "src/parser.y"
+                         { emit_jump_to_endif(state); }
+#line 2055 "src/parser.c"
+    break;
+
+  case 54: /* $@11: %empty  */
+#line 616 "src/parser.y"
+                { fixup_last_else_jump(state); }
+#line 2061 "src/parser.c"
+    break;
+
+  case 57: /* $@12: %empty  */
+#line 620 "src/parser.y"
+                  { emit_byte('P', state->out); }
+#line 2067 "src/parser.c"
+    break;
+
+  case 58: /* params: TLBRACE $@12 param_list TRBRACE  */
+#line 621 "src/parser.y"
+                             { emit_int16(0, state->out); }
+#line 2073 "src/parser.c"
+    break;
+
+  case 61: /* param_local: TLOCAL  */
+#line 628 "src/parser.y"
+                    { emit_string((yyvsp[0].string), state->out); free((yyvsp[0].string)); }
+#line 2079 "src/parser.c"
+    break;
+
+  case 64: /* arg_list: expr  */
+#line 635 "src/parser.y"
+               { state->arg_count[state->item_count]++; }
+#line 2085 "src/parser.c"
+    break;
+
+  case 65: /* $@13: %empty  */
+#line 636 "src/parser.y"
+               { state->arg_count[state->item_count]++; }
+#line 2091 "src/parser.c"
+    break;
+
+  case 67: /* item_assignment: expr  */
+#line 639 "src/parser.y"
+                      { emit_byte('C', state->out); }
+#line 2097 "src/parser.c"
+    break;
+
+  case 68: /* $@14: %empty  */
+#line 640 "src/parser.y"
+                { emit_byte('B', state->out); }
+#line 2103 "src/parser.c"
+    break;
+
+  case 69: /* item_assignment: TCODE $@14 params TCODEBODY  */
+#line 641 "src/parser.y"
+                           { emit_string((yyvsp[0].string), state->out); free((yyvsp[0].string)); }
+#line 2109 "src/parser.c"
+    break;
+
+  case 70: /* complete_item: item  */
+#line 644 "src/parser.y"
+                    { finalise_item(state); emit_byte('E', state->out); }
+#line 2115 "src/parser.c"
+    break;
+
+  case 73: /* $@15: %empty  */
+#line 651 "src/parser.y"
+             { prepare_item(state); emit_byte('I', state->item_buf); }
+#line 2121 "src/parser.c"
+    break;
+
+  case 75: /* layer: TLAYER  */
+#line 654 "src/parser.y"
+               { emit_byte('L', state->item_buf);
+                 emit_layer((yyvsp[0].string), state->item_buf); free((yyvsp[0].string)); }
+#line 2128 "src/parser.c"
+    break;
+
+  case 77: /* sublayer: TLAYER  */
+#line 659 "src/parser.y"
+                 { emit_byte('L', state->item_buf);
+                   emit_layer((yyvsp[0].string), state->item_buf); free((yyvsp[0].string)); }
+#line 2135 "src/parser.c"
+    break;
+
+  case 78: /* sublayer: TINTEGER  */
+#line 661 "src/parser.y"
+                   { emit_byte('L', state->item_buf);
+                     emit_layer((yyvsp[0].string), state->item_buf); free((yyvsp[0].string)); }
+#line 2142 "src/parser.c"
+    break;
+
+  case 80: /* $@16: %empty  */
+#line 666 "src/parser.y"
+                          { emit_byte('D', state->item_buf); }
+#line 2148 "src/parser.c"
+    break;
+
+  case 82: /* deref_content: TLOCAL  */
+#line 670 "src/parser.y"
+                      { bool tf = emit_local_op((yyvsp[0].string), state->local,
+                                                    state->item_buf, 'V');
+                        free((yyvsp[0].string));
+                        if (!tf) YYERROR; }
+#line 2157 "src/parser.c"
+    break;
+
+  case 83: /* deref_content: item  */
+#line 674 "src/parser.y"
+                      { emit_byte('E', state->item_buf); }
+#line 2163 "src/parser.c"
+    break;
+
+
+#line 2167 "src/parser.c"
+
+      default: break;
+    }
+  /* User semantic actions sometimes alter yychar, and that requires
+     that yytoken be updated with the new translation.  We take the
+     approach of translating immediately before every use of yytoken.
+     One alternative is translating here after every semantic action,
+     but that translation would be missed if the semantic action invokes
+     YYABORT, YYACCEPT, or YYERROR immediately after altering yychar or
+     if it invokes YYBACKUP.  In the case of YYABORT or YYACCEPT, an
+     incorrect destructor might then be invoked immediately.  In the
+     case of YYERROR or YYBACKUP, subsequent parser actions might lead
+     to an incorrect destructor call or verbose syntax error message
+     before the lookahead is translated.  */
+  YY_SYMBOL_PRINT ("-> $$ =", YY_CAST (yysymbol_kind_t, yyr1[yyn]), &yyval, &yyloc);
+
+  YYPOPSTACK (yylen);
+  yylen = 0;
+
+  *++yyvsp = yyval;
+
+  /* Now 'shift' the result of the reduction.  Determine what state
+     that goes to, based on the state we popped back to and the rule
+     number reduced by.  */
+  {
+    const int yylhs = yyr1[yyn] - YYNTOKENS;
+    const int yyi = yypgoto[yylhs] + *yyssp;
+    yystate = (0 <= yyi && yyi <= YYLAST && yycheck[yyi] == *yyssp
+               ? yytable[yyi]
+               : yydefgoto[yylhs]);
+  }
+
+  goto yynewstate;
+
+
+/*--------------------------------------.
+| yyerrlab -- here on detecting error.  |
+`--------------------------------------*/
+yyerrlab:
+  /* Make sure we have latest lookahead translation.  See comments at
+     user semantic actions for why this is necessary.  */
+  yytoken = yychar == YYEMPTY ? YYSYMBOL_YYEMPTY : YYTRANSLATE (yychar);
+  /* If not already recovering from an error, report this error.  */
+  if (!yyerrstatus)
+    {
+      ++yynerrs;
+      yyerror (scanner, state, YY_("syntax error"));
+    }
+
+  if (yyerrstatus == 3)
+    {
+      /* If just tried and failed to reuse lookahead token after an
+         error, discard it.  */
+
+      if (yychar <= YYEOF)
+        {
+          /* Return failure if at end of input.  */
+          if (yychar == YYEOF)
+            YYABORT;
+        }
+      else
+        {
+          yydestruct ("Error: discarding",
+                      yytoken, &yylval, scanner, state);
+          yychar = YYEMPTY;
+        }
+    }
+
+  /* Else will try to reuse lookahead token after shifting the error
+     token.  */
+  goto yyerrlab1;
+
+
+/*---------------------------------------------------.
+| yyerrorlab -- error raised explicitly by YYERROR.  |
+`---------------------------------------------------*/
+yyerrorlab:
+  /* Pacify compilers when the user code never invokes YYERROR and the
+     label yyerrorlab therefore never appears in user code.  */
+  if (0)
+    YYERROR;
+  ++yynerrs;
+
+  /* Do not reclaim the symbols of the rule whose action triggered
+     this YYERROR.  */
+  YYPOPSTACK (yylen);
+  yylen = 0;
+  YY_STACK_PRINT (yyss, yyssp);
+  yystate = *yyssp;
+  goto yyerrlab1;
+
+
+/*-------------------------------------------------------------.
+| yyerrlab1 -- common code for both syntax error and YYERROR.  |
+`-------------------------------------------------------------*/
+yyerrlab1:
+  yyerrstatus = 3;      /* Each real token shifted decrements this.  */
+
+  /* Pop stack until we find a state that shifts the error token.  */
+  for (;;)
+    {
+      yyn = yypact[yystate];
+      if (!yypact_value_is_default (yyn))
+        {
+          yyn += YYSYMBOL_YYerror;
+          if (0 <= yyn && yyn <= YYLAST && yycheck[yyn] == YYSYMBOL_YYerror)
+            {
+              yyn = yytable[yyn];
+              if (0 < yyn)
+                break;
+            }
+        }
+
+      /* Pop the current state because it cannot handle the error token.  */
+      if (yyssp == yyss)
+        YYABORT;
+
+
+      yydestruct ("Error: popping",
+                  YY_ACCESSING_SYMBOL (yystate), yyvsp, scanner, state);
+      YYPOPSTACK (1);
+      yystate = *yyssp;
+      YY_STACK_PRINT (yyss, yyssp);
+    }
+
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  *++yyvsp = yylval;
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
+
+
+  /* Shift the error token.  */
+  YY_SYMBOL_PRINT ("Shifting", YY_ACCESSING_SYMBOL (yyn), yyvsp, yylsp);
+
+  yystate = yyn;
+  goto yynewstate;
+
+
+/*-------------------------------------.
+| yyacceptlab -- YYACCEPT comes here.  |
+`-------------------------------------*/
+yyacceptlab:
+  yyresult = 0;
+  goto yyreturnlab;
+
+
+/*-----------------------------------.
+| yyabortlab -- YYABORT comes here.  |
+`-----------------------------------*/
+yyabortlab:
+  yyresult = 1;
+  goto yyreturnlab;
+
+
+/*-----------------------------------------------------------.
+| yyexhaustedlab -- YYNOMEM (memory exhaustion) comes here.  |
+`-----------------------------------------------------------*/
+yyexhaustedlab:
+  yyerror (scanner, state, YY_("memory exhausted"));
+  yyresult = 2;
+  goto yyreturnlab;
+
+
+/*----------------------------------------------------------.
+| yyreturnlab -- parsing is finished, clean up and return.  |
+`----------------------------------------------------------*/
+yyreturnlab:
+  if (yychar != YYEMPTY)
+    {
+      /* Make sure we have latest lookahead translation.  See comments at
+         user semantic actions for why this is necessary.  */
+      yytoken = YYTRANSLATE (yychar);
+      yydestruct ("Cleanup: discarding lookahead",
+                  yytoken, &yylval, scanner, state);
+    }
+  /* Do not reclaim the symbols of the rule whose action triggered
+     this YYABORT or YYACCEPT.  */
+  YYPOPSTACK (yylen);
+  YY_STACK_PRINT (yyss, yyssp);
+  while (yyssp != yyss)
+    {
+      yydestruct ("Cleanup: popping",
+                  YY_ACCESSING_SYMBOL (+*yyssp), yyvsp, scanner, state);
+      YYPOPSTACK (1);
+    }
+#ifndef yyoverflow
+  if (yyss != yyssa)
+    YYSTACK_FREE (yyss);
+#endif
+
+  return yyresult;
+}
+
+#line 677 "src/parser.y"
+
+
@@ -0,0 +1,196 @@
+/* A Bison parser, made by GNU Bison 3.8.2.  */
+
+/* Bison interface for Yacc-like parsers in C
+
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+/* As a special exception, you may create a larger work that contains
+   part or all of the Bison parser skeleton and distribute that work
+   under terms of your choice, so long as that work isn't itself a
+   parser generator using the skeleton or a modified version thereof
+   as a parser skeleton.  Alternatively, if you modify or redistribute
+   the parser skeleton itself, you may (at your option) remove this
+   special exception, which will cause the skeleton and the resulting
+   Bison output files to be licensed under the GNU General Public
+   License without this special exception.
+
+   This special exception was added by the Free Software Foundation in
+   version 2.2 of Bison.  */
+
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
+#ifndef YY_YY_SRC_PARSER_H_INCLUDED
+# define YY_YY_SRC_PARSER_H_INCLUDED
+/* Debug traces.  */
+#ifndef YYDEBUG
+# define YYDEBUG 0
+#endif
+#if YYDEBUG
+extern int yydebug;
+#endif
+/* "%code requires" blocks.  */
+#line 12 "src/parser.y"
+
+  #include <stdbool.h>
+  #include <stdint.h>
+  #include <malloc.h>
+
+  /* This controls the depth of control structures
+     (loops, IF statements, etc)
+  */
+  #define MAX_NESTED_CONTROLS 32
+  #define MAX_LOCAL_VARS 256
+
+  typedef struct {
+    unsigned char *bytecode;
+    unsigned char *nextbyte;
+    uint64_t maxsize;
+  } OUTPUT_t;
+
+  typedef struct {
+    char *id[MAX_LOCAL_VARS];
+    int count;
+    int param_count;
+    int8_t errnum;
+  } LOCAL_t;
+
+  typedef struct {
+    unsigned char *loop_start;
+    unsigned char *loop_end;
+    unsigned char *jump_to_start;
+    unsigned char *jump_to_end;
+  } LOOP_FIXUP_t;
+
+  typedef struct {
+    unsigned char *addr;
+    void *next;
+  } IF_FIXUP_ADDR_t;
+
+  typedef struct {
+    unsigned char *next_else;
+    IF_FIXUP_ADDR_t *list;
+  } IF_FIXUP_t;
+
+  typedef struct {
+    OUTPUT_t *out;
+    LOCAL_t *local;
+    int8_t control_count;
+    int8_t item_count;
+    int arg_count[MAX_NESTED_CONTROLS];
+    OUTPUT_t *item_buf;
+    OUTPUT_t *item_out[MAX_NESTED_CONTROLS];
+    LOOP_FIXUP_t loop[MAX_NESTED_CONTROLS];
+    IF_FIXUP_t if_stmt[MAX_NESTED_CONTROLS];
+  } SCANNER_STATE_t;
+
+  typedef struct yy_extra_type {
+    int deref_depth;
+  } yy_extra_type;
+
+  #define YY_EXTRA_TYPE yy_extra_type
+  bool parse_source(char *source, int sourcelen, OUTPUT_t *out,
+                                                           LOCAL_t *local);
+
+#line 111 "src/parser.h"
+
+/* Token kinds.  */
+#ifndef YYTOKENTYPE
+# define YYTOKENTYPE
+  enum yytokentype
+  {
+    YYEMPTY = -2,
+    YYEOF = 0,                     /* "end of file"  */
+    YYerror = 256,                 /* error  */
+    YYUNDEF = 257,                 /* "invalid token"  */
+    TINTEGER = 258,                /* TINTEGER  */
+    TSTRINGLIT = 259,              /* TSTRINGLIT  */
+    TLOCAL = 260,                  /* TLOCAL  */
+    TLAYER = 261,                  /* TLAYER  */
+    TLIBNAME = 262,                /* TLIBNAME  */
+    TCODEBODY = 263,               /* TCODEBODY  */
+    TUNKNOWNCHAR = 264,            /* TUNKNOWNCHAR  */
+    TSEMI = 265,                   /* TSEMI  */
+    TWHILE = 266,                  /* TWHILE  */
+    TDO = 267,                     /* TDO  */
+    TENDWHILE = 268,               /* TENDWHILE  */
+    TIF = 269,                     /* TIF  */
+    TTHEN = 270,                   /* TTHEN  */
+    TELSE = 271,                   /* TELSE  */
+    TELSIF = 272,                  /* TELSIF  */
+    TENDIF = 273,                  /* TENDIF  */
+    TRETURN = 274,                 /* TRETURN  */
+    TASSIGN = 275,                 /* TASSIGN  */
+    TEQUAL = 276,                  /* TEQUAL  */
+    TNOTEQUAL = 277,               /* TNOTEQUAL  */
+    TLESSTHAN = 278,               /* TLESSTHAN  */
+    TGREATERTHAN = 279,            /* TGREATERTHAN  */
+    TLTEQ = 280,                   /* TLTEQ  */
+    TGTEQ = 281,                   /* TGTEQ  */
+    TAND = 282,                    /* TAND  */
+    TOR = 283,                     /* TOR  */
+    TPLUS = 284,                   /* TPLUS  */
+    TMINUS = 285,                  /* TMINUS  */
+    TMULT = 286,                   /* TMULT  */
+    TDIV = 287,                    /* TDIV  */
+    TINC = 288,                    /* TINC  */
+    TDEC = 289,                    /* TDEC  */
+    TLAYERSEP = 290,               /* TLAYERSEP  */
+    TDEREFSTART = 291,             /* TDEREFSTART  */
+    TCODE = 292,                   /* TCODE  */
+    TDEREFEND = 293,               /* TDEREFEND  */
+    TEXISTS = 294,                 /* TEXISTS  */
+    TDELETE = 295,                 /* TDELETE  */
+    TNTHNAME = 296,                /* TNTHNAME  */
+    TNEXTNAME = 297,               /* TNEXTNAME  */
+    TROOTNAME = 298,               /* TROOTNAME  */
+    UMINUS = 299,                  /* UMINUS  */
+    TNOT = 300,                    /* TNOT  */
+    TLPAREN = 301,                 /* TLPAREN  */
+    TRPAREN = 302,                 /* TRPAREN  */
+    TLBRACE = 303,                 /* TLBRACE  */
+    TRBRACE = 304,                 /* TRBRACE  */
+    TCOMMA = 305                   /* TCOMMA  */
+  };
+  typedef enum yytokentype yytoken_kind_t;
+#endif
+
+/* Value type.  */
+#if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
+union YYSTYPE
+{
+#line 457 "src/parser.y"
+
+  char *string;
+  int token;
+
+#line 183 "src/parser.h"
+
+};
+typedef union YYSTYPE YYSTYPE;
+# define YYSTYPE_IS_TRIVIAL 1
+# define YYSTYPE_IS_DECLARED 1
+#endif
+
+
+
+
+int yyparse (void *scanner, SCANNER_STATE_t *state);
+
+
+#endif /* !YY_YY_SRC_PARSER_H_INCLUDED  */
@@ -477,7 +477,7 @@ bool parse_source(char *source, int sourcelen, OUTPUT_t *out,
 %left TLAYERSEP
 %right TDEREFSTART TCODE
 %left TDEREFEND
-%nonassoc TEXISTS TDELETE TNTHNAME TROOTNAME
+%nonassoc TEXISTS TDELETE TNTHNAME TNEXTNAME TROOTNAME
 %right UMINUS TNOT
 %nonassoc TLPAREN TRPAREN TLBRACE TRBRACE TCOMMA
 
@@ -578,6 +578,11 @@ funcop:   TEXISTS TLBRACE complete_item TRBRACE
                                        { emit_byte('W', state->out); }
         | TNTHNAME TLBRACE complete_item TCOMMA expr TRBRACE
                                        { emit_byte('Y', state->out); }
+        | TNEXTNAME TLBRACE complete_item TCOMMA TLOCAL TRBRACE
+                                       { bool tf = emit_local_op($5,
+                                             state->local, state->out, 'N');
+                                         free($5);
+                                         if (!tf) YYERROR; }
         | TROOTNAME TLBRACE expr TRBRACE { emit_byte('Z', state->out); }
         ;
 
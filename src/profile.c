@@ -0,0 +1,374 @@
+// The profiler.  See profile.h for what it does.
+
+// Licensed under the MIT License - see LICENSE file for details.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+
+#include "config.h"
+#include "memory.h"
+#include "log.h"
+#include "item.h"
+#include "decode.h"
+#include "profile.h"
+
+// The configuration object, defined in sin.c
+extern CONFIG_t config;
+
+#define NONE UINT32_MAX
+
+// An item which has been run.
+typedef struct {
+  ITEM_t *item;
+  char name[MAX_ITEM_NAME];
+  uint64_t calls;
+  uint64_t exclusive;   // Nanoseconds in its own code
+  uint64_t inclusive;   // Nanoseconds in it and everything it called
+  uint32_t active;      // Runs of it under way, so that recursion is only
+                        // counted once in the inclusive time
+} PROFILE_ITEM_t;
+
+// A chain of calls, as a node in the tree of every chain seen.  Node 0 is
+// the root, which is not an item.
+typedef struct {
+  uint32_t item;        // Index of the item
+  uint32_t parent;      // The chain this one extends
+  uint32_t child;       // The first chain which extends this one...
+  uint32_t sibling;     // ...and the next which extends the same parent
+  uint64_t calls;
+  uint64_t time;        // Nanoseconds in the item's own code
+} PROFILE_NODE_t;
+
+// A run of an item which is under way.
+typedef struct {
+  uint32_t node;
+  uint64_t start;       // When it began
+  uint64_t children;    // Nanoseconds spent in the items it has called
+} PROFILE_FRAME_t;
+
+typedef struct {
+  uint64_t started;     // When the profiler was started
+  uint64_t elapsed;     // How long it has run for
+  PROFILE_ITEM_t *item;
+  uint32_t items;
+  uint32_t itemcapacity;
+  uint32_t *slot;       // Index of items by address: item index plus one,
+  uint32_t mask;        // or 0 if empty
+  PROFILE_NODE_t *node;
+  uint32_t nodes;
+  uint32_t nodecapacity;
+  PROFILE_FRAME_t frame[PROFILE_MAX_DEPTH];
+  uint32_t depth;
+  uv_signal_t watcher;
+} PROFILE_t;
+
+bool profiling = false;
+uint64_t profile_ops[256];
+
+static PROFILE_t profile;
+
+static const char *opname[256] = {
+  [0] = "nop", ['a'] = "add", ['c'] = "savelocal", ['d'] = "divide",
+  ['e'] = "getlocal", ['f'] = "inclocal", ['g'] = "declocal",
+  ['h'] = "halt", ['j'] = "jump", ['k'] = "jumpfalse", ['l'] = "pushstr",
+  ['m'] = "multiply", ['n'] = "negate", ['o'] = "equal", ['p'] = "pushint",
+  ['q'] = "notequal", ['r'] = "lessthan", ['s'] = "subtract",
+  ['t'] = "greaterthan", ['u'] = "lessthanorequal",
+  ['v'] = "greaterthanorequal", ['x'] = "logicalnot", ['y'] = "logicaland",
+  ['z'] = "logicalor", ['A'] = "libcall", ['B'] = "assigncodeitem",
+  ['C'] = "assignitem", ['F'] = "fetchitem", ['I'] = "assembleitem",
+  ['N'] = "nextname", ['W'] = "delete", ['X'] = "exists", ['Y'] = "nthname",
+  ['Z'] = "rootname", [OP_FETCHSTATIC] = "fetchstatic",
+  [OP_EXISTSSTATIC] = "existsstatic", [OP_NAMESTATIC] = "namestatic",
+  [OP_ASSIGNSTATIC] = "assignstatic", [OP_ADDINT] = "addint",
+  [OP_SUBTRACTINT] = "subtractint", [OP_MULTIPLYINT] = "multiplyint",
+  [OP_DIVIDEINT] = "divideint", [OP_NEGATEINT] = "negateint",
+  [OP_EQUALINT] = "equalint", [OP_NOTEQUALINT] = "notequalint",
+  [OP_LESSTHANINT] = "lessthanint", [OP_GREATERTHANINT] = "greaterthanint",
+  [OP_LESSTHANOREQUALINT] = "lessthanorequalint",
+  [OP_GREATERTHANOREQUALINT] = "greaterthanorequalint",
+  [OP_ADDLOCALINT] = "addlocalint",
+  [OP_SUBTRACTLOCALINT] = "subtractlocalint", [OP_EQUALJUMP] = "equaljump",
+  [OP_NOTEQUALJUMP] = "notequaljump", [OP_LESSTHANJUMP] = "lessthanjump",
+  [OP_GREATERTHANJUMP] = "greaterthanjump",
+  [OP_LESSTHANOREQUALJUMP] = "lessthanorequaljump",
+  [OP_GREATERTHANOREQUALJUMP] = "greaterthanorequaljump",
+};
+
+static uint64_t now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void clear_profile() {
+  FREE_ARRAY(PROFILE_ITEM_t, profile.item, profile.itemcapacity);
+  FREE_ARRAY(uint32_t, profile.slot, profile.mask ? profile.mask + 1 : 0);
+  FREE_ARRAY(PROFILE_NODE_t, profile.node, profile.nodecapacity);
+  profile.item = NULL;
+  profile.slot = NULL;
+  profile.node = NULL;
+  profile.items = profile.itemcapacity = profile.mask = 0;
+  profile.nodes = profile.nodecapacity = 0;
+  profile.elapsed = 0;
+  memset(profile_ops, 0, sizeof(profile_ops));
+}
+
+static uint32_t hash_item(ITEM_t *item) {
+  uint64_t h = (uintptr_t)item * 0x9e3779b97f4a7c15ull;
+  return h >> 32;
+}
+
+static void grow_slots() {
+  // Double the index of items, or make it in the first place.
+  FREE_ARRAY(uint32_t, profile.slot, profile.mask ? profile.mask + 1 : 0);
+  profile.mask = profile.mask ? profile.mask * 2 + 1 : 255;
+  profile.slot = GROW_ARRAY(uint32_t, NULL, 0, profile.mask + 1);
+  for (uint32_t i = 0; i < profile.items; i++) {
+    uint32_t s = hash_item(profile.item[i].item) & profile.mask;
+    while (profile.slot[s]) {
+      s = (s + 1) & profile.mask;
+    }
+    profile.slot[s] = i + 1;
+  }
+}
+
+static uint32_t find_item_index(ITEM_t *item) {
+  // Find an item among those seen, or add it if it is new.
+  if ((profile.items + 1) * 4 > profile.mask * 3) {
+    grow_slots();
+  }
+  uint32_t s = hash_item(item) & profile.mask;
+  while (profile.slot[s]) {
+    if (profile.item[profile.slot[s] - 1].item == item) {
+      return profile.slot[s] - 1;
+    }
+    s = (s + 1) & profile.mask;
+  }
+  if (profile.items == profile.itemcapacity) {
+    uint32_t oldcapacity = profile.itemcapacity;
+    profile.itemcapacity = GROW_CAPACITY(oldcapacity);
+    profile.item = GROW_ARRAY(PROFILE_ITEM_t, profile.item, oldcapacity,
+                                                      profile.itemcapacity);
+  }
+  PROFILE_ITEM_t *p = &profile.item[profile.items];
+  memset(p, 0, sizeof(PROFILE_ITEM_t));
+  p->item = item;
+  if (item->parent) {
+    get_itemname(item, p->name);
+  } else {
+    strcpy(p->name, item->name); // The boot item
+  }
+  profile.slot[s] = ++profile.items;
+  return profile.items - 1;
+}
+
+static uint32_t add_node(uint32_t parent, uint32_t item) {
+  if (profile.nodes == profile.nodecapacity) {
+    uint32_t oldcapacity = profile.nodecapacity;
+    profile.nodecapacity = GROW_CAPACITY(oldcapacity);
+    profile.node = GROW_ARRAY(PROFILE_NODE_t, profile.node, oldcapacity,
+                                                      profile.nodecapacity);
+  }
+  PROFILE_NODE_t *n = &profile.node[profile.nodes];
+  memset(n, 0, sizeof(PROFILE_NODE_t));
+  n->item = item;
+  n->parent = parent;
+  n->child = NONE;
+  n->sibling = NONE;
+  if (parent != NONE) {
+    n->sibling = profile.node[parent].child;
+    profile.node[parent].child = profile.nodes;
+  }
+  return profile.nodes++;
+}
+
+static uint32_t find_node(uint32_t parent, uint32_t item) {
+  // Find the chain of calls which extends parent with item.
+  for (uint32_t n = profile.node[parent].child; n != NONE;
+                                            n = profile.node[n].sibling) {
+    if (profile.node[n].item == item) {
+      return n;
+    }
+  }
+  return add_node(parent, item);
+}
+
+void start_profile() {
+  // Start the profiler afresh.  If it was stopped in the middle of a call,
+  // that call is still being timed, so what has been gathered is kept.
+  if (profiling) {
+    return;
+  }
+  if (profile.depth == 0) {
+    clear_profile();
+    add_node(NONE, NONE);
+  }
+  profiling = true;
+  profile.started = now();
+  logmsg("Profiler started.\n");
+}
+
+bool profile_enter(ITEM_t *item) {
+  // An item is about to be run.  Returns true if it is being timed, in
+  // which case profile_leave() must be called when it is done.
+  if (profile.depth == PROFILE_MAX_DEPTH) {
+    return false;
+  }
+  uint32_t i = find_item_index(item);
+  uint32_t parent = profile.depth ? profile.frame[profile.depth - 1].node : 0;
+  uint32_t n = find_node(parent, i);
+  profile.item[i].calls++;
+  profile.item[i].active++;
+  profile.node[n].calls++;
+  PROFILE_FRAME_t *frame = &profile.frame[profile.depth++];
+  frame->node = n;
+  frame->children = 0;
+  frame->start = now();
+  return true;
+}
+
+void profile_leave() {
+  // The item last entered has finished.
+  PROFILE_FRAME_t *frame = &profile.frame[--profile.depth];
+  uint64_t elapsed = now() - frame->start;
+  uint64_t self = elapsed - frame->children;
+  PROFILE_NODE_t *n = &profile.node[frame->node];
+  PROFILE_ITEM_t *p = &profile.item[n->item];
+  n->time += self;
+  p->exclusive += self;
+  if (--p->active == 0) {
+    p->inclusive += elapsed;
+  }
+  if (profile.depth) {
+    profile.frame[profile.depth - 1].children += elapsed;
+  }
+}
+
+void profile_unwind() {
+  // The interpreter has abandoned every call under way.  They are not
+  // counted.
+  while (profile.depth) {
+    PROFILE_FRAME_t *frame = &profile.frame[--profile.depth];
+    profile.item[profile.node[frame->node].item].active = 0;
+  }
+}
+
+static int by_exclusive(const void *a, const void *b) {
+  const PROFILE_ITEM_t *x = &profile.item[*(const uint32_t *)a];
+  const PROFILE_ITEM_t *y = &profile.item[*(const uint32_t *)b];
+  return (x->exclusive < y->exclusive) - (x->exclusive > y->exclusive);
+}
+
+static int by_count(const void *a, const void *b) {
+  uint64_t x = profile_ops[*(const uint8_t *)a];
+  uint64_t y = profile_ops[*(const uint8_t *)b];
+  return (x < y) - (x > y);
+}
+
+static void log_report() {
+  // Show the items which took longest, and the opcodes run most often.
+  logmsg("Profile of %.3f seconds:\n", profile.elapsed / 1e9);
+  logmsg("  %12s %12s %10s  %s\n", "Exclusive ms", "Inclusive ms", "Calls",
+                                                                    "Item");
+  uint32_t *order = GROW_ARRAY(uint32_t, NULL, 0, profile.items + 1);
+  for (uint32_t i = 0; i < profile.items; i++) {
+    order[i] = i;
+  }
+  qsort(order, profile.items, sizeof(uint32_t), by_exclusive);
+  for (uint32_t i = 0; i < profile.items && i < PROFILE_REPORT_LINES; i++) {
+    PROFILE_ITEM_t *p = &profile.item[order[i]];
+    logmsg("  %12.3f %12.3f %10llu  %s\n", p->exclusive / 1e6,
+              p->inclusive / 1e6, (unsigned long long)p->calls, p->name);
+  }
+  FREE_ARRAY(uint32_t, order, profile.items + 1);
+
+  uint8_t ops[256];
+  uint64_t total = 0;
+  for (int op = 0; op < 256; op++) {
+    ops[op] = op;
+    total += profile_ops[op];
+  }
+  qsort(ops, 256, 1, by_count);
+  logmsg("  %llu opcodes executed:\n", (unsigned long long)total);
+  for (int i = 0; i < PROFILE_REPORT_LINES && profile_ops[ops[i]]; i++) {
+    uint8_t op = ops[i];
+    logmsg("  %12llu %5.1f%%  %-20s (0x%02x)\n",
+              (unsigned long long)profile_ops[op],
+              100.0 * profile_ops[op] / total,
+              opname[op] ? opname[op] : "undefined", op);
+  }
+}
+
+static bool write_folded(const char *filename) {
+  // Write the time spent in every chain of calls as folded stacks.
+  FILE *file = fopen(filename, "w");
+  if (!file) {
+    logerr("Failed to open %s for writing: %s\n", filename, strerror(errno));
+    return false;
+  }
+  uint32_t chain[PROFILE_MAX_DEPTH + 1];
+  for (uint32_t n = 1; n < profile.nodes; n++) {
+    uint64_t micros = profile.node[n].time / 1000;
+    if (micros == 0) {
+      continue;
+    }
+    uint32_t len = 0;
+    for (uint32_t c = n; c != 0; c = profile.node[c].parent) {
+      chain[len++] = c;
+    }
+    while (len--) {
+      fputs(profile.item[profile.node[chain[len]].item].name, file);
+      fputc(len ? ';' : ' ', file);
+    }
+    fprintf(file, "%llu\n", (unsigned long long)micros);
+  }
+  if (fclose(file) != 0) {
+    logerr("Failed to write %s: %s\n", filename, strerror(errno));
+    return false;
+  }
+  logmsg("Profile written to %s.\n", filename);
+  return true;
+}
+
+bool stop_profile(const char *folded) {
+  // Stop the profiler, and report what it found.  If folded is given, the
+  // folded stacks are written to that file too.  Returns false if they
+  // couldn't be.
+  if (!profiling) {
+    return false;
+  }
+  profiling = false;
+  profile.elapsed += now() - profile.started;
+  log_report();
+  return !folded || write_folded(folded);
+}
+
+static void profile_signal_cb(uv_signal_t *handle, int signum) {
+  // SIGUSR2 starts the profiler, or stops it and writes the folded stacks
+  // alongside the itemstore.
+  if (!profiling) {
+    start_profile();
+  } else {
+    char filename[strlen(config.itemstore) + 8];
+    snprintf(filename, sizeof(filename), "%s.folded", config.itemstore);
+    stop_profile(filename);
+  }
+}
+
+void watch_profile_signal(uv_loop_t *loop) {
+  // The watcher alone doesn't keep the run loop going.
+  uv_signal_init(loop, &profile.watcher);
+  uv_signal_start(&profile.watcher, profile_signal_cb, SIGUSR2);
+  uv_unref((uv_handle_t *)&profile.watcher);
+}
+
+void finish_profile() {
+  // Report on a profiler left running at shutdown.
+  stop_profile(NULL);
+  clear_profile();
+}
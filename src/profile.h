@@ -0,0 +1,52 @@
+// The profiler.
+//
+// While the profiler is running, every opcode executed is counted, and
+// every run of a code item is timed, so that the report can show where
+// the time goes.  It is started and stopped by sys.profile, or by sending
+// the server SIGUSR2, and costs nothing while it is stopped.
+//
+// Each item is shown with the number of times it was run, its exclusive
+// time (spent in its own code, and in library calls) and its inclusive
+// time (including the items it called; recursive calls are only counted
+// once).  Times are also kept for every distinct chain of calls, and can
+// be written out as folded stacks, one chain to a line, for
+// flamegraph.pl and friends:
+//
+//   boot;player.look;room.describe 1234
+//
+// where the number is the exclusive time of the last item in the chain,
+// in microseconds.
+//
+// Items are known by where they are in memory, and named when they are
+// first seen, so an item which is deleted and replaced while the
+// profiler is running may be counted under its old name.
+
+// Licensed under the MIT License - see LICENSE file for details.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <uv.h>
+
+#include "item.h"
+#include "vm.h"
+
+// Calls deeper than this are not timed.  The callstack can't go deeper
+// anyway.
+#define PROFILE_MAX_DEPTH (CALLSTACK_SIZE + 2)
+// Number of items and opcodes shown in the report.
+#define PROFILE_REPORT_LINES 25
+
+// Is the profiler running?  Checked by the interpreter.
+extern bool profiling;
+// Opcodes executed, counted by the interpreter.
+extern uint64_t profile_ops[256];
+
+void start_profile();
+bool stop_profile(const char *folded);
+bool profile_enter(ITEM_t *item);
+void profile_leave();
+void profile_unwind();
+void watch_profile_signal(uv_loop_t *loop);
+void finish_profile();
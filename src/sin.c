@@ -20,6 +20,10 @@
 #include "task.h"
 #include "value.h"
 #include "item.h"
+#include "store.h"
+#include "journal.h"
+#include "profile.h"
+#include "libcall.h"
 #include "stack.h"
 #include "interpret.h"
 
@@ -42,6 +46,32 @@ void handle_sigusr1(int sig) {
   longjmp(recovery, ERR_RUNTIME_SIGUSR1);
 }
 
+ITEM_t *open_itemstore(const char *filename) {
+  // Load the itemstore, or make a new one if there isn't one, and bring it
+  // up to date from the journal.  If either of these can't be done, give
+  // up, because carrying on would save an empty itemstore over this one.
+  ITEM_t *root;
+  struct stat buffer;
+  if (stat(filename, &buffer) == 0) {
+    // The file exists, so load it.
+    logmsg("Loading itemstore from %s.\n", filename);
+    root = load_itemstore(filename, config.mapstore);
+    if (!root) {
+      exit(EXIT_FAILURE);
+    }
+  } else {
+    // The file does not exist, so create a blank itemstore
+    // and save it to the file at the end.
+    logmsg("Creating a new itemstore, which will be saved as %s.\n",
+                                                                 filename);
+    root = make_root_item("root");
+  }
+  if (config.journal && !open_journal(filename, root)) {
+    exit(EXIT_FAILURE);
+  }
+  return root;
+}
+
 void usage() {
   logmsg("Sin interpreter.\nSyntax: sin <options>\n");
   logmsg("Options:\n");
@@ -53,10 +83,16 @@ void usage() {
   logmsg("\t\t\t  If this option is not supplied, the default filename\n");
   logmsg("\t\t\t  'items.dat' is used.  The file is created if it does\n");
   logmsg("\t\t\t  not exist.\n");
+  logmsg(" -j, --journal\t\tRecord every change to the itemstore in a\n");
+  logmsg("\t\t\t  journal, so that little is lost if the server\n");
+  logmsg("\t\t\t  crashes.  Must come before -i.\n");
   logmsg(" -l, --log [file]\tLog output to <file>.\n");
   logmsg("\t\t\t  If no filename is given, the default filename, 'sin'\n");
   logmsg("\t\t\t  is used.  The filename is suffixed with .log for\n");
   logmsg("\t\t\t  stdout and .err for stderr.\n");
+  logmsg(" -m, --mmap\t\tMap the itemstore into memory instead of reading\n");
+  logmsg("\t\t\t  it.  Starts much faster with a big itemstore, but the\n");
+  logmsg("\t\t\t  checksum is not verified.  Must come before -i.\n");
   logmsg(" -n, --input <item>\tName of input-handler item.\n");
   logmsg("\t\t\t  If not supplied, this defaults to 'input'.\n");
   logmsg(" -o, --object <file>\tObject code to interpret.\n");
@@ -71,7 +107,6 @@ void usage() {
 int main(int argc, char **argv) {
   FILE *in;
   int filesize = 0, listener_port = LISTENER_PORT;
-  struct stat buffer;
   uint8_t *bytecode = NULL;
   bool bootonly = false;
 
@@ -86,9 +121,13 @@ int main(int argc, char **argv) {
   config.input = strdup("input");
   config.inputline = malloc(strlen(config.input) + 6);
   config.inputtext = malloc(strlen(config.input) + 6);
+  config.inputevent = malloc(strlen(config.input) + 7);
   sprintf(config.inputline, "%s.line", config.input);
   sprintf(config.inputtext, "%s.text", config.input);
+  sprintf(config.inputevent, "%s.event", config.input);
   config.safe_shutdown = true;
+  config.mapstore = false;
+  config.journal = false;
 
   // Do the very early preparations, for things which are needed
   // before even the options are processed.
@@ -101,6 +140,9 @@ int main(int argc, char **argv) {
     logerr("Unable to install signal handler.\n");
     exit(EXIT_FAILURE);
   }
+  // A player who vanishes mid-write shouldn't take the server with them.
+  // The write fails, and the line is closed when the read does.
+  signal(SIGPIPE, SIG_IGN);
 
   // Are there any interesting options?
   int opt;
@@ -109,14 +151,16 @@ int main(int argc, char **argv) {
     {"bootonly", no_argument, 0, 'b'},
     {"help", no_argument, 0, 'h'},
     {"itemstore", required_argument, 0, 'i'},
+    {"journal", no_argument, 0, 'j'},
     {"log", optional_argument, 0, 'l'},
+    {"mmap", no_argument, 0, 'm'},
     {"input", required_argument, 0, 'n'},
     {"object", required_argument, 0, 'o'},
     {"port", optional_argument, 0, 'p'},
     {"srcroot", required_argument, 0, 's'},
     {NULL, 0, 0, '\0'}
   };
-  while ((opt = getopt_long(argc, argv, "bhi:l::n:o:p:s:", options, NULL)) != -1) {
+  while ((opt = getopt_long(argc, argv, "bhi:jl::mn:o:p:s:", options, NULL)) != -1) {
     switch(opt) {
       case 'b':
         bootonly = true;
@@ -128,17 +172,15 @@ int main(int argc, char **argv) {
       case 'i':
         // Optional: if given use this filename for the itemstore.
         config.itemstore = strdup(optarg);
-        if (stat(config.itemstore, &buffer) == 0) {
-          // The file exists, so load it.
-          logmsg("Loading itemstore from %s.\n", config.itemstore);
-          config.itemroot = load_itemstore(config.itemstore);
-        } else {
-          // The file does not exist, so create a blank itemstore
-          // and save it to the file at the end.
-          logmsg("Creating a new itemstore, which will be saved as %s.\n",
-                                                         config.itemstore);
-          config.itemroot = make_root_item("root");
+        config.itemroot = open_itemstore(config.itemstore);
+        break;
+      case 'j':
+        // Optional: keep a journal of changes to the itemstore.
+        if (config.itemroot) {
+          logerr("If -j option is given, it must come before -i.\n");
+          exit(EXIT_FAILURE);
         }
+        config.journal = true;
         break;
       case 'l':
         // Optional: if given, log all output to file.
@@ -153,6 +195,14 @@ int main(int argc, char **argv) {
           log_to_file("sin");
         }
         break;
+      case 'm':
+        // Optional: map the itemstore rather than reading it.
+        if (config.itemroot) {
+          logerr("If -m option is given, it must come before -i.\n");
+          exit(EXIT_FAILURE);
+        }
+        config.mapstore = true;
+        break;
       case 'n':
         // Optional: name of item which handles input processing
         // Defaults to 'input' if not given.
@@ -260,14 +310,7 @@ int main(int argc, char **argv) {
   // If the itemstore hasn't been loaded, do so now.
   if (!config.itemroot) {
     config.itemstore = strdup("items.dat");
-    if (stat(config.itemstore, &buffer) == 0) {
-      logmsg("Loading itemstore from %s\n", config.itemstore);
-      config.itemroot = load_itemstore(config.itemstore);
-    } else {
-      logmsg("Creating a new itemstore, which will be saved as %s.\n",
-                                                         config.itemstore);
-      config.itemroot = make_root_item("root");
-    }
+    config.itemroot = open_itemstore(config.itemstore);
   }
   // Boot is a special item, which sits outside of the itemstore.
   // We have to abuse the API slightly here. :(
@@ -279,6 +322,8 @@ int main(int argc, char **argv) {
   // so the loop needs to be read for 'em.
   config.loop = GROW_ARRAY(uv_loop_t, config.loop, 0, sizeof(uv_loop_t));
   uv_loop_init(config.loop);
+  start_journal(config.loop);
+  watch_profile_signal(config.loop);
 
   // This is a relatively safe restart point if things turn ugly.
   // This will need to be revisited once the eventloop is running.
@@ -287,40 +332,43 @@ int main(int argc, char **argv) {
   } else {
     logerr("SIGUSR1 received.  Restarting boot item.\n");
     logerr("Destroying and recreating all stacks.\n");
+    profile_unwind();
     destroy_vm(config.vm);
     config.vm = make_vm();
   }
   // Execute the boot item.  This should set up all the tasks for
   // the main game.  It must not be an infinite loop!
   VALUE_t ret = interpret(boot);
-  if (ret.type == VALUE_int) {
-    logmsg("Bytecode interpreter returned: %ld\n", ret.i);
-  } else if (ret.type == VALUE_str) {
-    logmsg("Bytecode interpreter returned: %s\n", ret.s);
-    FREE_ARRAY(char, ret.s, strlen(ret.s));
-  } else if (ret.type == VALUE_bool) {
-    logmsg("Bytecode interpreter returned: %s\n", ret.i?"true":"false");
-  } else if (ret.type == VALUE_nil) {
+  if (IS_INT(ret)) {
+    logmsg("Bytecode interpreter returned: %ld\n", AS_INT(ret));
+  } else if (IS_STR(ret)) {
+    logmsg("Bytecode interpreter returned: %s\n", STRING_CHARS(AS_STR(ret)));
+    release_string(AS_STR(ret));
+  } else if (IS_BOOL(ret)) {
+    logmsg("Bytecode interpreter returned: %s\n", AS_BOOL(ret)?"true":"false");
+  } else if (IS_NIL(ret)) {
     logmsg("Bytecode interpreter returned nil.\n");
   } else {
-    logerr("Interpreter returned unknown value type: '%c'.\n", ret.type);
+    logerr("Interpreter returned unknown value type: '%c'.\n", VALUE_TYPE(ret));
   }
   // Finished with the boot item, and all its empty promises
   destroy_vm(config.vm);
   destroy_item(boot);
 
   int runloop_retval = 0;
-  uv_idle_t input_task;
+  uv_check_t input_task;
+  uv_prepare_t output_task;
   if (!bootonly) {
     // Set up the item which handles input.
     logmsg("Using `%s` as the input item.\n", config.input);
     config.input_vm = make_vm();
-    uv_idle_init(config.loop, &input_task);
-    uv_idle_start(&input_task, input_processor);
+    uv_check_init(config.loop, &input_task);
+    uv_check_start(&input_task, input_processor);
+    uv_prepare_init(config.loop, &output_task);
+    uv_prepare_start(&output_task, output_flusher);
     // Here we go...
     logmsg("Running...\n");
     config.maxconns = MAXCONNS;
-    config.lastconn = 255;
     init_networking();
     init_listener(listener_port);
     runloop_retval = uv_run(config.loop, UV_RUN_DEFAULT);
@@ -332,9 +380,13 @@ int main(int argc, char **argv) {
   ITEMDEBUG_LOG("ITEMDEBUG IS DEFINED\n");
   STRINGDEBUG_LOG("STRINGDEBUG IS DEFINED\n");
   DISASS_LOG("DISASS IS DEFINED\n");
+  finish_profile();
+  finish_checkpoint();
+  finish_journal();
   if (!bootonly) {
     shutdown_listener();
-    uv_idle_stop(&input_task);
+    uv_check_stop(&input_task);
+    uv_prepare_stop(&output_task);
     // Send a close request to every registered callback
     uv_walk(config.loop, close_all_tasks, NULL);
     // Process pending handles - should all be closed or closing
@@ -344,15 +396,18 @@ int main(int argc, char **argv) {
     destroy_vm(config.input_vm);
   }
   uv_loop_close(config.loop);
-  if (config.safe_shutdown) {
-    save_itemstore(config.itemstore, config.itemroot);
-  }
+  close_journal(config.safe_shutdown
+                  && save_itemstore(config.itemstore, config.itemroot));
+#ifdef DEBUG
+  log_slab_stats();
+#endif
   FREE_ARRAY(uv_loop_t, config.loop, sizeof(uv_loop_t));
   free(config.itemstore);
   free(config.srcroot);
   free(config.input);
   free(config.inputline);
   free(config.inputtext);
+  free(config.inputevent);
   destroy_item(config.itemroot);
   close_log();
   return runloop_retval;
@@ -0,0 +1,456 @@
+// sinload - a load generator for sin
+//
+// Opens a number of telnet connections to a running server, sends lines
+// of input down each of them at a steady rate, and times how long each
+// takes to be answered.  It assumes that each line sent is answered by
+// exactly one line, as the echo server in examples/ does, and that the
+// server greets each new connection with a fixed number of lines first.
+// At the end, it reports how many lines were sent and answered, and the
+// spread of the round-trip times.
+//
+// Lines are taken in turn from a script file if one is given, or are made
+// up otherwise.  With a rate of 0, each connection sends its next line
+// as soon as the last is answered, to find the most the server can do.
+
+// Licensed under the MIT License - see LICENSE file for details.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <uv.h>
+
+#include "memory.h"
+#include "log.h"
+#include "libtelnet.h"
+
+#define LOAD_PORT         4001  // As sin's LISTENER_PORT
+#define LOAD_CONNECTIONS  10
+#define LOAD_RATE         10    // Lines a second on each connection
+#define LOAD_DURATION     10    // Seconds
+#define LOAD_GREETING     2     // Lines sent by the server on connection
+#define LOAD_DRAIN        2000  // Milliseconds to wait for late answers
+#define LOAD_TICK         1     // Milliseconds between sends
+#define LOAD_LINE_LENGTH  1024
+
+typedef struct {
+  uv_tcp_t handle;
+  uv_connect_t connect;
+  telnet_t *telnet;
+  int id;
+  bool connected;
+  bool ready;               // Has the greeting been received?
+  uint32_t greeting;        // Lines of greeting still to come
+  char line[LOAD_LINE_LENGTH]; // The line being received
+  size_t linelen;
+  uint64_t *sent;           // When each unanswered line was sent
+  uint32_t head;            // The oldest...
+  uint32_t tail;            // ...and where the next goes
+  uint32_t capacity;        // (a power of two)
+  uint64_t sentcount;
+  uint64_t received;
+} CONN_t;
+
+typedef struct {
+  uv_write_t req;
+  uv_buf_t buf;
+} WRITE_t;
+
+static const telnet_telopt_t telopts[] = {
+  { -1, 0, 0 }
+};
+
+static uv_loop_t *loop;
+static uv_timer_t ticker;
+static CONN_t *conn;
+static int connections = LOAD_CONNECTIONS;
+static int rate = LOAD_RATE;
+static int duration = LOAD_DURATION;
+static uint32_t greeting = LOAD_GREETING;
+static char **script;
+static int scriptlines;
+static uint64_t started;    // When every connection was ready
+static uint64_t stopping;   // When sending stopped
+static int ready;
+
+// Round-trip times, in nanoseconds.
+static uint64_t *latency;
+static size_t latencies;
+static size_t latencycapacity;
+
+static void close_all() {
+  static bool closing = false;
+  if (closing) {
+    return;
+  }
+  closing = true;
+  uv_timer_stop(&ticker);
+  uv_close((uv_handle_t *)&ticker, NULL);
+  for (int c = 0; c < connections; c++) {
+    if (!uv_is_closing((uv_handle_t *)&conn[c].handle)) {
+      uv_close((uv_handle_t *)&conn[c].handle, NULL);
+    }
+  }
+}
+
+static void on_write(uv_write_t *req, int status) {
+  WRITE_t *w = (WRITE_t *)req;
+  free(w->buf.base);
+  free(w);
+}
+
+static void telnet_handler(telnet_t *telnet, telnet_event_t *ev,
+                                                          void *user_data);
+
+static void record(CONN_t *c, uint64_t when) {
+  // A line has been answered.
+  if (c->head == c->tail) {
+    logerr("Connection %d: unexpected line from the server.\n", c->id);
+    return;
+  }
+  uint64_t sent = c->sent[c->head];
+  c->head = (c->head + 1) & (c->capacity - 1);
+  c->received++;
+  if (latencies == latencycapacity) {
+    size_t oldcapacity = latencycapacity;
+    latencycapacity = GROW_CAPACITY(oldcapacity);
+    latency = GROW_ARRAY(uint64_t, latency, oldcapacity, latencycapacity);
+  }
+  latency[latencies++] = when - sent;
+}
+
+static void send_line(CONN_t *c) {
+  char text[LOAD_LINE_LENGTH];
+  int len;
+  if (scriptlines) {
+    len = snprintf(text, sizeof(text), "%s\n",
+                                  script[c->sentcount % scriptlines]);
+  } else {
+    len = snprintf(text, sizeof(text), "sinload %d %llu\n", c->id,
+                                            (unsigned long long)c->sentcount);
+  }
+  if (((c->tail + 1) & (c->capacity - 1)) == c->head) {
+    // Full, so double it, unwrapping it as it goes.
+    uint32_t oldcapacity = c->capacity;
+    uint64_t *sent = GROW_ARRAY(uint64_t, NULL, 0, oldcapacity * 2);
+    uint32_t n = 0;
+    for (uint32_t i = c->head; i != c->tail; i = (i + 1) & (oldcapacity - 1)) {
+      sent[n++] = c->sent[i];
+    }
+    FREE_ARRAY(uint64_t, c->sent, oldcapacity);
+    c->sent = sent;
+    c->capacity = oldcapacity * 2;
+    c->head = 0;
+    c->tail = n;
+  }
+  c->sent[c->tail] = uv_hrtime();
+  c->tail = (c->tail + 1) & (c->capacity - 1);
+  c->sentcount++;
+  telnet_send_text(c->telnet, text, len);
+}
+
+static void got_line(CONN_t *c) {
+  // A whole line has arrived from the server.
+  if (!c->ready) {
+    if (--c->greeting == 0) {
+      c->ready = true;
+      if (++ready == connections) {
+        started = uv_hrtime();
+        logmsg("All %d connections ready.\n", connections);
+      }
+    }
+    return;
+  }
+  record(c, uv_hrtime());
+  if (rate == 0 && !stopping) {
+    send_line(c);
+  }
+}
+
+static void telnet_handler(telnet_t *telnet, telnet_event_t *ev,
+                                                          void *user_data) {
+  CONN_t *c = user_data;
+  switch (ev->type) {
+    case TELNET_EV_DATA:
+      for (size_t i = 0; i < ev->data.size; i++) {
+        char ch = ev->data.buffer[i];
+        if (ch == '\n') {
+          c->line[c->linelen] = '\0';
+          c->linelen = 0;
+          got_line(c);
+        } else if (ch != '\r' && c->linelen < LOAD_LINE_LENGTH - 1) {
+          c->line[c->linelen++] = ch;
+        }
+      }
+      break;
+    case TELNET_EV_SEND: {
+      WRITE_t *w = malloc(sizeof(WRITE_t));
+      w->buf = uv_buf_init(malloc(ev->data.size), ev->data.size);
+      memcpy(w->buf.base, ev->data.buffer, ev->data.size);
+      uv_write(&w->req, (uv_stream_t *)&c->handle, &w->buf, 1, on_write);
+      break;
+    }
+    case TELNET_EV_ERROR:
+      logerr("Connection %d: telnet error: %s\n", c->id, ev->error.msg);
+      break;
+    default:
+      break;
+  }
+}
+
+static void alloc_buffer(uv_handle_t *handle, size_t suggested_size,
+                                                              uv_buf_t *buf) {
+  buf->base = malloc(suggested_size);
+  buf->len = suggested_size;
+}
+
+static void on_read(uv_stream_t *stream, ssize_t nread, const uv_buf_t *buf) {
+  CONN_t *c = stream->data;
+  if (nread > 0) {
+    telnet_recv(c->telnet, buf->base, nread);
+  } else if (nread < 0) {
+    if (!stopping) {
+      logerr("Connection %d: %s\n", c->id, uv_strerror(nread));
+    }
+    c->connected = false;
+    if (ready < connections) {
+      // It will never be ready, so there is no test to run.
+      close_all();
+    } else if (!uv_is_closing((uv_handle_t *)stream)) {
+      uv_close((uv_handle_t *)stream, NULL);
+    }
+  }
+  free(buf->base);
+}
+
+static void on_connect(uv_connect_t *req, int status) {
+  CONN_t *c = req->data;
+  if (status < 0) {
+    logerr("Connection %d failed: %s\n", c->id, uv_strerror(status));
+    close_all();
+    return;
+  }
+  c->connected = true;
+  uv_tcp_nodelay(&c->handle, 1);
+  uv_read_start((uv_stream_t *)&c->handle, alloc_buffer, on_read);
+}
+
+static void tick(uv_timer_t *handle) {
+  // Keep every connection sending at the rate asked for.  Once the time
+  // is up, wait a little while for the last answers, and then stop.
+  if (ready < connections) {
+    return;
+  }
+  uint64_t now = uv_hrtime();
+  if (!stopping && now - started >= (uint64_t)duration * 1000000000) {
+    stopping = now;
+  }
+  if (stopping) {
+    bool waiting = false;
+    for (int c = 0; c < connections; c++) {
+      waiting = waiting || (conn[c].connected && conn[c].head != conn[c].tail);
+    }
+    if (!waiting || now - stopping >= (uint64_t)LOAD_DRAIN * 1000000) {
+      close_all();
+    }
+    return;
+  }
+  for (int c = 0; c < connections; c++) {
+    if (!conn[c].connected) {
+      continue;
+    }
+    if (rate == 0) {
+      if (conn[c].sentcount == 0) {
+        send_line(&conn[c]);
+      }
+      continue;
+    }
+    uint64_t due = (now - started) * rate / 1000000000 + 1;
+    while (conn[c].sentcount < due) {
+      send_line(&conn[c]);
+    }
+  }
+}
+
+static int by_value(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a;
+  uint64_t y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+static double percentile(double p) {
+  size_t i = (size_t)(p / 100.0 * (latencies - 1) + 0.5);
+  return latency[i] / 1e6;
+}
+
+static void report() {
+  uint64_t sent = 0, received = 0;
+  for (int c = 0; c < connections; c++) {
+    sent += conn[c].sentcount;
+    received += conn[c].received;
+  }
+  double seconds = (stopping ? stopping - started : 0) / 1e9;
+  logmsg("Connections: %d\n", connections);
+  logmsg("Duration:    %.2f s\n", seconds);
+  logmsg("Sent:        %llu lines\n", (unsigned long long)sent);
+  logmsg("Answered:    %llu lines (%llu lost)\n",
+            (unsigned long long)received, (unsigned long long)(sent - received));
+  if (seconds > 0) {
+    logmsg("Throughput:  %.1f lines/s\n", received / seconds);
+  }
+  if (latencies) {
+    qsort(latency, latencies, sizeof(uint64_t), by_value);
+    logmsg("Latency ms:  min %.3f  p50 %.3f  p90 %.3f  p99 %.3f  "
+           "p99.9 %.3f  max %.3f\n", latency[0] / 1e6, percentile(50),
+           percentile(90), percentile(99), percentile(99.9),
+           latency[latencies - 1] / 1e6);
+  }
+}
+
+static bool load_script(const char *filename) {
+  // Read the lines to be sent.  Blank lines are skipped.
+  FILE *file = fopen(filename, "r");
+  if (!file) {
+    logerr("Unable to open script file: %s\n", filename);
+    return false;
+  }
+  char text[LOAD_LINE_LENGTH];
+  int capacity = 0;
+  while (fgets(text, sizeof(text), file)) {
+    text[strcspn(text, "\r\n")] = '\0';
+    if (!text[0]) {
+      continue;
+    }
+    if (scriptlines == capacity) {
+      int oldcapacity = capacity;
+      capacity = GROW_CAPACITY(oldcapacity);
+      script = GROW_ARRAY(char *, script, oldcapacity, capacity);
+    }
+    script[scriptlines++] = strdup(text);
+  }
+  fclose(file);
+  if (!scriptlines) {
+    logerr("Script file %s has nothing in it.\n", filename);
+    return false;
+  }
+  return true;
+}
+
+static void usage() {
+  logmsg("Sinistra load generator.\nSyntax: sinload <options>\n");
+  logmsg("Options:\n");
+  logmsg(" -a, --address <addr>\tAddress of the server (default 127.0.0.1).\n");
+  logmsg(" -c, --connections <n>\tConnections to open (default %d).\n",
+                                                        LOAD_CONNECTIONS);
+  logmsg(" -d, --duration <s>\tSeconds to send for (default %d).\n",
+                                                           LOAD_DURATION);
+  logmsg(" -g, --greeting <n>\tLines the server sends on connection "
+                                            "(default %d).\n", LOAD_GREETING);
+  logmsg(" -h, --help\t\tThis message.\n");
+  logmsg(" -p, --port <port>\tPort of the server (default %d).\n", LOAD_PORT);
+  logmsg(" -r, --rate <n>\t\tLines a second on each connection, or 0 to "
+                            "send each as the last is answered (default %d).\n",
+                                                                LOAD_RATE);
+  logmsg(" -s, --script <file>\tLines to send, in turn.\n");
+}
+
+int main(int argc, char **argv) {
+  const char *address = "127.0.0.1";
+  int port = LOAD_PORT;
+  int opt;
+  const struct option options[] =
+  {
+    {"address", required_argument, 0, 'a'},
+    {"connections", required_argument, 0, 'c'},
+    {"duration", required_argument, 0, 'd'},
+    {"greeting", required_argument, 0, 'g'},
+    {"help", no_argument, 0, 'h'},
+    {"port", required_argument, 0, 'p'},
+    {"rate", required_argument, 0, 'r'},
+    {"script", required_argument, 0, 's'},
+    {NULL, 0, 0, '\0'}
+  };
+  while ((opt = getopt_long(argc, argv, "a:c:d:g:hp:r:s:", options, NULL))
+                                                                    != -1) {
+    switch(opt) {
+      case 'a':
+        address = optarg;
+        break;
+      case 'c':
+        connections = atoi(optarg);
+        break;
+      case 'd':
+        duration = atoi(optarg);
+        break;
+      case 'g':
+        greeting = atoi(optarg);
+        break;
+      case 'h':
+        usage();
+        exit(EXIT_SUCCESS);
+        break;
+      case 'p':
+        port = atoi(optarg);
+        break;
+      case 'r':
+        rate = atoi(optarg);
+        break;
+      case 's':
+        if (!load_script(optarg)) {
+          exit(EXIT_FAILURE);
+        }
+        break;
+      default:
+        usage();
+        return EXIT_FAILURE;
+    }
+  }
+  if (connections < 1 || duration < 1 || rate < 0) {
+    usage();
+    return EXIT_FAILURE;
+  }
+
+  struct sockaddr_storage addr;
+  if (uv_ip4_addr(address, port, (struct sockaddr_in *)&addr) != 0
+        && uv_ip6_addr(address, port, (struct sockaddr_in6 *)&addr) != 0) {
+    logerr("Invalid address: %s\n", address);
+    return EXIT_FAILURE;
+  }
+
+  loop = uv_default_loop();
+  conn = GROW_ARRAY(CONN_t, NULL, 0, connections);
+  for (int c = 0; c < connections; c++) {
+    conn[c].id = c;
+    conn[c].greeting = greeting;
+    conn[c].ready = (greeting == 0);
+    conn[c].capacity = 16;
+    conn[c].sent = GROW_ARRAY(uint64_t, NULL, 0, conn[c].capacity);
+    conn[c].telnet = telnet_init(telopts, telnet_handler, 0, &conn[c]);
+    uv_tcp_init(loop, &conn[c].handle);
+    conn[c].handle.data = &conn[c];
+    conn[c].connect.data = &conn[c];
+    uv_tcp_connect(&conn[c].connect, &conn[c].handle,
+                                  (const struct sockaddr *)&addr, on_connect);
+  }
+  if (greeting == 0) {
+    ready = connections;
+    started = uv_hrtime();
+  }
+  uv_timer_init(loop, &ticker);
+  uv_timer_start(&ticker, tick, LOAD_TICK, LOAD_TICK);
+  logmsg("Connecting %d lines to %s port %d.\n", connections, address, port);
+  uv_run(loop, UV_RUN_DEFAULT);
+
+  report();
+  for (int c = 0; c < connections; c++) {
+    telnet_free(conn[c].telnet);
+    FREE_ARRAY(uint64_t, conn[c].sent, conn[c].capacity);
+  }
+  FREE_ARRAY(CONN_t, conn, connections);
+  FREE_ARRAY(uint64_t, latency, latencycapacity);
+  for (int l = 0; l < scriptlines; l++) {
+    free(script[l]);
+  }
+  uv_loop_close(loop);
+  return EXIT_SUCCESS;
+}
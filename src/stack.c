@@ -32,10 +32,11 @@ void reset_stack(STACK_t *stack) {
   // Note that this includes any local variables!
   // Really simple!
   for (int v = 0; v < (stack->current + stack->locals); v++) {
-    if (stack->stack[v].type == VALUE_str) {
-      STRINGDEBUG_LOG("Freeing string: %s\n", stack->stack[v].s);
-      FREE_ARRAY(char, stack->stack[v].s,
-                                    strlen(stack->stack[v].s) + 1);
+    if (IS_STR(stack->stack[v])) {
+      STRINGDEBUG_LOG("Releasing string of length %u\n",
+                                              AS_STR(stack->stack[v])->len);
+      release_string(AS_STR(stack->stack[v]));
+      stack->stack[v] = VALUE_NIL;
     }
   }
   stack->current = -1;
@@ -44,6 +45,10 @@ void reset_stack(STACK_t *stack) {
 void reset_stack_to(STACK_t *stack, int32_t top) {
   // Like reset_stack, but only throw away values above 'top'
   while (stack->current > top) {
+    if (IS_STR(stack->stack[stack->current])) {
+      release_string(AS_STR(stack->stack[stack->current]));
+      stack->stack[stack->current] = VALUE_NIL;
+    }
     stack->current--;
   }
 }
@@ -63,11 +68,11 @@ void push_stack(STACK_t *stack, VALUE_t obj) {
 VALUE_t pop_stack(STACK_t *stack) {
   // Given a stack, return the value on top.
   // and decrement the stack pointer.
-  // Set the type on the stack to nil, to prevent inadvertent
+  // Set the value on the stack to nil, to prevent inadvertent
   // freeing of strings which may be in use elsewhere.
   if (stack->current >= 0) {
     VALUE_t val = stack->stack[stack->current];
-    stack->stack[stack->current].type = VALUE_nil;
+    stack->stack[stack->current] = VALUE_NIL;
     stack->current--;
     return val;
   }
@@ -79,14 +84,13 @@ VALUE_t pop_stack(STACK_t *stack) {
 void throwaway_stack(STACK_t *stack) {
   // Given a stack, lose the value on top.
   // and decrement the stack pointer.
-  // Set the type on the stack to nil, to prevent inadvertent
+  // Set the value on the stack to nil, to prevent inadvertent
   // freeing of strings which may be in use elsewhere.
   if (stack->current >= 0) {
-    if (stack->stack[stack->current].type == VALUE_str) {
-      FREE_ARRAY(char, stack->stack[stack->current].s,
-                                   strlen(stack->stack[stack->current].s));
+    if (IS_STR(stack->stack[stack->current])) {
+      release_string(AS_STR(stack->stack[stack->current]));
     }
-    stack->stack[stack->current].type = VALUE_nil;
+    stack->stack[stack->current] = VALUE_NIL;
     stack->current--;
   }
   logerr("Stack cleared.\n");
@@ -0,0 +1,1045 @@
+// Saving and loading the itemstore.  See store.h for the format.
+
+// Licensed under the MIT License - see LICENSE file for details.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <dirent.h>
+#include <pthread.h>
+
+#include "memory.h"
+#include "log.h"
+#include "item.h"
+#include "network.h"
+#include "store.h"
+
+// Everything after the header goes through one of these, so that the
+// itemstore is written and read in big pieces, and checksummed on the way.
+// When reading a mapped itemstore, the whole mapping is the buffer.
+typedef struct {
+  FILE *file;         // NULL if the itemstore is mapped
+  uint8_t *buf;
+  size_t len;         // Bytes in the buffer
+  size_t pos;         // Reading: bytes of the buffer already used
+  uint64_t offset;    // Reading: bytes of the file already used
+  uint64_t size;      // Reading: size of the file
+  uint8_t version;    // Reading: format version of the file
+  uint32_t crc;       // CRC-32 so far
+  bool failed;
+} STREAM_t;
+
+static uint32_t crc_table[256];
+
+uint32_t store_crc32(uint32_t crc, const void *buf, size_t len) {
+  // The usual CRC-32, as used by zip and friends.
+  const uint8_t *data = buf;
+  if (!crc_table[1]) {
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; k++) {
+        c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+      }
+      crc_table[n] = c;
+    }
+  }
+  crc = ~crc;
+  while (len--) {
+    crc = crc_table[(crc ^ *data++) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+static void flush_stream(STREAM_t *out) {
+  if (out->len && !out->failed
+              && fwrite(out->buf, 1, out->len, out->file) != out->len) {
+    out->failed = true;
+  }
+  out->len = 0;
+}
+
+static void put_raw(STREAM_t *out, const void *data, size_t len) {
+  // Add bytes to the stream without checksumming them.
+  if (out->len + len > STORE_BUFFER_SIZE) {
+    flush_stream(out);
+    if (len > STORE_BUFFER_SIZE) {
+      // Too big to be worth copying into the buffer.
+      if (!out->failed && fwrite(data, 1, len, out->file) != len) {
+        out->failed = true;
+      }
+      return;
+    }
+  }
+  memcpy(out->buf + out->len, data, len);
+  out->len += len;
+}
+
+static void put_bytes(STREAM_t *out, const void *data, size_t len) {
+  out->crc = store_crc32(out->crc, data, len);
+  put_raw(out, data, len);
+}
+
+static void put_varint(STREAM_t *out, uint64_t v) {
+  // Seven bits at a time, least significant first.  The top bit of each
+  // byte is set if there are more to come.
+  uint8_t bytes[10];
+  int n = 0;
+  while (v >= 0x80) {
+    bytes[n++] = (v & 0x7f) | 0x80;
+    v >>= 7;
+  }
+  bytes[n++] = v;
+  put_bytes(out, bytes, n);
+}
+
+static void put_signed(STREAM_t *out, int64_t v) {
+  // Zigzag encoding, so that small negative numbers are small too.
+  put_varint(out, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static void write_value(STREAM_t *out, ITEM_t *item) {
+  // Write an item's name and contents.
+  size_t namelen = strlen(item->name);
+  put_varint(out, namelen);
+  put_bytes(out, item->name, namelen);
+  uint8_t tag;
+  if (item->type == ITEM_code) {
+    tag = STORE_code;
+    put_bytes(out, &tag, 1);
+    put_varint(out, item->bytecode_len);
+    put_bytes(out, item->bytecode, item->bytecode_len);
+  } else {
+    switch (VALUE_TYPE(item->value)) {
+      case VALUE_str: {
+        STRING_t *str = AS_STR(item->value);
+        tag = STORE_str;
+        put_bytes(out, &tag, 1);
+        put_varint(out, str->len);
+        put_bytes(out, STRING_CHARS(str), str->len + 1);
+        break;
+      }
+      case VALUE_int:
+        tag = STORE_int;
+        put_bytes(out, &tag, 1);
+        put_signed(out, AS_INT(item->value));
+        break;
+      case VALUE_bool:
+        tag = STORE_bool;
+        put_bytes(out, &tag, 1);
+        put_signed(out, AS_BOOL(item->value));
+        break;
+      default:
+        tag = STORE_nil;
+        put_bytes(out, &tag, 1);
+        break;
+    }
+  }
+}
+
+static void write_item(STREAM_t *out, ITEM_t *item, uint64_t *count) {
+  // Write an item, and then all of its children.
+  write_value(out, item);
+  (*count)++;
+  uint32_t numchildren = item->children ? item->children->count : 0;
+  put_varint(out, numchildren);
+  for (uint32_t i = 0; numchildren && i < item->children->used; i++) {
+    if (item->children->child[i]) {
+      write_item(out, item->children->child[i], count);
+    }
+  }
+}
+
+// Segments are saved and loaded by a pool of threads, each of which takes
+// the next piece of work until there is none left.  The calling thread
+// works too.
+typedef struct Pool POOL_t;
+struct Pool {
+  uint32_t count;       // Pieces of work to be done
+  uint32_t next;        // The next to be taken
+  bool failed;          // Once a piece has failed, no more are taken
+  bool (*work)(POOL_t *pool, uint32_t i);
+  void *data;
+  pthread_mutex_t lock;
+};
+
+// Each thread builds items from its own slabs, which are handed over when
+// it has finished.
+typedef struct {
+  POOL_t *pool;
+  pthread_t thread;
+  SLAB_t slabs[SLAB_CLASSES];
+} WORKER_t;
+
+static bool take_work(POOL_t *pool, uint32_t *i) {
+  pthread_mutex_lock(&pool->lock);
+  bool more = !pool->failed && pool->next < pool->count;
+  if (more) {
+    *i = pool->next++;
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return more;
+}
+
+static void do_work(POOL_t *pool) {
+  uint32_t i;
+  while (take_work(pool, &i)) {
+    if (!pool->work(pool, i)) {
+      pthread_mutex_lock(&pool->lock);
+      pool->failed = true;
+      pthread_mutex_unlock(&pool->lock);
+    }
+  }
+}
+
+static void *worker_thread(void *arg) {
+  WORKER_t *worker = arg;
+  do_work(worker->pool);
+  slab_detach(worker->slabs);
+  return NULL;
+}
+
+static bool run_pool(POOL_t *pool) {
+  // Do every piece of work, with a thread for each processor, up to
+  // STORE_MAX_THREADS.  If threads can't be had, the work is still done,
+  // on fewer of them.  Returns false if any of it failed.
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  uint32_t nthreads = (cpus < 1) ? 1 : (cpus > STORE_MAX_THREADS)
+                                             ? STORE_MAX_THREADS : cpus;
+  if (nthreads > pool->count) {
+    nthreads = pool->count ? pool->count : 1;
+  }
+  pool->next = 0;
+  pool->failed = false;
+  // The threads all checksum, so make the table before any of them can.
+  store_crc32(0, NULL, 0);
+  pthread_mutex_init(&pool->lock, NULL);
+  WORKER_t *worker = GROW_ARRAY(WORKER_t, NULL, 0, nthreads);
+  uint32_t started = 0;
+  while (started < nthreads - 1) {
+    worker[started].pool = pool;
+    if (pthread_create(&worker[started].thread, NULL, worker_thread,
+                                                      &worker[started]) != 0) {
+      break;
+    }
+    started++;
+  }
+  do_work(pool);
+  for (uint32_t t = 0; t < started; t++) {
+    pthread_join(worker[t].thread, NULL);
+    slab_attach(worker[t].slabs);
+  }
+  FREE_ARRAY(WORKER_t, worker, nthreads);
+  pthread_mutex_destroy(&pool->lock);
+  return !pool->failed;
+}
+
+static bool needs_saving(ITEM_t *item) {
+  // Has a segment changed since it was last saved?
+  return item->changed > item->saved;
+}
+
+static uint32_t segment_epoch(ITEM_t *item, uint32_t epoch) {
+  // The epoch of an item's segment, once the checkpoint of this epoch is
+  // done.
+  return needs_saving(item) ? epoch : item->saved;
+}
+
+static void write_manifest(STREAM_t *out, ITEM_t *root, uint32_t epoch,
+                                                          uint64_t *count) {
+  // Write the root item, as though it had no children, and then the
+  // segments which hold its children.
+  write_value(out, root);
+  put_varint(out, 0);
+  (*count)++;
+  put_varint(out, epoch);
+  uint32_t numchildren = root->children ? root->children->count : 0;
+  put_varint(out, numchildren);
+  for (uint32_t i = 0; numchildren && i < root->children->used; i++) {
+    ITEM_t *child = root->children->child[i];
+    if (child) {
+      size_t namelen = strlen(child->name);
+      put_varint(out, namelen);
+      put_bytes(out, child->name, namelen);
+      put_varint(out, segment_epoch(child, epoch));
+      (*count)++;
+    }
+  }
+}
+
+static bool write_file(const char *filename, STORE_KIND_e kind,
+                                              ITEM_t *item, uint32_t epoch) {
+  // Write a segment holding an item, or the manifest of the itemstore
+  // whose root is the item.  It is written to a new file, which only
+  // replaces the old one once it is safely on disk, so a failed save
+  // never leaves a damaged file behind.  Returns true if it was saved.
+  char tempname[strlen(filename) + 5];
+  snprintf(tempname, sizeof(tempname), "%s.new", filename);
+  FILE *file = fopen(tempname, "wb");
+  if (file == NULL) {
+    logerr("Failed to open itemstore %s for writing: %s\n", tempname,
+                                                           strerror(errno));
+    return false;
+  }
+  uint8_t header[STORE_HEADER_SIZE] = {0};
+  uint16_t byteorder = STORE_BYTEORDER;
+  memcpy(header, STORE_MAGIC, 8);
+  header[8] = STORE_VERSION;
+  memcpy(header + 9, &byteorder, 2);
+  header[11] = kind;
+
+  STREAM_t out = {0};
+  out.file = file;
+  out.buf = GROW_ARRAY(uint8_t, NULL, 0, STORE_BUFFER_SIZE);
+  put_raw(&out, header, STORE_HEADER_SIZE);
+  uint64_t count = 0;
+  if (kind == STORE_manifest) {
+    write_manifest(&out, item, epoch, &count);
+  } else {
+    write_item(&out, item, &count);
+  }
+  put_varint(&out, count);
+  uint8_t crc[4] = {out.crc, out.crc >> 8, out.crc >> 16, out.crc >> 24};
+  put_raw(&out, crc, 4);
+  flush_stream(&out);
+  FREE_ARRAY(uint8_t, out.buf, STORE_BUFFER_SIZE);
+
+  if (out.failed || fflush(file) != 0 || fsync(fileno(file)) != 0) {
+    logerr("Failed to write itemstore %s: %s\n", tempname, strerror(errno));
+    fclose(file);
+    unlink(tempname);
+    return false;
+  }
+  if (fclose(file) != 0 || rename(tempname, filename) != 0) {
+    logerr("Failed to replace itemstore %s: %s\n", filename,
+                                                           strerror(errno));
+    unlink(tempname);
+    return false;
+  }
+  ITEMDEBUG_LOG("Saved %llu items to %s.\n", (unsigned long long)count,
+                                                                  filename);
+  return true;
+}
+
+static void sync_directory(const char *dirname) {
+  // Make sure that the files just renamed into a directory stay there.
+  int fd = open(dirname, O_RDONLY | O_DIRECTORY);
+  if (fd >= 0) {
+    fsync(fd);
+    close(fd);
+  }
+}
+
+static void remove_unlisted(const char *dirname, ITEM_t *root,
+                                                          uint32_t epoch) {
+  // Remove every file from the segment directory which the manifest does
+  // not list.  These are segments which have since been saved again, or
+  // whose items have been deleted, or saves which never finished.
+  DIR *dir = opendir(dirname);
+  if (!dir) {
+    return;
+  }
+  struct dirent *entry;
+  while ((entry = readdir(dir))) {
+    char name[sizeof(entry->d_name)];
+    strcpy(name, entry->d_name);
+    char *dot = strrchr(name, '.');
+    if (name[0] == '.' || !dot) {
+      continue;
+    }
+    *dot = '\0';
+    ITEM_t *item = search_children(root->children, name);
+    char *end;
+    unsigned long e = strtoul(dot + 1, &end, 10);
+    if (!item || *end || e != segment_epoch(item, epoch)) {
+      unlinkat(dirfd(dir), entry->d_name, 0);
+    }
+  }
+  closedir(dir);
+}
+
+static bool copy_checkpoint(const char *filename, ITEM_t *root,
+                                      uint32_t epoch, const char *backup) {
+  // Make a copy of the itemstore just saved.  The segments never change
+  // once written, so the copy shares them, by linking them into its own
+  // directory.  Only the manifest is written again.
+  char dirname[strlen(backup) + 3];
+  snprintf(dirname, sizeof(dirname), "%s.d", backup);
+  if (mkdir(dirname, 0777) != 0 && errno != EEXIST) {
+    logerr("Failed to create %s: %s\n", dirname, strerror(errno));
+    return false;
+  }
+  char from[strlen(filename) + 48];
+  char to[strlen(backup) + 48];
+  for (uint32_t i = 0; root->children && i < root->children->used; i++) {
+    ITEM_t *child = root->children->child[i];
+    if (child) {
+      uint32_t e = segment_epoch(child, epoch);
+      snprintf(from, sizeof(from), "%s.d/%s.%u", filename, child->name, e);
+      snprintf(to, sizeof(to), "%s/%s.%u", dirname, child->name, e);
+      if (link(from, to) != 0 && errno != EEXIST) {
+        logerr("Failed to link %s to %s: %s\n", to, from, strerror(errno));
+        return false;
+      }
+    }
+  }
+  sync_directory(dirname);
+  return write_file(backup, STORE_manifest, root, epoch);
+}
+
+// The segments to be saved by a checkpoint.
+typedef struct {
+  const char *dirname;
+  uint32_t epoch;
+  ITEM_t **item;
+} SAVING_t;
+
+static bool save_segment(POOL_t *pool, uint32_t i) {
+  SAVING_t *saving = pool->data;
+  ITEM_t *item = saving->item[i];
+  char path[strlen(saving->dirname) + 48];
+  snprintf(path, sizeof(path), "%s/%s.%u", saving->dirname, item->name,
+                                                              saving->epoch);
+  return write_file(path, STORE_segment, item, saving->epoch);
+}
+
+static bool write_checkpoint(const char *filename, ITEM_t *root,
+                                      uint32_t epoch, const char *backup) {
+  // Save every segment which has changed, then the manifest which lists
+  // them all, and then remove the segments which it no longer lists.  If
+  // a backup is wanted, copy the result there.
+  char dirname[strlen(filename) + 3];
+  snprintf(dirname, sizeof(dirname), "%s.d", filename);
+  if (mkdir(dirname, 0777) != 0 && errno != EEXIST) {
+    logerr("Failed to create %s: %s\n", dirname, strerror(errno));
+    return false;
+  }
+  uint32_t numchildren = root->children ? root->children->count : 0;
+  SAVING_t saving = {dirname, epoch, NULL};
+  saving.item = GROW_ARRAY(ITEM_t *, NULL, 0, numchildren + 1);
+  POOL_t pool = {0};
+  pool.work = save_segment;
+  pool.data = &saving;
+  for (uint32_t i = 0; numchildren && i < root->children->used; i++) {
+    ITEM_t *child = root->children->child[i];
+    if (child && needs_saving(child)) {
+      saving.item[pool.count++] = child;
+    }
+  }
+  bool ok = run_pool(&pool);
+  FREE_ARRAY(ITEM_t *, saving.item, numchildren + 1);
+  if (!ok) {
+    return false;
+  }
+  // The segments must be on disk before the manifest which lists them.
+  sync_directory(dirname);
+  if (!write_file(filename, STORE_manifest, root, epoch)) {
+    return false;
+  }
+  remove_unlisted(dirname, root, epoch);
+  ITEMDEBUG_LOG("Checkpoint %u of %s saved %u segments.\n", epoch, filename,
+                                                                pool.count);
+  return !backup || copy_checkpoint(filename, root, epoch, backup);
+}
+
+// The checkpoint in progress.  There is only ever one at a time.
+typedef struct {
+  pid_t pid;            // The process saving it, if in the background
+  ITEM_t *root;
+  uint32_t epoch;
+  char *saving;         // Names of the segments being saved...
+  uint32_t count;       // ...how many there are...
+  size_t size;          // ...and the space for them
+  CHECKPOINT_DONE_t done;
+  uv_signal_t watcher;  // Watches for the process to finish
+  bool watching;
+} CHECKPOINT_t;
+
+static CHECKPOINT_t checkpoint;
+
+static void plan_checkpoint(ITEM_t *root) {
+  // Begin a new epoch, so that changes from now on are in the next
+  // checkpoint, and note which segments are in this one.
+  checkpoint.root = root;
+  checkpoint.epoch = change_epoch++;
+  checkpoint.count = 0;
+  uint32_t numchildren = root->children ? root->children->count : 0;
+  checkpoint.size = numchildren * 33 + 1;
+  checkpoint.saving = GROW_ARRAY(char, NULL, 0, checkpoint.size);
+  for (uint32_t i = 0; numchildren && i < root->children->used; i++) {
+    ITEM_t *child = root->children->child[i];
+    if (child && needs_saving(child)) {
+      strcpy(checkpoint.saving + 33 * checkpoint.count++, child->name);
+    }
+  }
+}
+
+static void end_checkpoint(bool ok) {
+  // If the checkpoint was saved, its segments are now up to date.  If
+  // not, they still need saving, and will be saved next time.
+  for (uint32_t i = 0; ok && i < checkpoint.count; i++) {
+    ITEM_t *child = search_children(checkpoint.root->children,
+                                                checkpoint.saving + 33 * i);
+    if (child && child->saved < checkpoint.epoch) {
+      child->saved = checkpoint.epoch;
+    }
+  }
+  FREE_ARRAY(char, checkpoint.saving, checkpoint.size);
+  checkpoint.saving = NULL;
+  checkpoint.count = 0;
+}
+
+static void checkpoint_finished(bool ok) {
+  checkpoint.pid = 0;
+  end_checkpoint(ok);
+  if (checkpoint.done) {
+    checkpoint.done(ok);
+  }
+}
+
+static void checkpoint_done_cb(uv_signal_t *handle, int signum) {
+  // SIGCHLD has arrived.  Is it the checkpoint which has finished?
+  int status;
+  if (checkpoint.pid
+        && waitpid(checkpoint.pid, &status, WNOHANG) == checkpoint.pid) {
+    uv_signal_stop(handle);
+    checkpoint_finished(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  }
+}
+
+bool save_itemstore(const char *filename, ITEM_t *root) {
+  // Save the itemstore here and now.  Returns true if it was saved.
+  finish_checkpoint();
+  plan_checkpoint(root);
+  bool ok = write_checkpoint(filename, root, checkpoint.epoch, NULL);
+  end_checkpoint(ok);
+  return ok;
+}
+
+bool start_checkpoint(uv_loop_t *loop, const char *filename, ITEM_t *root,
+                            const char *backup, CHECKPOINT_DONE_t done) {
+  // Save the itemstore, and copy it to backup if that is given, without
+  // holding up the game.  It is saved by a child process, which has its
+  // own copy of the itemstore as it is right now.  done() is called once
+  // it has finished.  Returns false if a checkpoint is already running.
+  if (checkpoint.pid) {
+    return false;
+  }
+  plan_checkpoint(root);
+  if (!checkpoint.watching) {
+    uv_signal_init(loop, &checkpoint.watcher);
+    checkpoint.watching = true;
+  }
+  // Watch for the child before it exists, so that its exit is not missed.
+  uv_signal_start(&checkpoint.watcher, checkpoint_done_cb, SIGCHLD);
+  pid_t pid = fork();
+  if (pid == 0) {
+    // The child.  It must not touch the run loop, or flush anything
+    // belonging to the parent on the way out, and it must not keep open
+    // any socket which the parent closes.
+    close_sockets();
+    _exit(write_checkpoint(filename, root, checkpoint.epoch, backup) ? 0 : 1);
+  }
+  checkpoint.done = done;
+  if (pid < 0) {
+    // No child, so there is nothing for it but to save it here and now.
+    logerr("Unable to fork to save the itemstore: %s\n", strerror(errno));
+    uv_signal_stop(&checkpoint.watcher);
+    checkpoint_finished(write_checkpoint(filename, root, checkpoint.epoch,
+                                                                  backup));
+  } else {
+    checkpoint.pid = pid;
+  }
+  return true;
+}
+
+bool checkpoint_running() {
+  return checkpoint.pid != 0;
+}
+
+void finish_checkpoint() {
+  // Wait for a checkpoint in the background to finish.
+  int status;
+  if (checkpoint.pid && waitpid(checkpoint.pid, &status, 0) == checkpoint.pid) {
+    checkpoint_finished(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  }
+  if (checkpoint.watching) {
+    uv_signal_stop(&checkpoint.watcher);
+  }
+}
+
+static bool get_raw(STREAM_t *in, void *data, size_t len) {
+  // Take bytes from the stream without checksumming them.
+  uint8_t *dst = data;
+  while (len && !in->failed) {
+    if (in->pos == in->len) {
+      if (!in->file) {
+        in->failed = true;
+        break;
+      }
+      in->pos = 0;
+      in->len = fread(in->buf, 1, STORE_BUFFER_SIZE, in->file);
+      if (in->len == 0) {
+        in->failed = true;
+        break;
+      }
+    }
+    size_t n = in->len - in->pos;
+    if (n > len) {
+      n = len;
+    }
+    memcpy(dst, in->buf + in->pos, n);
+    in->pos += n;
+    in->offset += n;
+    dst += n;
+    len -= n;
+  }
+  return !in->failed;
+}
+
+static bool get_bytes(STREAM_t *in, void *data, size_t len) {
+  if (len > in->size - in->offset) {
+    // Asking for more than there is means the length is rubbish.
+    in->failed = true;
+  }
+  // Checksumming a mapped itemstore would mean reading all of it, which
+  // is what mapping it is meant to avoid.
+  if (get_raw(in, data, len) && in->file) {
+    in->crc = store_crc32(in->crc, data, len);
+  }
+  return !in->failed;
+}
+
+static const uint8_t *get_mapped(STREAM_t *in, size_t len) {
+  // Step over bytes of a mapped itemstore, and return where they are.
+  if (in->failed || len > in->len - in->pos) {
+    in->failed = true;
+    return NULL;
+  }
+  const uint8_t *data = in->buf + in->pos;
+  in->pos += len;
+  in->offset += len;
+  return data;
+}
+
+static uint64_t get_varint(STREAM_t *in) {
+  uint64_t v = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    uint8_t byte;
+    if (!get_bytes(in, &byte, 1)) {
+      return 0;
+    }
+    v |= (uint64_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return v;
+    }
+  }
+  in->failed = true;
+  return 0;
+}
+
+static int64_t get_signed(STREAM_t *in) {
+  uint64_t v = get_varint(in);
+  return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static ITEM_t *read_item(STREAM_t *in, ITEM_t *parent, uint64_t *count) {
+  // Read an item and all of its children, and add them to the parent
+  // (or make a root item if there is no parent).  If the stream turns
+  // out to be damaged, it is marked as failed, and whatever was read
+  // before then is still returned, so that it can be destroyed.
+  char name[33];
+  uint64_t namelen = get_varint(in);
+  if (namelen > 32) {
+    in->failed = true;
+  }
+  if (!get_bytes(in, name, namelen)) {
+    return NULL;
+  }
+  name[namelen] = '\0';
+
+  uint8_t tag;
+  VALUE_t value = VALUE_NIL;
+  uint8_t *bytecode = NULL;
+  uint64_t len = 0;
+  get_bytes(in, &tag, 1);
+  switch (tag) {
+    case STORE_nil:
+      break;
+    case STORE_int:
+      value = INT_VALUE(get_signed(in));
+      break;
+    case STORE_bool:
+      value = BOOL_VALUE(get_signed(in));
+      break;
+    case STORE_str: {
+      // From version 3, strings are followed by a null.
+      uint8_t terminated = (in->version >= 3);
+      len = get_varint(in);
+      if (len > UINT32_MAX || len + terminated > in->size - in->offset) {
+        in->failed = true;
+        break;
+      }
+      if (!in->file && terminated) {
+        const uint8_t *chars = get_mapped(in, len + 1);
+        if (chars && chars[len] == '\0') {
+          value = STR_VALUE(borrow_string((const char *)chars, len));
+        } else {
+          in->failed = true;
+        }
+        break;
+      }
+      STRING_t *str = alloc_string(len);
+      get_bytes(in, str->chars, len + terminated);
+      str->chars[len] = '\0';
+      value = STR_VALUE(str);
+      break;
+    }
+    case STORE_code:
+      len = get_varint(in);
+      if (len > UINT32_MAX || len > in->size - in->offset) {
+        in->failed = true;
+        break;
+      }
+      if (!in->file) {
+        bytecode = (uint8_t *)get_mapped(in, len);
+      } else {
+        bytecode = (uint8_t *)malloc(len);
+        get_bytes(in, bytecode, len);
+      }
+      break;
+    default:
+      in->failed = true;
+      break;
+  }
+  if (in->failed) {
+    FREE_STR(value);
+    if (in->file) {
+      free(bytecode);
+    }
+    return NULL;
+  }
+
+  ITEM_t *item;
+  if (parent == NULL) {
+    item = make_root_item(name);
+  } else if (tag == STORE_code) {
+    item = make_item(name, parent, ITEM_code, value, bytecode, len);
+    item->mapped = !in->file;
+  } else {
+    item = make_item(name, parent, ITEM_value, value, NULL, 0);
+  }
+  (*count)++;
+  uint64_t numchildren = get_varint(in);
+  for (uint64_t i = 0; i < numchildren && !in->failed; i++) {
+    read_item(in, item, count);
+  }
+  return item;
+}
+
+static ITEM_t *read_item_v1(FILE *file, ITEM_t *parent) {
+  // Read an item from a version 1 itemstore, in which everything is
+  // written at its full width in memory.
+  char name[33];
+  fread(name, sizeof(char), 33, file);
+  name[32] = '\0'; // Ensure null-termination
+  ITEM_e type;
+  fread(&type, sizeof(ITEM_e), 1, file);
+  int64_t value;
+  uint8_t *bytecode = NULL;
+  uint32_t bytecode_len = 0;
+  VALUE_e valtype;
+  VALUE_t itemval = VALUE_NIL;
+  if (type == ITEM_value) {
+    fread(&valtype, sizeof(valtype), 1, file);
+    switch (valtype) {
+      // These types are all represented as an int - only the type differs
+      case VALUE_nil:
+      case VALUE_int:
+      case VALUE_bool:
+      {
+        fread(&value, sizeof(value), 1, file);
+        if (valtype == VALUE_int) {
+          itemval = INT_VALUE(value);
+        } else if (valtype == VALUE_bool) {
+          itemval = BOOL_VALUE(value);
+        }
+        break;
+      }
+      case VALUE_str:
+      {
+        int l;
+        fread(&l, sizeof(l), 1, file); // length of string
+        STRING_t *str = alloc_string(l);
+        fread(str->chars, sizeof(char), l, file);
+        itemval = STR_VALUE(str);
+        break;
+      }
+    }
+  } else if(type == ITEM_code) {
+    fread(&bytecode_len, sizeof(bytecode_len), 1, file);
+    bytecode = (uint8_t*)malloc(bytecode_len);
+    fread(bytecode, sizeof(uint8_t), bytecode_len, file);
+  }
+  uint32_t numchildren;
+  fread(&numchildren, sizeof(numchildren), 1, file);
+    // Create the item with its value
+  ITEM_t *item = (parent == NULL) ? make_root_item(name)
+         : make_item(name, parent, type, itemval, bytecode, bytecode_len);
+  // Read children if they exist
+  for (uint32_t i = 0; i < numchildren; i++) {
+    read_item_v1(file, item);
+  }
+  return item;
+}
+
+static bool begin_reading(STREAM_t *in, FILE *file, const char *filename,
+                                      const uint8_t *header, bool mapped) {
+  // Check the header of a file, and get ready to read what follows it.
+  // The file is finished with here if it is mapped, or if it can't be
+  // read.  If mapped is set, the file is mapped into memory rather than
+  // read, and strings and bytecode are used from there.  The mapping is
+  // kept for as long as the process runs; nothing is ever written over a
+  // saved file, so the mapping is never changed underneath.
+  uint16_t byteorder;
+  memcpy(&byteorder, header + 9, 2);
+  if (header[8] < STORE_MIN_VERSION || header[8] > STORE_VERSION
+                                      || byteorder != STORE_BYTEORDER) {
+    logerr("Itemstore %s is version %d%s, which cannot be loaded.\n",
+            filename, header[8], byteorder != STORE_BYTEORDER ?
+                                  " from a machine of other byte order" : "");
+    fclose(file);
+    return false;
+  }
+
+  struct stat st;
+  fstat(fileno(file), &st);
+  memset(in, 0, sizeof(STREAM_t));
+  in->version = header[8];
+  in->offset = STORE_HEADER_SIZE;
+  in->size = st.st_size;
+  if (mapped) {
+    in->buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+                                                        fileno(file), 0);
+    fclose(file);
+    if (in->buf == MAP_FAILED) {
+      logerr("Failed to map itemstore %s: %s\n", filename,
+                                                           strerror(errno));
+      return false;
+    }
+    in->len = st.st_size;
+    in->pos = STORE_HEADER_SIZE;
+  } else {
+    in->file = file;
+    in->buf = GROW_ARRAY(uint8_t, NULL, 0, STORE_BUFFER_SIZE);
+  }
+  return true;
+}
+
+static bool end_reading(STREAM_t *in, const char *filename, uint64_t count) {
+  // Check the trailer, and finish with the file.  Returns false if the
+  // file turns out to be damaged, in which case the caller must throw
+  // away what was read before unmapping it.
+  uint64_t saved = get_varint(in);
+  uint32_t crc = in->crc;
+  uint8_t trailer[4];
+  get_raw(in, trailer, 4);
+  bool mapped = !in->file;
+  if (!mapped) {
+    FREE_ARRAY(uint8_t, in->buf, STORE_BUFFER_SIZE);
+    fclose(in->file);
+  } else {
+    // Items are found all over the place, not in order.
+    madvise(in->buf, in->len, MADV_RANDOM);
+  }
+  if (in->failed || saved != count || (!mapped && crc != (trailer[0]
+          | trailer[1] << 8 | trailer[2] << 16 | (uint32_t)trailer[3] << 24))) {
+    logerr("Itemstore %s is damaged, and cannot be loaded.\n", filename);
+    return false;
+  }
+  ITEMDEBUG_LOG("Loaded %llu items from %s%s.\n", (unsigned long long)count,
+                                  filename, mapped ? " (mapped)" : "");
+  return true;
+}
+
+static FILE *open_file(const char *filename, uint8_t *header) {
+  // Open a file and read its header.  If there isn't a header, the header
+  // is left zeroed and the file rewound.
+  FILE *file = fopen(filename, "rb");
+  if (file == NULL) {
+    logerr("Failed to open itemstore %s for reading: %s\n", filename,
+                                                           strerror(errno));
+    return NULL;
+  }
+  if (fread(header, 1, STORE_HEADER_SIZE, file) != STORE_HEADER_SIZE
+                                  || memcmp(header, STORE_MAGIC, 8) != 0) {
+    memset(header, 0, STORE_HEADER_SIZE);
+    rewind(file);
+  }
+  return file;
+}
+
+// A segment listed in a manifest.
+typedef struct {
+  char name[33];
+  uint32_t epoch;
+  ITEM_t *item;         // Once it is loaded
+} SEGMENT_t;
+
+// The segments to be loaded from a manifest.
+typedef struct {
+  const char *filename;
+  SEGMENT_t *segment;
+  bool mapped;
+} LOADING_t;
+
+static bool load_segment(POOL_t *pool, uint32_t i) {
+  // Load a segment of the itemstore.  Its item is read into a holder of
+  // its own, rather than into the root, which other threads may be adding
+  // to at the same time; it is added to the root once they are all done.
+  LOADING_t *loading = pool->data;
+  SEGMENT_t *segment = &loading->segment[i];
+  char path[strlen(loading->filename) + 48];
+  snprintf(path, sizeof(path), "%s.d/%s.%u", loading->filename,
+                                              segment->name, segment->epoch);
+  uint8_t header[STORE_HEADER_SIZE];
+  FILE *file = open_file(path, header);
+  if (!file) {
+    return false;
+  }
+  if (header[8] < 4 || header[11] != STORE_segment) {
+    logerr("Itemstore %s is not a segment.\n", path);
+    fclose(file);
+    return false;
+  }
+  STREAM_t in;
+  if (!begin_reading(&in, file, path, header, loading->mapped)) {
+    return false;
+  }
+  uint64_t count = 0;
+  ITEM_t *holder = make_root_item("");
+  ITEM_t *item = read_item(&in, holder, &count);
+  bool ok = end_reading(&in, path, count)
+                                   && strcmp(item->name, segment->name) == 0;
+  if (!ok) {
+    destroy_item(holder);
+    if (loading->mapped) {
+      munmap(in.buf, in.len);
+    }
+    return false;
+  }
+  remove_child(holder, item);
+  destroy_item(holder);
+  item->parent = NULL;
+  item->saved = segment->epoch;
+  segment->item = item;
+  return true;
+}
+
+static ITEM_t *load_manifest(FILE *file, const char *filename,
+                                        const uint8_t *header, bool mapped) {
+  // Load the root item from the manifest, and then each of its segments.
+  // The manifest itself is small, so is always read rather than mapped.
+  STREAM_t in;
+  if (!begin_reading(&in, file, filename, header, false)) {
+    return NULL;
+  }
+  uint64_t count = 0;
+  ITEM_t *root = read_item(&in, NULL, &count);
+  uint64_t epoch = get_varint(&in);
+  uint64_t numsegments = get_varint(&in);
+  if (numsegments > in.size - in.offset) {
+    in.failed = true;
+  }
+  SEGMENT_t *segment = GROW_ARRAY(SEGMENT_t, NULL, 0, numsegments + 1);
+  for (uint64_t i = 0; i < numsegments && !in.failed; i++) {
+    uint64_t namelen = get_varint(&in);
+    if (namelen > 32) {
+      in.failed = true;
+    } else if (get_bytes(&in, segment[i].name, namelen)) {
+      segment[i].name[namelen] = '\0';
+      segment[i].epoch = get_varint(&in);
+      count++;
+    }
+  }
+  bool ok = end_reading(&in, filename, count);
+  if (ok) {
+    LOADING_t loading = {filename, segment, mapped};
+    POOL_t pool = {0};
+    pool.count = numsegments;
+    pool.work = load_segment;
+    pool.data = &loading;
+    ok = run_pool(&pool);
+  }
+  // Add the segments to the root in the order in which they were listed,
+  // which is the order of the children when they were saved.
+  for (uint64_t i = 0; i < numsegments; i++) {
+    ITEM_t *item = segment[i].item;
+    if (item && ok) {
+      item->parent = root;
+      insert_child(root, item);
+    } else if (item) {
+      destroy_item(item);
+    }
+  }
+  FREE_ARRAY(SEGMENT_t, segment, numsegments + 1);
+  if (!ok) {
+    if (root) {
+      destroy_item(root);
+    }
+    return NULL;
+  }
+  // Changes from now on must be newer than anything saved.
+  if (change_epoch <= epoch) {
+    change_epoch = epoch + 1;
+  }
+  return root;
+}
+
+ITEM_t *load_itemstore(const char *filename, bool mapped) {
+  // Load the itemstore.  Returns NULL if it cannot be read, or if it is
+  // damaged, in which case nothing of it is kept.
+  uint8_t header[STORE_HEADER_SIZE];
+  FILE *file = open_file(filename, header);
+  if (!file) {
+    return NULL;
+  }
+  ITEM_t *root;
+  if (header[8] == 0) {
+    // No header, so this is from before there was one.  These can't be
+    // used from a mapping.
+    logmsg("Loading version 1 itemstore %s.\n", filename);
+    root = read_item_v1(file, NULL); // Build the itemstore from root.
+    fclose(file);
+  } else if (header[8] >= 4 && header[11] == STORE_manifest) {
+    return load_manifest(file, filename, header, mapped);
+  } else {
+    STREAM_t in;
+    if (!begin_reading(&in, file, filename, header, mapped)) {
+      return NULL;
+    }
+    uint64_t count = 0;
+    root = read_item(&in, NULL, &count);
+    if (!end_reading(&in, filename, count)) {
+      if (root) {
+        destroy_item(root);
+      }
+      if (mapped) {
+        munmap(in.buf, in.len);
+      }
+      return NULL;
+    }
+  }
+  // Everything came from a single file, so every segment needs saving.
+  for (uint32_t i = 0; root->children && i < root->children->used; i++) {
+    if (root->children->child[i]) {
+      mark_changed(root->children->child[i]);
+    }
+  }
+  return root;
+}
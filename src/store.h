@@ -0,0 +1,92 @@
+// Saving and loading the itemstore.
+//
+// The itemstore is saved in pieces: each child of the root item, with
+// everything beneath it, is a segment in a file of its own, and the
+// itemstore file itself is a manifest which lists them.  Only the segments
+// which have changed since they were last saved are written again, so the
+// cost of a checkpoint depends on how much has changed rather than on how
+// big the world is.  The segments live in <itemstore>.d, and are named
+// <item>.<epoch>, after the checkpoint which wrote them.  A segment is
+// never written over: a changed one is written under a new name, and the
+// old one is removed once the manifest no longer mentions it.
+//
+// Every file is a header followed by records, and then a trailer.
+//
+//   Header:  "SINSTORE" (8 bytes), the format version (1 byte), a byte
+//            order marker (2 bytes, written in the byte order of the
+//            machine which saved it), the kind of file (1 byte) and 4
+//            reserved bytes.
+//   Item:    Name (varint length, then the characters), a tag byte for
+//            the type, then the contents: nothing for nil, a zigzag
+//            varint for an int or bool, or a varint length followed by
+//            the bytes for a string (and a null) or bytecode.  Finally,
+//            a varint count of the children, which follow immediately.
+//   Trailer: The number of records (varint), then the CRC-32 of
+//            everything after the header, little-endian.
+//
+// A segment holds a single item and its children.  A manifest holds the
+// root item without its children, then the epoch of the checkpoint
+// (varint), the number of segments (varint), and for each segment the name
+// of its item (varint length, then the characters) and its epoch (varint).
+// Before version 4, the itemstore was a single file holding every item.
+//
+// Bytecode contains integers in the byte order of the machine which
+// compiled it, so a store cannot be moved between machines of different
+// byte order.  The byte order marker catches that.
+//
+// Nothing in a file refers to a position in it, so it can be mapped into
+// memory anywhere and used where it is.  When loaded that way, strings
+// and bytecode are not copied out of the mapping; they are only copied
+// when they are changed.  This is why strings end with a null (which
+// version 2 did not have).
+//
+// Stores saved before the format had a header (version 1) can still be
+// loaded, and are saved in the current format the next time round.
+
+// Licensed under the MIT License - see LICENSE file for details.
+
+#pragma once
+
+#include <uv.h>
+
+#include "item.h"
+
+#define STORE_MAGIC       "SINSTORE"
+#define STORE_VERSION     4
+#define STORE_MIN_VERSION 2 // The oldest version with a header
+#define STORE_BYTEORDER   0x0102
+#define STORE_HEADER_SIZE 16
+
+// Size of the buffer through which the itemstore is written and read.
+#define STORE_BUFFER_SIZE (1024 * 1024)
+
+// Segments are saved and loaded in parallel, by a thread for each
+// processor, but no more than this many.
+#define STORE_MAX_THREADS 16
+
+// Tags for the type of a saved item.
+typedef enum {
+  STORE_nil,
+  STORE_int,
+  STORE_bool,
+  STORE_str,
+  STORE_code
+} STORE_TAG_e;
+
+// Kinds of file.  Before version 4, every file is a whole itemstore.
+typedef enum {
+  STORE_whole,
+  STORE_manifest,
+  STORE_segment
+} STORE_KIND_e;
+
+// Called when a checkpoint in the background has finished.
+typedef void (*CHECKPOINT_DONE_t)(bool ok);
+
+uint32_t store_crc32(uint32_t crc, const void *buf, size_t len);
+bool save_itemstore(const char *filename, ITEM_t *root);
+bool start_checkpoint(uv_loop_t *loop, const char *filename, ITEM_t *root,
+                            const char *backup, CHECKPOINT_DONE_t done);
+bool checkpoint_running();
+void finish_checkpoint();
+ITEM_t *load_itemstore(const char *filename, bool mapped);
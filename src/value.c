@@ -3,31 +3,205 @@
 // Licensed under the MIT License - see LICENSE file for details.
 
 #include <stddef.h>
+#include <string.h>
 #include <malloc.h>
 
-#define VALUE_INTERNAL
+#include "memory.h"
 #include "value.h"
 
-const VALUE_t VALUE_NIL = {VALUE_nil, {0}};
-const VALUE_t VALUE_TRUE = {VALUE_bool, {1}};
-const VALUE_t VALUE_FALSE = {VALUE_bool, {0}};
-const VALUE_t VALUE_ZERO = {VALUE_int, {0}};
+STRING_t *alloc_string(uint32_t len) {
+  // Allocate a string with room for len characters and a terminator,
+  // and a single reference.  The caller fills in the characters.
+  STRING_t *str = (STRING_t *)reallocate(NULL, 0, sizeof(STRING_t) + len + 1);
+  str->refcount = 1;
+  str->len = len;
+  str->hash = 0;
+  str->chars = str->data;
+  str->chars[len] = '\0';
+  return str;
+}
+
+STRING_t *make_string(const char *chars, uint32_t len) {
+  // Make a new string from the first len characters of chars.
+  STRING_t *str = alloc_string(len);
+  memcpy(str->chars, chars, len);
+  return str;
+}
+
+STRING_t *make_cstring(const char *chars) {
+  return make_string(chars, strlen(chars));
+}
+
+STRING_t *borrow_string(const char *chars, uint32_t len) {
+  // Make a new string which uses the first len characters of chars where
+  // they are, rather than copying them.  They must be followed by a null,
+  // and must be there for as long as the string is.
+  STRING_t *str = (STRING_t *)reallocate(NULL, 0, sizeof(STRING_t));
+  str->refcount = 1;
+  str->len = len;
+  str->borrowed = true;
+  str->chars = (char *)chars;
+  return str;
+}
+
+STRING_t *unshare_string(STRING_t *str) {
+  // Return a string which can safely be changed in place.  If anything
+  // else refers to this one, or its characters are borrowed, it is left
+  // alone and a copy is returned (taking over the caller's reference).
+  if (str->refcount > 1 || str->borrowed) {
+    STRING_t *copy = make_string(STRING_CHARS(str), str->len);
+    release_string(str);
+    str = copy;
+  } else {
+    STRING_CHARS(str);
+  }
+  str->hash = 0; // It is about to change
+  return str;
+}
+
+STRING_t *concat_strings(STRING_t *first, STRING_t *second) {
+  // Join two strings, taking over the caller's references to both.
+  uint32_t len = first->len + second->len;
+  STRING_t *str;
+  if (len < MIN_ROPE_LENGTH) {
+    // Short enough that copying is cheaper than keeping track of pieces.
+    str = alloc_string(len);
+    memcpy(str->chars, STRING_CHARS(first), first->len);
+    memcpy(str->chars + first->len, STRING_CHARS(second), second->len);
+    release_string(first);
+    release_string(second);
+  } else {
+    str = (STRING_t *)reallocate(NULL, 0, sizeof(STRING_t));
+    str->refcount = 1;
+    str->len = len;
+    str->left = first;
+    str->right = second;
+  }
+  return str;
+}
+
+char *flatten_string(STRING_t *str) {
+  // Copy the pieces of a joined string into one buffer, and let go of
+  // the pieces.  Strings built up in a loop can be joined many thousands
+  // deep, so the pieces are visited from a list rather than recursively.
+  char *chars = GROW_ARRAY(char, NULL, 0, str->len + 1);
+  char *next = chars;
+  int count = 0, capacity = 8;
+  STRING_t **pending = GROW_ARRAY(STRING_t *, NULL, 0, capacity);
+  pending[count++] = str;
+  while (count > 0) {
+    STRING_t *piece = pending[--count];
+    if (piece->chars) {
+      memcpy(next, piece->chars, piece->len);
+      next += piece->len;
+    } else {
+      if (count + 2 > capacity) {
+        pending = GROW_ARRAY(STRING_t *, pending, capacity, capacity * 2);
+        capacity *= 2;
+      }
+      // Right first, so that the left is copied first.
+      pending[count++] = piece->right;
+      pending[count++] = piece->left;
+    }
+  }
+  FREE_ARRAY(STRING_t *, pending, capacity);
+  release_string(str->left);
+  release_string(str->right);
+  str->left = NULL;
+  str->right = NULL;
+  str->chars = chars;
+  return chars;
+}
+
+static void free_string(STRING_t *str) {
+  // Free a string with no references left, but not its pieces.
+  if (str->chars == str->data) {
+    reallocate(str, sizeof(STRING_t) + str->len + 1, 0);
+  } else {
+    if (str->chars && !str->borrowed) {
+      FREE_ARRAY(char, str->chars, str->len + 1);
+    }
+    reallocate(str, sizeof(STRING_t), 0);
+  }
+}
+
+void release_string(STRING_t *str) {
+  if (--str->refcount > 0) {
+    return;
+  }
+  if (!str->left) {
+    free_string(str);
+    return;
+  }
+  // An unflattened string may be many pieces deep, so let go of them
+  // from a list rather than recursively.
+  int count = 0, capacity = 8;
+  STRING_t **pending = GROW_ARRAY(STRING_t *, NULL, 0, capacity);
+  pending[count++] = str;
+  while (count > 0) {
+    STRING_t *piece = pending[--count];
+    if (piece->left) {
+      if (count + 2 > capacity) {
+        pending = GROW_ARRAY(STRING_t *, pending, capacity, capacity * 2);
+        capacity *= 2;
+      }
+      if (--piece->left->refcount == 0) {
+        pending[count++] = piece->left;
+      }
+      if (--piece->right->refcount == 0) {
+        pending[count++] = piece->right;
+      }
+    }
+    free_string(piece);
+  }
+  FREE_ARRAY(STRING_t *, pending, capacity);
+}
+
+uint32_t hash_string(STRING_t *str) {
+  // FNV-1a, calculated when first needed and then remembered.
+  if (str->hash == 0) {
+    uint32_t hash = 2166136261u;
+    char *chars = STRING_CHARS(str);
+    for (uint32_t c = 0; c < str->len; c++) {
+      hash ^= (uint8_t)chars[c];
+      hash *= 16777619;
+    }
+    str->hash = hash ? hash : 1; // 0 means not yet known
+  }
+  return str->hash;
+}
+
+bool strings_equal(STRING_t *a, STRING_t *b) {
+  // Compare two strings, avoiding looking at the characters if possible.
+  if (a == b) {
+    return true;
+  }
+  if (a->len != b->len || (a->hash && b->hash && a->hash != b->hash)) {
+    return false;
+  }
+  return memcmp(STRING_CHARS(a), STRING_CHARS(b), a->len) == 0;
+}
+
+VALUE_t make_string_value(const char *chars) {
+  // A string value holding a copy of a null-terminated string.
+  return STR_VALUE(make_cstring(chars));
+}
 
 VALUE_t convert_to_bool(VALUE_t from) {
   // This function takes a VALUE of any type and returns a VALUE_bool
   // which is sensibly true or false.
-  // NOTE: If from.type == VALUE_str, this function also frees from.s
+  // NOTE: If from is a string, this function also releases the string.
 
-  switch (from.type) {
+  switch (VALUE_TYPE(from)) {
     case VALUE_bool:
       // This is already a bool.  Return it.
       return from;
     case VALUE_int:
       // Non-zero ints are true.
-      if (from.i == 0) return VALUE_FALSE; else return VALUE_TRUE;
+      if (AS_INT(from) == 0) return VALUE_FALSE; else return VALUE_TRUE;
     case VALUE_str:
       // All strings are true.
-      free(from.s);
+      release_string(AS_STR(from));
       return VALUE_TRUE;
     default:
       // If in doubt, it ain't true.
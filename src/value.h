@@ -5,6 +5,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
 
 typedef enum { VALUE_int,
                VALUE_str,
@@ -12,25 +13,104 @@ typedef enum { VALUE_int,
                VALUE_bool
              } VALUE_e;
 
+// Strings are shared rather than copied.  Copying a string value takes
+// another reference to the same STRING_t, and the string is freed when
+// the last reference is released.  A string with more than one reference
+// must not be changed.
+//
+// Joining two long strings does not copy them.  Instead, the result
+// refers to both pieces (which may themselves be joins), and the
+// characters are only put together when something needs to read them.
+// So always use STRING_CHARS() rather than reading chars directly.
+//
+// A string may also borrow its characters from somewhere else which
+// outlives it, such as a mapped itemstore.  Those characters are never
+// changed or freed; the string is copied before anything changes it.
+typedef struct String STRING_t;
+struct String {
+  uint32_t refcount;  // Number of values referring to this string
+  uint32_t len;       // Length, not including the null terminator
+  uint32_t hash;      // Hash of the characters, or 0 if not yet known
+  bool borrowed;      // The characters belong to something else
+  char *chars;        // The string itself, or NULL if not yet flattened
+  STRING_t *left;     // The two pieces of a string which has not
+  STRING_t *right;    // yet been flattened
+  char data[];        // Storage for the characters of a plain string
+};
+
+// Strings joined together which are shorter than this are just copied.
+#define MIN_ROPE_LENGTH 64
+
+// The characters of a string, null-terminated.
+#define STRING_CHARS(str) ((str)->chars ? (str)->chars : flatten_string(str))
+
+// A value is a single 64-bit word, told apart by its lowest bits:
+//
+//   nnnn...nnn1  an int, held in the upper 63 bits
+//   pppp...p010  a string, as a pointer to its STRING_t
+//   0000...b100  a bool, b being whether it is true
+//   0000...0000  nil
+//
+// so a value is the size of a pointer, and zeroed memory is nil.  Strings
+// are allocated with malloc, so their pointers always have the low three
+// bits clear.  Ints are one bit short of int64_t, and wrap at 63 bits.
+// Never look at the bits directly; use the macros below.
 typedef struct {
-  VALUE_e type; // What sort of value am I?
-  union {
-    int64_t i;  // This is an integer value
-    char *s; // This is a string value
-  };
+  uint64_t bits;
 } VALUE_t;
 
-#ifndef VALUE_INTERNAL
-extern VALUE_t VALUE_NIL;
-extern VALUE_t VALUE_ZERO;
-extern VALUE_t VALUE_TRUE;
-extern VALUE_t VALUE_FALSE;
-#endif
+#define VALUE_TAG_int   1
+#define VALUE_TAG_str   2
+#define VALUE_TAG_bool  4
+#define VALUE_TAG_MASK  7
+
+#define IS_INT(val)   (((val).bits & VALUE_TAG_int) != 0)
+#define IS_STR(val)   (((val).bits & VALUE_TAG_MASK) == VALUE_TAG_str)
+#define IS_BOOL(val)  (((val).bits & VALUE_TAG_MASK) == VALUE_TAG_bool)
+#define IS_NIL(val)   ((val).bits == 0)
+#define VALUE_TYPE(val) \
+  (IS_INT(val) ? VALUE_int : IS_STR(val) ? VALUE_str : \
+                                      IS_BOOL(val) ? VALUE_bool : VALUE_nil)
+
+#define AS_INT(val)   ((int64_t)(val).bits >> 1)
+#define AS_STR(val)   ((STRING_t *)(uintptr_t)((val).bits - VALUE_TAG_str))
+#define AS_BOOL(val)  ((int64_t)((val).bits >> 3))
+
+#define INT_VALUE(n)  ((VALUE_t){((uint64_t)(n) << 1) | VALUE_TAG_int})
+#define STR_VALUE(str) ((VALUE_t){(uint64_t)(uintptr_t)(str) | VALUE_TAG_str})
+#define BOOL_VALUE(b) ((VALUE_t){((uint64_t)((b) != 0) << 3) | VALUE_TAG_bool})
 
+// Is this a non-zero int or a true bool?
+#define IS_TRUE(val) \
+  ((IS_INT(val) && AS_INT(val) != 0) || (val).bits == VALUE_TRUE.bits)
+
+#define VALUE_NIL    ((VALUE_t){0})
+#define VALUE_ZERO   INT_VALUE(0)
+#define VALUE_TRUE   BOOL_VALUE(1)
+#define VALUE_FALSE  BOOL_VALUE(0)
+
+// Give up a reference to a string value.
 #define FREE_STR(val) \
-  if ((val).type == VALUE_str) { \
-    STRINGDEBUG_LOG("Freeing: %s\n", val.s); \
-    FREE_ARRAY(char, (val).s, strlen((val).s) + 1); \
+  if (IS_STR(val)) { \
+    STRINGDEBUG_LOG("Releasing string of length %u\n", AS_STR(val)->len); \
+    release_string(AS_STR(val)); \
   }
-  
+
+// Take another reference to a string value.
+#define COPY_STR(val) \
+  if (IS_STR(val)) { \
+    AS_STR(val)->refcount++; \
+  }
+
+STRING_t *alloc_string(uint32_t len);
+STRING_t *make_string(const char *chars, uint32_t len);
+STRING_t *make_cstring(const char *chars);
+STRING_t *borrow_string(const char *chars, uint32_t len);
+STRING_t *unshare_string(STRING_t *str);
+STRING_t *concat_strings(STRING_t *first, STRING_t *second);
+char *flatten_string(STRING_t *str);
+void release_string(STRING_t *str);
+uint32_t hash_string(STRING_t *str);
+bool strings_equal(STRING_t *a, STRING_t *b);
+VALUE_t make_string_value(const char *chars);
 VALUE_t convert_to_bool(VALUE_t from);
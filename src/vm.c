@@ -59,6 +59,9 @@ void push_callstack(ITEM_t *item, uint8_t *nextop, uint8_t args) {
                                                         VM->stack->locals;
     VM->callstack->entry[VM->callstack->current].current_params =
                                                         VM->stack->params;
+    VM->callstack->entry[VM->callstack->current].resume = NULL;
+    VM->callstack->entry[VM->callstack->current].inuse = false;
+    VM->callstack->entry[VM->callstack->current].profiled = false;
     // The base is used when indexing into the stack in the current
     // frame (eg for accessing local variables).
     VM->stack->base = VM->stack->current + 1 - args;
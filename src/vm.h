@@ -9,6 +9,8 @@
 
 #define CALLSTACK_SIZE 1024
 
+// A call in progress.  The frame holds the state of the caller, to go
+// back to when the call returns.
 typedef struct {
   ITEM_t *item;
   uint8_t *nextop;
@@ -16,6 +18,10 @@ typedef struct {
   int32_t current_base;
   uint8_t current_locals;
   uint8_t current_params;
+  // Only for calls made by the interpreter loop without leaving it:
+  struct Instr *resume; // The caller's next instruction
+  bool inuse;           // Whether the item called was already in use
+  bool profiled;        // Whether the call is being timed
 } FRAME_t;
 
 typedef struct {